@@ -0,0 +1,177 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bench_harness.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace {
+	struct Benchmark {
+		std::string name;
+		bench::Function function;
+	};
+	struct Result {
+		std::string name;
+		uint64_t iterations = 0;
+		double nsPerIteration = 0.0;
+		double itemsPerSecond = 0.0;
+	};
+	struct Settings {
+		std::string filter;
+		double minTime = 0.5; // Seconds
+		bool json = false;
+		std::string jsonFile;
+		bool listOnly = false;
+	};
+};
+
+static std::vector<Benchmark> &get_benchmarks()
+{
+	static std::vector<Benchmark> benchmarks;
+	return benchmarks;
+}
+
+bool bench::register_benchmark(std::string name, Function f)
+{
+	get_benchmarks().push_back({std::move(name), std::move(f)});
+	return true;
+}
+
+static Result run_benchmark(const Benchmark &benchmark, double minTime)
+{
+	using Clock = std::chrono::steady_clock;
+	uint64_t iterations = 1;
+	for(;;) {
+		bench::State state {iterations};
+		auto t0 = Clock::now();
+		benchmark.function(state);
+		auto t = std::chrono::duration<double>(Clock::now() - t0).count();
+		// Estimate the iteration count required for the minimum time, with some headroom, but grow at most 10x per step
+		if(t >= minTime || iterations >= (uint64_t {1} << 40)) {
+			Result result {benchmark.name, iterations};
+			result.nsPerIteration = t * 1e9 / static_cast<double>(iterations);
+			if(state.GetItemsPerIteration() > 0)
+				result.itemsPerSecond = static_cast<double>(state.GetItemsPerIteration()) * static_cast<double>(iterations) / t;
+			return result;
+		}
+		auto factor = (t > 0.0) ? (minTime * 1.4 / t) : 10.0;
+		iterations = static_cast<uint64_t>(static_cast<double>(iterations) * std::min(std::max(factor, 2.0), 10.0));
+	}
+}
+
+static std::string escape_json(std::string_view str)
+{
+	std::string result;
+	for(auto c : str) {
+		if(c == '"' || c == '\\')
+			result += '\\';
+		result += c;
+	}
+	return result;
+}
+
+static void write_json(std::ostream &out, const std::vector<Result> &results)
+{
+	out << "{\n  \"context\": {\n";
+	out << "    \"library\": \"mathutil\",\n";
+#ifdef NDEBUG
+	out << "    \"library_build_type\": \"release\"\n";
+#else
+	out << "    \"library_build_type\": \"debug\"\n";
+#endif
+	out << "  },\n  \"benchmarks\": [\n";
+	for(size_t i = 0; i < results.size(); ++i) {
+		auto &r = results[i];
+		out << "    {\n";
+		out << "      \"name\": \"" << escape_json(r.name) << "\",\n";
+		out << "      \"iterations\": " << r.iterations << ",\n";
+		out << "      \"real_time\": " << r.nsPerIteration << ",\n";
+		if(r.itemsPerSecond > 0.0)
+			out << "      \"items_per_second\": " << r.itemsPerSecond << ",\n";
+		out << "      \"time_unit\": \"ns\"\n";
+		out << "    }" << ((i + 1 < results.size()) ? "," : "") << "\n";
+	}
+	out << "  ]\n}\n";
+}
+
+static void print_usage()
+{
+	std::cout << "Usage: mathutil_bench [options]\n"
+	          << "  --filter=<text>     Only runs benchmarks whose name contains the text\n"
+	          << "  --min-time=<sec>    Minimum run time per benchmark (default 0.5)\n"
+	          << "  --json[=<file>]     Writes the results as JSON to stdout or the specified file\n"
+	          << "  --list              Lists the benchmarks without running them\n";
+}
+
+static bool parse_arguments(int argc, char **argv, Settings &settings)
+{
+	for(int i = 1; i < argc; ++i) {
+		std::string_view arg {argv[i]};
+		auto value = [&arg](std::string_view option) -> std::string_view { return arg.substr(option.size()); };
+		if(arg.starts_with("--filter="))
+			settings.filter = value("--filter=");
+		else if(arg.starts_with("--min-time="))
+			settings.minTime = std::atof(std::string {value("--min-time=")}.c_str());
+		else if(arg == "--json")
+			settings.json = true;
+		else if(arg.starts_with("--json=")) {
+			settings.json = true;
+			settings.jsonFile = value("--json=");
+		}
+		else if(arg == "--list")
+			settings.listOnly = true;
+		else {
+			print_usage();
+			return false;
+		}
+	}
+	return true;
+}
+
+int bench::run(int argc, char **argv)
+{
+	Settings settings {};
+	if(!parse_arguments(argc, argv, settings))
+		return EXIT_FAILURE;
+	// When writing JSON to stdout, progress is written to stderr so the output stays parsable
+	auto &log = (settings.json && settings.jsonFile.empty()) ? std::cerr : std::cout;
+	std::vector<Result> results;
+	for(auto &benchmark : get_benchmarks()) {
+		if(!settings.filter.empty() && benchmark.name.find(settings.filter) == std::string::npos)
+			continue;
+		if(settings.listOnly) {
+			std::cout << benchmark.name << "\n";
+			continue;
+		}
+		auto result = run_benchmark(benchmark, settings.minTime);
+		char buf[256];
+		std::snprintf(buf, sizeof(buf), "%-56s %14.2f ns %12llu", result.name.c_str(), result.nsPerIteration, static_cast<unsigned long long>(result.iterations));
+		log << buf;
+		if(result.itemsPerSecond > 0.0) {
+			std::snprintf(buf, sizeof(buf), " %10.2f M items/s", result.itemsPerSecond / 1e6);
+			log << buf;
+		}
+		log << std::endl;
+		results.push_back(std::move(result));
+	}
+	if(!settings.json || settings.listOnly)
+		return EXIT_SUCCESS;
+	if(settings.jsonFile.empty()) {
+		write_json(std::cout, results);
+		return EXIT_SUCCESS;
+	}
+	std::ofstream f {settings.jsonFile};
+	if(!f) {
+		std::cerr << "Unable to open '" << settings.jsonFile << "' for writing." << std::endl;
+		return EXIT_FAILURE;
+	}
+	write_json(f, results);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,55 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __MATHUTIL_BENCH_HARNESS_HPP__
+#define __MATHUTIL_BENCH_HARNESS_HPP__
+
+#include <cinttypes>
+#include <functional>
+#include <string>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Minimal benchmark harness, so the benchmarks don't depend on an external library. Every benchmark is a function that
+// performs state.GetIterations() iterations of the measured operation; the harness increases the iteration count until the
+// run takes at least the minimum time and reports the time per iteration, either as text or as JSON.
+namespace bench {
+	class State {
+	  public:
+		State(uint64_t iterations) : m_iterations {iterations} {}
+		uint64_t GetIterations() const { return m_iterations; }
+		// Number of processed items per iteration, used to report the throughput
+		void SetItemsPerIteration(uint64_t items) { m_itemsPerIteration = items; }
+		uint64_t GetItemsPerIteration() const { return m_itemsPerIteration; }
+	  private:
+		uint64_t m_iterations = 0;
+		uint64_t m_itemsPerIteration = 0;
+	};
+
+	using Function = std::function<void(State &)>;
+	bool register_benchmark(std::string name, Function f);
+	int run(int argc, char **argv);
+
+	// Prevents the compiler from optimizing away the computation of a value
+	template<class T>
+	inline void do_not_optimize(T &value)
+	{
+#if defined(_MSC_VER)
+		static volatile const void *sink;
+		sink = &value;
+		_ReadWriteBarrier();
+#else
+		asm volatile("" : : "g"(&value) : "memory");
+#endif
+	}
+};
+
+#define MATHUTIL_BENCHMARK(name) \
+	static void name(bench::State &state); \
+	static const bool name##_registered = bench::register_benchmark(#name, &name); \
+	static void name(bench::State &state)
+
+#endif
@@ -0,0 +1,95 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bench_harness.hpp"
+#include "mathutil/umath_geometry.hpp"
+#include <random>
+#include <vector>
+
+namespace {
+	constexpr size_t POINT_COUNT = 1 << 12;
+	struct GeometryData {
+		GeometryData()
+		{
+			std::mt19937 rng {25};
+			std::uniform_real_distribution<float> dis {-50.f, 50.f};
+			for(size_t i = 0; i < POINT_COUNT; ++i)
+				points.push_back({dis(rng), dis(rng), dis(rng)});
+		}
+		const Vector3 &Get(size_t i) const { return points[i % POINT_COUNT]; }
+		std::vector<Vector3> points;
+	};
+	const GeometryData &get_data()
+	{
+		static GeometryData data;
+		return data;
+	}
+
+	template<class TFunc>
+	void run_points(bench::State &state, const TFunc &f)
+	{
+		auto &data = get_data();
+		std::vector<Vector3> out(POINT_COUNT);
+		for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+			for(size_t i = 0; i < POINT_COUNT; ++i)
+				out[i] = f(data, i);
+			bench::do_not_optimize(out);
+		}
+		state.SetItemsPerIteration(POINT_COUNT);
+	}
+};
+
+using namespace umath;
+
+MATHUTIL_BENCHMARK(Geometry_ClosestPointOnAabbToPoint)
+{
+	run_points(state, [](const GeometryData &d, size_t i) {
+		Vector3 res;
+		geometry::closest_point_on_aabb_to_point(Vector3 {-10.f, -5.f, -20.f}, Vector3 {10.f, 5.f, 20.f}, d.Get(i), &res);
+		return res;
+	});
+}
+MATHUTIL_BENCHMARK(Geometry_ClosestPointOnPlaneToPoint)
+{
+	run_points(state, [](const GeometryData &d, size_t i) {
+		Vector3 res;
+		geometry::closest_point_on_plane_to_point(uvec::get_normal(Vector3 {1.f, 2.f, 3.f}), 4.f, d.Get(i), &res);
+		return res;
+	});
+}
+MATHUTIL_BENCHMARK(Geometry_ClosestPointOnTriangleToPoint)
+{
+	run_points(state, [](const GeometryData &d, size_t i) {
+		Vector3 res;
+		geometry::closest_point_on_triangle_to_point(d.Get(i + 1), d.Get(i + 2), d.Get(i + 3), d.Get(i), &res);
+		return res;
+	});
+}
+MATHUTIL_BENCHMARK(Geometry_ClosestPointsBetweenLines)
+{
+	run_points(state, [](const GeometryData &d, size_t i) {
+		float s, t;
+		Vector3 cA, cB;
+		geometry::closest_points_between_lines(d.Get(i), d.Get(i + 1), d.Get(i + 2), d.Get(i + 3), &s, &t, &cA, &cB);
+		return cA;
+	});
+}
+MATHUTIL_BENCHMARK(Geometry_ClosestPointOnLineToPoint) { run_points(state, [](const GeometryData &d, size_t i) { return geometry::closest_point_on_line_to_point(d.Get(i + 1), d.Get(i + 2), d.Get(i)); }); }
+MATHUTIL_BENCHMARK(Geometry_ClosestPointOnSphereToLine) { run_points(state, [](const GeometryData &d, size_t i) { return geometry::closest_point_on_sphere_to_line(d.Get(i), 5.f, d.Get(i + 1), d.Get(i + 2)); }); }
+
+MATHUTIL_BENCHMARK(Geometry_GenerateTruncatedConeMesh)
+{
+	std::vector<Vector3> verts;
+	std::vector<uint16_t> triangles;
+	std::vector<Vector3> normals;
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		verts.clear();
+		triangles.clear();
+		normals.clear();
+		geometry::generate_truncated_cone_mesh(Vector3 {}, 2.f, Vector3 {0.f, 0.f, 1.f}, 10.f, 5.f, verts, &triangles, &normals, 32, true);
+		bench::do_not_optimize(verts);
+		bench::do_not_optimize(triangles);
+	}
+	state.SetItemsPerIteration(1);
+}
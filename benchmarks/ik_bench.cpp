@@ -0,0 +1,84 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bench_harness.hpp"
+#include "mathutil/inverse_kinematics/ik.hpp"
+#include "mathutil/inverse_kinematics/ik_batch.hpp"
+#include <vector>
+
+namespace {
+	constexpr uint32_t JOINT_COUNT = 16;
+	constexpr uint32_t STEP_COUNT = 20;
+	const umath::ScaledTransform TARGET {Vector3 {6.f, 4.f, 9.f}, uquat::identity(), Vector3 {1.f}};
+
+	// Straight chain along the z-axis with unit length segments
+	umath::ScaledTransform get_rest_pose(uint32_t index) { return umath::ScaledTransform {Vector3 {0.f, 0.f, (index > 0) ? 1.f : 0.f}, uquat::identity(), Vector3 {1.f}}; }
+	void reset_chain(uvec::ik::IkSolver &solver)
+	{
+		for(uint32_t i = 0; i < JOINT_COUNT; ++i)
+			solver.SetLocalTransform(i, get_rest_pose(i));
+	}
+
+	// Every iteration solves from the rest pose, so the solvers do the same amount of work each time
+	template<class TSolver, class TFunc>
+	void run_solver(bench::State &state, TSolver &solver, const TFunc &solve)
+	{
+		solver.Resize(JOINT_COUNT);
+		solver.SetNumSteps(STEP_COUNT);
+		solver.SetThreshold(1e-4f);
+		for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+			reset_chain(solver);
+			auto solved = solve(solver);
+			bench::do_not_optimize(solved);
+		}
+		state.SetItemsPerIteration(1);
+	}
+};
+
+MATHUTIL_BENCHMARK(Ik_CCDSolver)
+{
+	uvec::ik::CCDSolver solver {};
+	run_solver(state, solver, [](uvec::ik::CCDSolver &solver) { return solver.Solve(TARGET); });
+}
+MATHUTIL_BENCHMARK(Ik_FABRIKSolver)
+{
+	uvec::ik::FABRIKSolver solver {};
+	run_solver(state, solver, [](uvec::ik::FABRIKSolver &solver) { return solver.Solve(TARGET); });
+}
+MATHUTIL_BENCHMARK(Ik_DLSSolver)
+{
+	uvec::ik::DLSSolver solver {};
+	run_solver(state, solver, [](uvec::ik::DLSSolver &solver) { return solver.Solve(TARGET); });
+}
+MATHUTIL_BENCHMARK(Ik_DLSSolverMultipleEffectors)
+{
+	uvec::ik::DLSSolver solver {};
+	const uvec::ik::IkEffector effectors[] = {{JOINT_COUNT - 1, Vector3 {6.f, 4.f, 9.f}}, {JOINT_COUNT / 2, Vector3 {2.f, 2.f, 5.f}}};
+	run_solver(state, solver, [&effectors](uvec::ik::DLSSolver &solver) { return solver.Solve(effectors); });
+}
+MATHUTIL_BENCHMARK(Ik_BatchSolver)
+{
+	constexpr uint32_t chainCount = 256;
+	uvec::ik::IkBatchSolver batch {};
+	std::vector<umath::ScaledTransform> restPoses;
+	for(uint32_t i = 0; i < JOINT_COUNT; ++i)
+		restPoses.push_back(get_rest_pose(i));
+	uvec::ik::IkChainSettings settings {};
+	settings.numSteps = STEP_COUNT;
+	settings.threshold = 1e-4f;
+	for(uint32_t c = 0; c < chainCount; ++c) {
+		settings.algorithm = (c % 2 == 0) ? uvec::ik::IkAlgorithm::CCD : uvec::ik::IkAlgorithm::FABRIK;
+		auto id = batch.AddChain(restPoses, {}, settings);
+		batch.SetTarget(id, TARGET.GetOrigin() + Vector3 {static_cast<float>(c % 16) * 0.1f, 0.f, 0.f});
+	}
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		for(uint32_t c = 0; c < chainCount; ++c) {
+			for(uint32_t i = 0; i < JOINT_COUNT; ++i)
+				batch.SetLocalPose(c, i, restPoses[i]);
+		}
+		auto solved = batch.Solve();
+		bench::do_not_optimize(solved);
+	}
+	state.SetItemsPerIteration(chainCount);
+}
@@ -0,0 +1,76 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bench_harness.hpp"
+#include "mathutil/uvec.h"
+#include "mathutil/uquat.h"
+#include <random>
+#include <vector>
+
+// Exported vs. inline versions of the small uvec/uquat functions, the difference is the call overhead of the shared library
+namespace {
+	constexpr size_t VALUE_COUNT = 1 << 12;
+	struct InlineData {
+		InlineData()
+		{
+			std::mt19937 rng {23};
+			std::uniform_real_distribution<float> dis {-1.f, 1.f};
+			for(size_t i = 0; i < VALUE_COUNT; ++i) {
+				a.push_back({dis(rng), dis(rng), dis(rng)});
+				b.push_back({dis(rng), dis(rng), dis(rng)});
+				q.push_back(uquat::create(uvec::get_normal(Vector3 {dis(rng), dis(rng), dis(rng) + 2.f}), dis(rng) * 3.f));
+			}
+		}
+		std::vector<Vector3> a;
+		std::vector<Vector3> b;
+		std::vector<Quat> q;
+	};
+	const InlineData &get_data()
+	{
+		static InlineData data;
+		return data;
+	}
+
+	template<class TFunc>
+	void run_scalar(bench::State &state, const TFunc &f)
+	{
+		auto &data = get_data();
+		for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+			auto sum = 0.f;
+			for(size_t i = 0; i < VALUE_COUNT; ++i)
+				sum += f(data, i);
+			bench::do_not_optimize(sum);
+		}
+		state.SetItemsPerIteration(VALUE_COUNT);
+	}
+	template<class TFunc>
+	void run_vector(bench::State &state, const TFunc &f)
+	{
+		auto &data = get_data();
+		std::vector<Vector3> out(VALUE_COUNT);
+		for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+			for(size_t i = 0; i < VALUE_COUNT; ++i)
+				out[i] = f(data, i);
+			bench::do_not_optimize(out);
+		}
+		state.SetItemsPerIteration(VALUE_COUNT);
+	}
+};
+
+MATHUTIL_BENCHMARK(Uvec_Dot) { run_scalar(state, [](const InlineData &d, size_t i) { return uvec::dot(d.a[i], d.b[i]); }); }
+MATHUTIL_BENCHMARK(Uvec_DotInline) { run_scalar(state, [](const InlineData &d, size_t i) { return uvec::inl::dot(d.a[i], d.b[i]); }); }
+MATHUTIL_BENCHMARK(Uvec_LengthSqr) { run_scalar(state, [](const InlineData &d, size_t i) { return uvec::length_sqr(d.a[i]); }); }
+MATHUTIL_BENCHMARK(Uvec_LengthSqrInline) { run_scalar(state, [](const InlineData &d, size_t i) { return uvec::inl::length_sqr(d.a[i]); }); }
+MATHUTIL_BENCHMARK(Uvec_DistanceSqr) { run_scalar(state, [](const InlineData &d, size_t i) { return uvec::distance_sqr(d.a[i], d.b[i]); }); }
+MATHUTIL_BENCHMARK(Uvec_DistanceSqrInline) { run_scalar(state, [](const InlineData &d, size_t i) { return uvec::inl::distance_sqr(d.a[i], d.b[i]); }); }
+MATHUTIL_BENCHMARK(Uvec_Cross) { run_vector(state, [](const InlineData &d, size_t i) { return uvec::cross(d.a[i], d.b[i]); }); }
+MATHUTIL_BENCHMARK(Uvec_CrossInline) { run_vector(state, [](const InlineData &d, size_t i) { return uvec::inl::cross(d.a[i], d.b[i]); }); }
+MATHUTIL_BENCHMARK(Uquat_DotProduct) { run_scalar(state, [](const InlineData &d, size_t i) { return uquat::dot_product(d.q[i], d.q[VALUE_COUNT - i - 1]); }); }
+MATHUTIL_BENCHMARK(Uquat_DotProductInline) { run_scalar(state, [](const InlineData &d, size_t i) { return uquat::inl::dot_product(d.q[i], d.q[VALUE_COUNT - i - 1]); }); }
+MATHUTIL_BENCHMARK(Uquat_Forward) { run_vector(state, [](const InlineData &d, size_t i) { return uquat::forward(d.q[i]); }); }
+MATHUTIL_BENCHMARK(Uquat_ForwardInline) { run_vector(state, [](const InlineData &d, size_t i) { return uquat::inl::forward(d.q[i]); }); }
+MATHUTIL_BENCHMARK(Uquat_Right) { run_vector(state, [](const InlineData &d, size_t i) { return uquat::right(d.q[i]); }); }
+MATHUTIL_BENCHMARK(Uquat_RightInline) { run_vector(state, [](const InlineData &d, size_t i) { return uquat::inl::right(d.q[i]); }); }
+MATHUTIL_BENCHMARK(Uquat_Up) { run_vector(state, [](const InlineData &d, size_t i) { return uquat::up(d.q[i]); }); }
+MATHUTIL_BENCHMARK(Uquat_UpInline) { run_vector(state, [](const InlineData &d, size_t i) { return uquat::inl::up(d.q[i]); }); }
@@ -0,0 +1,178 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bench_harness.hpp"
+#include "mathutil/umath_geometry.hpp"
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+	constexpr size_t BOX_COUNT = 1 << 12;
+	struct IntersectionData {
+		IntersectionData()
+		{
+			std::mt19937 rng {24};
+			std::uniform_real_distribution<float> dis {-50.f, 50.f};
+			std::uniform_real_distribution<float> disExtents {0.5f, 5.f};
+			for(size_t i = 0; i < BOX_COUNT; ++i) {
+				Vector3 center {dis(rng), dis(rng), dis(rng)};
+				Vector3 extents {disExtents(rng), disExtents(rng), disExtents(rng)};
+				mins.push_back(center - extents);
+				maxs.push_back(center + extents);
+				minX.push_back(mins.back().x);
+				minY.push_back(mins.back().y);
+				minZ.push_back(mins.back().z);
+				maxX.push_back(maxs.back().x);
+				maxY.push_back(maxs.back().y);
+				maxZ.push_back(maxs.back().z);
+				points.push_back({dis(rng), dis(rng), dis(rng)});
+				dirs.push_back(Vector3 {dis(rng), dis(rng), dis(rng)} * 2.f);
+				originX.push_back(points.back().x);
+				originY.push_back(points.back().y);
+				originZ.push_back(points.back().z);
+				dirInvX.push_back(1.f / dirs.back().x);
+				dirInvY.push_back(1.f / dirs.back().y);
+				dirInvZ.push_back(1.f / dirs.back().z);
+			}
+			frustum = umath::Frustum {Vector3 {}, Vector3 {0.f, 0.f, 1.f}, Vector3 {0.f, 1.f, 0.f}, 1.5f, 1.f, 60.f, 16.f / 9.f};
+			planes = frustum.ToPlanes();
+		}
+		umath::intersection::AABBSoAView GetAABBs() const { return {minX, minY, minZ, maxX, maxY, maxZ}; }
+		umath::intersection::LineSoAView GetLines() const { return {originX, originY, originZ, dirInvX, dirInvY, dirInvZ}; }
+		std::vector<Vector3> mins, maxs;
+		std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+		std::vector<Vector3> points, dirs;
+		std::vector<float> originX, originY, originZ, dirInvX, dirInvY, dirInvZ;
+		umath::Frustum frustum;
+		std::vector<umath::Plane> planes;
+	};
+	const IntersectionData &get_data()
+	{
+		static IntersectionData data;
+		return data;
+	}
+
+	// Runs f for every box and accumulates the results, so the calls can't be optimized away
+	template<class TFunc>
+	void run_boxes(bench::State &state, const TFunc &f)
+	{
+		auto &data = get_data();
+		for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+			uint32_t hits = 0;
+			for(size_t i = 0; i < BOX_COUNT; ++i)
+				hits += static_cast<uint32_t>(f(data, i));
+			bench::do_not_optimize(hits);
+		}
+		state.SetItemsPerIteration(BOX_COUNT);
+	}
+};
+
+using namespace umath;
+
+MATHUTIL_BENCHMARK(Intersection_AabbAabb)
+{
+	run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::aabb_aabb(d.mins[i], d.maxs[i], d.mins[BOX_COUNT - i - 1], d.maxs[BOX_COUNT - i - 1]); });
+}
+MATHUTIL_BENCHMARK(Intersection_AabbSphere) { run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::aabb_sphere(d.mins[i], d.maxs[i], d.points[i], 5.f); }); }
+MATHUTIL_BENCHMARK(Intersection_SphereSphere) { run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::sphere_sphere(d.points[i], 5.f, d.mins[i], 5.f); }); }
+MATHUTIL_BENCHMARK(Intersection_AabbPlane) { run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::aabb_plane(d.mins[i], d.maxs[i], uvec::get_normal(d.dirs[i]), 10.0); }); }
+MATHUTIL_BENCHMARK(Intersection_ObbPlane)
+{
+	run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::obb_plane(d.mins[i] - d.maxs[i], d.maxs[i] - d.mins[i], d.points[i], uquat::identity(), uvec::get_normal(d.dirs[i]), 10.0); });
+}
+MATHUTIL_BENCHMARK(Intersection_SpherePlane) { run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::sphere_plane(d.points[i], 5.f, uvec::get_normal(d.dirs[i]), 10.0); }); }
+MATHUTIL_BENCHMARK(Intersection_AabbTriangle)
+{
+	run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::aabb_triangle(d.mins[i], d.maxs[i], d.points[i], d.points[(i + 1) % BOX_COUNT], d.points[(i + 2) % BOX_COUNT]); });
+}
+MATHUTIL_BENCHMARK(Intersection_AabbTriangleBatch)
+{
+	auto &data = get_data();
+	// std::vector<bool> is bit-packed, so a plain array is used instead
+	auto results = std::make_unique<bool[]>(BOX_COUNT);
+	std::span<bool> out {results.get(), BOX_COUNT};
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		intersection::aabb_triangle(data.GetAABBs(), data.points[0], data.points[1], data.points[2], out);
+		bench::do_not_optimize(results);
+	}
+	state.SetItemsPerIteration(BOX_COUNT);
+}
+MATHUTIL_BENCHMARK(Intersection_LineAabb)
+{
+	run_boxes(state, [](const IntersectionData &d, size_t i) {
+		float tMin, tMax;
+		return intersection::line_aabb(d.points[0], d.dirs[0], d.mins[i], d.maxs[i], &tMin, &tMax) == intersection::Result::Intersect;
+	});
+}
+MATHUTIL_BENCHMARK(Intersection_LineAabbBatch)
+{
+	auto &data = get_data();
+	std::vector<uint64_t> hitMask((BOX_COUNT + 63) / 64);
+	std::vector<float> tMin(BOX_COUNT);
+	auto dirInv = 1.f / data.dirs[0];
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		intersection::line_aabb(data.points[0], dirInv, data.GetAABBs(), intersection::LineAABBResults {hitMask, {}, tMin, {}});
+		bench::do_not_optimize(hitMask);
+		bench::do_not_optimize(tMin);
+	}
+	state.SetItemsPerIteration(BOX_COUNT);
+}
+MATHUTIL_BENCHMARK(Intersection_LinesAabbBatch)
+{
+	auto &data = get_data();
+	std::vector<uint64_t> hitMask((BOX_COUNT + 63) / 64);
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		intersection::line_aabb(data.GetLines(), data.mins[0], data.maxs[0], intersection::LineAABBResults {hitMask, {}, {}, {}});
+		bench::do_not_optimize(hitMask);
+	}
+	state.SetItemsPerIteration(BOX_COUNT);
+}
+MATHUTIL_BENCHMARK(Intersection_LineObb)
+{
+	run_boxes(state, [](const IntersectionData &d, size_t i) {
+		float dist;
+		return intersection::line_obb(d.points[0], d.dirs[0], d.mins[i] - d.maxs[i], d.maxs[i] - d.mins[i], &dist, d.points[i], uquat::identity());
+	});
+}
+MATHUTIL_BENCHMARK(Intersection_LinePlane)
+{
+	run_boxes(state, [](const IntersectionData &d, size_t i) {
+		float t;
+		return intersection::line_plane(d.points[i], d.dirs[i], uvec::get_normal(d.dirs[0]), 10.f, &t) == intersection::Result::Intersect;
+	});
+}
+MATHUTIL_BENCHMARK(Intersection_LineSphere)
+{
+	run_boxes(state, [](const IntersectionData &d, size_t i) {
+		float t;
+		Vector3 p;
+		return intersection::line_sphere(d.points[0], d.dirs[0], d.points[i], 5.f, t, p);
+	});
+}
+MATHUTIL_BENCHMARK(Intersection_LineTriangle)
+{
+	run_boxes(state, [](const IntersectionData &d, size_t i) {
+		double t, u, v;
+		return intersection::line_triangle(d.points[0], d.dirs[0], d.mins[i], d.maxs[i], d.points[i], t, u, v);
+	});
+}
+MATHUTIL_BENCHMARK(Intersection_SphereCone)
+{
+	run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::sphere_cone(d.points[i], 5.f, Vector3 {}, Vector3 {0.f, 0.f, 1.f}, 0.5f, 60.f); });
+}
+MATHUTIL_BENCHMARK(Intersection_AabbInPlaneMesh) { run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::aabb_in_plane_mesh(d.mins[i], d.maxs[i], d.planes); }); }
+MATHUTIL_BENCHMARK(Intersection_AabbInPlaneMeshFrustum) { run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::aabb_in_plane_mesh(d.mins[i], d.maxs[i], d.frustum); }); }
+MATHUTIL_BENCHMARK(Intersection_AabbInPlaneMeshBatch)
+{
+	auto &data = get_data();
+	std::vector<umath::intersection::Intersect> results(BOX_COUNT);
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		intersection::aabb_in_plane_mesh(data.GetAABBs(), data.frustum, results);
+		bench::do_not_optimize(results);
+	}
+	state.SetItemsPerIteration(BOX_COUNT);
+}
+MATHUTIL_BENCHMARK(Intersection_SphereInPlaneMesh) { run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::sphere_in_plane_mesh(d.points[i], 5.f, d.planes); }); }
+MATHUTIL_BENCHMARK(Intersection_PointInPlaneMesh) { run_boxes(state, [](const IntersectionData &d, size_t i) { return intersection::point_in_plane_mesh(d.points[i], d.planes); }); }
@@ -0,0 +1,96 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bench_harness.hpp"
+#include "mathutil/umath_float_compressor.h"
+#include "mathutil/umath_float16_compressor.h"
+#include "mathutil/perlin_noise.hpp"
+#include <random>
+#include <vector>
+
+namespace {
+	constexpr size_t VALUE_COUNT = 1 << 14;
+	const std::vector<float> &get_values()
+	{
+		static auto values = []() {
+			std::mt19937 rng {26};
+			std::uniform_real_distribution<float> dis {-100.f, 100.f};
+			std::vector<float> values(VALUE_COUNT);
+			for(auto &v : values)
+				v = dis(rng);
+			return values;
+		}();
+		return values;
+	}
+};
+
+MATHUTIL_BENCHMARK(FloatCompressor_Compress)
+{
+	FloatCompressor compressor {-100.f, 1e-4f, 100.f, 11};
+	auto &values = get_values();
+	std::vector<uint32_t> out(VALUE_COUNT);
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		for(size_t i = 0; i < VALUE_COUNT; ++i)
+			out[i] = compressor.compress(values[i]);
+		bench::do_not_optimize(out);
+	}
+	state.SetItemsPerIteration(VALUE_COUNT);
+}
+MATHUTIL_BENCHMARK(FloatCompressor_Decompress)
+{
+	FloatCompressor compressor {-100.f, 1e-4f, 100.f, 11};
+	auto &values = get_values();
+	std::vector<uint32_t> codes(VALUE_COUNT);
+	for(size_t i = 0; i < VALUE_COUNT; ++i)
+		codes[i] = compressor.compress(values[i]);
+	std::vector<float> out(VALUE_COUNT);
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		for(size_t i = 0; i < VALUE_COUNT; ++i)
+			out[i] = compressor.decompress(codes[i]);
+		bench::do_not_optimize(out);
+	}
+	state.SetItemsPerIteration(VALUE_COUNT);
+}
+MATHUTIL_BENCHMARK(Float16Compressor_Compress)
+{
+	auto &values = get_values();
+	std::vector<uint16_t> out(VALUE_COUNT);
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		for(size_t i = 0; i < VALUE_COUNT; ++i)
+			out[i] = Float16Compressor::compress(values[i]);
+		bench::do_not_optimize(out);
+	}
+	state.SetItemsPerIteration(VALUE_COUNT);
+}
+MATHUTIL_BENCHMARK(Float16Compressor_Decompress)
+{
+	auto &values = get_values();
+	std::vector<uint16_t> codes(VALUE_COUNT);
+	for(size_t i = 0; i < VALUE_COUNT; ++i)
+		codes[i] = Float16Compressor::compress(values[i]);
+	std::vector<float> out(VALUE_COUNT);
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		for(size_t i = 0; i < VALUE_COUNT; ++i)
+			out[i] = Float16Compressor::decompress(codes[i]);
+		bench::do_not_optimize(out);
+	}
+	state.SetItemsPerIteration(VALUE_COUNT);
+}
+
+MATHUTIL_BENCHMARK(PerlinNoise_GetNoise)
+{
+	umath::PerlinNoise noise {27};
+	constexpr uint32_t resolution = 32;
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		auto sum = 0.0;
+		for(uint32_t x = 0; x < resolution; ++x) {
+			for(uint32_t y = 0; y < resolution; ++y) {
+				for(uint32_t z = 0; z < 4; ++z)
+					sum += noise.GetNoise(x * 0.13, y * 0.17, z * 0.31);
+			}
+		}
+		bench::do_not_optimize(sum);
+	}
+	state.SetItemsPerIteration(resolution * resolution * 4);
+}
@@ -0,0 +1,70 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bench_harness.hpp"
+#include "mathutil/uquat.h"
+#include <random>
+#include <vector>
+
+namespace {
+	constexpr size_t QUAT_COUNT = 1 << 16;
+	struct QuatData {
+		QuatData()
+		{
+			std::mt19937 rng {21};
+			std::uniform_real_distribution<float> dis {-1.f, 1.f};
+			for(size_t i = 0; i < QUAT_COUNT; ++i) {
+				q1.push_back(uquat::create(uvec::get_normal(Vector3 {dis(rng), dis(rng), dis(rng) + 2.f}), dis(rng) * 3.f));
+				q2.push_back(uquat::create(uvec::get_normal(Vector3 {dis(rng), dis(rng), dis(rng) + 2.f}), dis(rng) * 3.f));
+				factors.push_back(dis(rng) * 0.5f + 0.5f);
+			}
+		}
+		std::vector<Quat> q1;
+		std::vector<Quat> q2;
+		std::vector<float> factors;
+	};
+	const QuatData &get_data()
+	{
+		static QuatData data;
+		return data;
+	}
+
+	template<class TFunc>
+	void run_pairs(bench::State &state, const TFunc &f)
+	{
+		auto &data = get_data();
+		std::vector<Quat> out(QUAT_COUNT);
+		for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+			f(data, out);
+			bench::do_not_optimize(out);
+		}
+		state.SetItemsPerIteration(QUAT_COUNT);
+	}
+};
+
+MATHUTIL_BENCHMARK(Quat_Slerp)
+{
+	run_pairs(state, [](const QuatData &data, std::vector<Quat> &out) {
+		for(size_t i = 0; i < out.size(); ++i)
+			out[i] = uquat::slerp(data.q1[i], data.q2[i], 0.35f);
+	});
+}
+MATHUTIL_BENCHMARK(Quat_SlerpBatch) { run_pairs(state, [](const QuatData &data, std::vector<Quat> &out) { uquat::slerp(data.q1, data.q2, 0.35f, out); }); }
+MATHUTIL_BENCHMARK(Quat_SlerpBatchFactors) { run_pairs(state, [](const QuatData &data, std::vector<Quat> &out) { uquat::slerp(data.q1[0], data.q2[0], data.factors, out); }); }
+MATHUTIL_BENCHMARK(Quat_SlerpFast)
+{
+	run_pairs(state, [](const QuatData &data, std::vector<Quat> &out) {
+		for(size_t i = 0; i < out.size(); ++i)
+			out[i] = uquat::slerp_fast(data.q1[i], data.q2[i], 0.35f);
+	});
+}
+MATHUTIL_BENCHMARK(Quat_SlerpFastBatch) { run_pairs(state, [](const QuatData &data, std::vector<Quat> &out) { uquat::slerp_fast(data.q1, data.q2, 0.35f, out); }); }
+MATHUTIL_BENCHMARK(Quat_Nlerp)
+{
+	run_pairs(state, [](const QuatData &data, std::vector<Quat> &out) {
+		for(size_t i = 0; i < out.size(); ++i)
+			out[i] = uquat::nlerp(data.q1[i], data.q2[i], 0.35f);
+	});
+}
+MATHUTIL_BENCHMARK(Quat_NlerpBatch) { run_pairs(state, [](const QuatData &data, std::vector<Quat> &out) { uquat::nlerp(data.q1, data.q2, 0.35f, out); }); }
@@ -0,0 +1,115 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bench_harness.hpp"
+#include "mathutil/transform.hpp"
+#include "mathutil/transform_compression.hpp"
+#include <random>
+#include <vector>
+
+namespace {
+	constexpr size_t TRANSFORM_COUNT = 1 << 16;
+	// The same transforms (with uniform scale) in both representations
+	struct TransformData {
+		TransformData()
+		{
+			std::mt19937 rng {19};
+			std::uniform_real_distribution<float> dis {-10.f, 10.f};
+			std::uniform_real_distribution<float> disScale {0.5f, 2.f};
+			for(size_t i = 0; i < TRANSFORM_COUNT; ++i) {
+				auto rot = uquat::create(uvec::get_normal(Vector3 {dis(rng), dis(rng), dis(rng)}), dis(rng));
+				umath::UniformScaledTransform t {Vector3 {dis(rng), dis(rng), dis(rng)}, rot, disScale(rng)};
+				uniform.push_back(t);
+				scaled.push_back(umath::ScaledTransform {t});
+				points.push_back({dis(rng), dis(rng), dis(rng)});
+			}
+		}
+		std::vector<umath::ScaledTransform> scaled;
+		std::vector<umath::UniformScaledTransform> uniform;
+		std::vector<Vector3> points;
+	};
+	const TransformData &get_data()
+	{
+		static TransformData data;
+		return data;
+	}
+
+	template<class TTransform>
+	const std::vector<TTransform> &get_transforms()
+	{
+		if constexpr(std::is_same_v<TTransform, umath::ScaledTransform>)
+			return get_data().scaled;
+		else
+			return get_data().uniform;
+	}
+
+	template<class TTransform>
+	void compose(bench::State &state)
+	{
+		auto &transforms = get_transforms<TTransform>();
+		std::vector<TTransform> out(transforms.size());
+		for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+			for(size_t i = 0; i < transforms.size(); ++i)
+				out[i] = transforms[i] * transforms[transforms.size() - i - 1];
+			bench::do_not_optimize(out);
+		}
+		state.SetItemsPerIteration(transforms.size());
+	}
+
+	template<class TTransform>
+	void inverse(bench::State &state)
+	{
+		auto &transforms = get_transforms<TTransform>();
+		std::vector<TTransform> out(transforms.size());
+		for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+			for(size_t i = 0; i < transforms.size(); ++i)
+				out[i] = transforms[i].GetInverse();
+			bench::do_not_optimize(out);
+		}
+		state.SetItemsPerIteration(transforms.size());
+	}
+
+	template<class TTransform>
+	void transform_points(bench::State &state)
+	{
+		auto &transforms = get_transforms<TTransform>();
+		auto &points = get_data().points;
+		std::vector<Vector3> out(transforms.size());
+		for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+			for(size_t i = 0; i < transforms.size(); ++i)
+				out[i] = transforms[i] * points[i];
+			bench::do_not_optimize(out);
+		}
+		state.SetItemsPerIteration(transforms.size());
+	}
+};
+
+MATHUTIL_BENCHMARK(Transform_Compose)
+{
+	auto &transforms = get_data().scaled;
+	std::vector<umath::Transform> out(transforms.size());
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		for(size_t i = 0; i < transforms.size(); ++i)
+			out[i] = static_cast<const umath::Transform &>(transforms[i]) * static_cast<const umath::Transform &>(transforms[transforms.size() - i - 1]);
+		bench::do_not_optimize(out);
+	}
+	state.SetItemsPerIteration(transforms.size());
+}
+MATHUTIL_BENCHMARK(ScaledTransform_Compose) { compose<umath::ScaledTransform>(state); }
+MATHUTIL_BENCHMARK(UniformScaledTransform_Compose) { compose<umath::UniformScaledTransform>(state); }
+MATHUTIL_BENCHMARK(ScaledTransform_Inverse) { inverse<umath::ScaledTransform>(state); }
+MATHUTIL_BENCHMARK(UniformScaledTransform_Inverse) { inverse<umath::UniformScaledTransform>(state); }
+MATHUTIL_BENCHMARK(ScaledTransform_TransformPoint) { transform_points<umath::ScaledTransform>(state); }
+MATHUTIL_BENCHMARK(UniformScaledTransform_TransformPoint) { transform_points<umath::UniformScaledTransform>(state); }
+
+MATHUTIL_BENCHMARK(CompressedTransformStream_Decode)
+{
+	umath::CompressedTransformStream stream {get_data().scaled};
+	std::vector<umath::ScaledTransform> out(stream.GetCount());
+	for(uint64_t it = 0; it < state.GetIterations(); ++it) {
+		stream.Decode(out);
+		bench::do_not_optimize(out);
+	}
+	state.SetItemsPerIteration(out.size());
+}
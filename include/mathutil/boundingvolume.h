@@ -9,10 +9,17 @@
 #include "umath.h"
 #include "uvec.h"
 #include "uquat.h"
+#include <limits>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
 
 #pragma warning(disable : 4251)
 namespace umath {
 	class ScaledTransform;
+	class Frustum;
+	class Plane;
 };
 namespace bounding_volume {
 	class DLLMUTIL Sphere {
@@ -60,6 +67,177 @@ namespace bounding_volume {
 		OBB();
 		Quat rotation;
 	};
+
+	// Node of a flattened bounding volume hierarchy. Nodes are stored in depth-first order: The left child
+	// of an inner node directly follows its parent, the right child is located at 'index'.
+	// Leaf nodes have a non-zero primitive count and reference the primitives [index, index + count).
+	struct DLLMUTIL BVHNode {
+		// Upper bound for the depth of a tree, which is also the traversal stack size
+		static constexpr uint32_t MAX_DEPTH = 64;
+		Vector3 min;
+		uint32_t index;
+		Vector3 max;
+		uint32_t count;
+		bool IsLeaf() const { return count > 0; }
+	};
+
+	// Static bounding volume hierarchy over a set of AABBs, built with the surface area heuristic.
+	// Every AABB has a user payload (e.g. an object index), which is returned by the queries.
+	class DLLMUTIL BVH {
+	  public:
+		struct RayHit {
+			uint32_t payload;
+			float t; // Entry distance in units of the ray direction, clamped to 0 if the ray starts inside the box
+		};
+		static constexpr uint32_t DEFAULT_MAX_LEAF_SIZE = 4;
+
+		BVH() = default;
+		// If no payloads are specified, the index of the AABB is used as payload.
+		// With a threadCount other than 1, the hierarchy is built in parallel (0 = one thread per hardware thread). The result
+		// is identical to the single-threaded build. Worker threads are only started for large inputs and only for the duration of the build.
+		BVH(std::span<const AABB> aabbs, std::span<const uint32_t> payloads = {}, uint32_t maxLeafSize = DEFAULT_MAX_LEAF_SIZE, uint32_t threadCount = 1);
+		void Build(std::span<const AABB> aabbs, std::span<const uint32_t> payloads = {}, uint32_t maxLeafSize = DEFAULT_MAX_LEAF_SIZE, uint32_t threadCount = 1);
+		void Clear();
+		bool IsEmpty() const { return m_nodes.empty(); }
+
+		const std::vector<BVHNode> &GetNodes() const { return m_nodes; }
+		// Primitive AABBs and payloads in leaf order
+		const std::vector<AABB> &GetPrimitives() const { return m_primitives; }
+		const std::vector<uint32_t> &GetPayloads() const { return m_payloads; }
+
+		// Rays are tested with the same semantics as umath::intersection::line_aabb, only hits in the range [0, maxDist] are reported.
+		std::optional<RayHit> FindClosestRayHit(const Vector3 &origin, const Vector3 &dir, float maxDist = std::numeric_limits<float>::max()) const;
+		// Hits are appended to outHits in no particular order
+		void FindRayHits(const Vector3 &origin, const Vector3 &dir, std::vector<RayHit> &outHits, float maxDist = std::numeric_limits<float>::max()) const;
+		// The payloads of all AABBs overlapping the sphere / frustum are appended to outPayloads
+		void FindSphereOverlaps(const Vector3 &origin, float radius, std::vector<uint32_t> &outPayloads) const;
+		void FindFrustumOverlaps(const umath::Frustum &frustum, std::vector<uint32_t> &outPayloads) const;
+		void FindFrustumOverlaps(const std::vector<umath::Plane> &planes, std::vector<uint32_t> &outPayloads) const;
+	  private:
+		std::vector<BVHNode> m_nodes;
+		std::vector<AABB> m_primitives;
+		std::vector<uint32_t> m_payloads;
+	};
+
+	// Dynamic AABB tree for moving objects. Each proxy is stored with a fattened AABB, so small movements
+	// don't require an update of the tree. Insertion picks the sibling with the lowest surface area cost and the
+	// tree is kept balanced with rotations, so all updates are O(log n).
+	class DLLMUTIL DynamicAABBTree {
+	  public:
+		using ProxyId = uint32_t;
+		static constexpr ProxyId INVALID_PROXY = std::numeric_limits<ProxyId>::max();
+		static constexpr float DEFAULT_FAT_MARGIN = 0.1f;
+		// Factor by which the fattened AABB is extended in the direction of the displacement specified in Move
+		static constexpr float DISPLACEMENT_MULTIPLIER = 2.f;
+
+		DynamicAABBTree(float fatMargin = DEFAULT_FAT_MARGIN);
+		ProxyId Insert(const AABB &aabb, uint32_t payload);
+		void Remove(ProxyId proxyId);
+		// Returns true if the proxy had to be re-inserted, which is only the case if the new AABB is no longer
+		// contained in the fattened one.
+		bool Move(ProxyId proxyId, const AABB &aabb, const Vector3 &displacement = {});
+		void Clear();
+
+		const AABB &GetFatAABB(ProxyId proxyId) const;
+		uint32_t GetPayload(ProxyId proxyId) const;
+		size_t GetProxyCount() const { return m_proxyCount; }
+		// Height of the tree, 0 for a single leaf and -1 for an empty tree
+		int32_t GetHeight() const;
+
+		// Appends the payloads of all proxies whose fattened AABB overlaps the specified one
+		void Query(const AABB &aabb, std::vector<uint32_t> &outPayloads) const;
+		// Appends the payload pairs of all proxies with overlapping fattened AABBs. Every pair is reported once.
+		void FindOverlappingPairs(std::vector<std::pair<uint32_t, uint32_t>> &outPairs) const;
+	  private:
+		static constexpr uint32_t INVALID_NODE = std::numeric_limits<uint32_t>::max();
+		struct Node {
+			AABB aabb;
+			uint32_t parent; // Next free node if the node is unused
+			uint32_t child1;
+			uint32_t child2;
+			int32_t height; // 0 for leaves, -1 for unused nodes
+			uint32_t payload;
+			bool IsLeaf() const { return child1 == INVALID_NODE; }
+		};
+		uint32_t AllocateNode();
+		void FreeNode(uint32_t nodeId);
+		void InsertLeaf(uint32_t leafId);
+		void RemoveLeaf(uint32_t leafId);
+		uint32_t Balance(uint32_t nodeId);
+		void Refit(uint32_t nodeId);
+		template<class TCallback>
+		void QueryNodes(const AABB &aabb, std::vector<uint32_t> &stack, const TCallback &callback) const;
+
+		std::vector<Node> m_nodes;
+		uint32_t m_root = INVALID_NODE;
+		uint32_t m_freeList = INVALID_NODE;
+		size_t m_proxyCount = 0;
+		float m_fatMargin;
+	};
+
+	// Sweep-and-prune broadphase. The bounds of all proxies are projected onto the three axes and the endpoint arrays
+	// are kept sorted across updates with insertion sort, which is close to linear if the proxies move coherently between frames.
+	// Every proxy can have a displacement for the current step, in which case its swept bounds (the union of the bounds at the
+	// start and at the end of the step) are used.
+	class DLLMUTIL SweepAndPrune {
+	  public:
+		using ProxyId = uint32_t;
+		static constexpr ProxyId INVALID_PROXY = std::numeric_limits<ProxyId>::max();
+		struct SweptCollision {
+			uint32_t payloadA;
+			uint32_t payloadB;
+			float entryTime; // Fraction of the step at which the proxies start to overlap, 0 if they already overlap at the start
+			Vector3 normal;  // Collision normal of A, see umath::sweep::aabb_with_aabb
+		};
+
+		ProxyId Insert(const AABB &aabb, uint32_t payload, const Vector3 &displacement = {});
+		void Remove(ProxyId proxyId);
+		// Sets the bounds at the start of the step and the displacement during the step
+		void Update(ProxyId proxyId, const AABB &aabb, const Vector3 &displacement = {});
+		void Clear();
+
+		const AABB &GetAABB(ProxyId proxyId) const;
+		const Vector3 &GetDisplacement(ProxyId proxyId) const;
+		// Union of the bounds at the start and at the end of the step
+		const AABB &GetSweptAABB(ProxyId proxyId) const;
+		uint32_t GetPayload(ProxyId proxyId) const;
+		size_t GetProxyCount() const { return m_proxyCount; }
+
+		// Replaces the contents of outPairs with the payload pairs of all proxies with overlapping swept bounds, every pair is
+		// reported once. Bounds that only touch are considered overlapping.
+		// The capacity of outPairs is retained, so the same buffer can be passed every frame without reallocations.
+		void FindOverlappingPairs(std::vector<std::pair<uint32_t, uint32_t>> &outPairs);
+		// Continuous mode: Runs umath::sweep::aabb_with_aabb for all proxy pairs with overlapping swept bounds and replaces the contents
+		// of outCollisions with the pairs that collide during the step.
+		void FindSweptCollisions(std::vector<SweptCollision> &outCollisions);
+	  private:
+		struct Proxy {
+			AABB aabb;
+			Vector3 displacement;
+			AABB sweptAABB;
+			uint32_t payload;
+			bool valid;
+		};
+		// Min or max value of a proxy on one axis. The proxy id is stored in the upper 31 bits, the lowest bit is set for max endpoints.
+		struct Endpoint {
+			float value;
+			uint32_t data;
+		};
+		void UpdateEndpoints();
+		template<class TCallback>
+		void FindPairs(const TCallback &callback);
+
+		std::vector<Proxy> m_proxies;
+		std::vector<ProxyId> m_freeProxies;
+		// Proxies which have been removed since the last update, their endpoints are still in the endpoint arrays
+		std::vector<ProxyId> m_removedProxies;
+		std::vector<Endpoint> m_endpoints[3];
+		// Number of endpoints at the end of the endpoint arrays which have been added since the last update
+		size_t m_insertedEndpointCount = 0;
+		std::vector<ProxyId> m_activeProxies;
+		std::vector<uint32_t> m_activeIndices;
+		size_t m_proxyCount = 0;
+	};
 };
 #pragma warning(default : 4251)
 
@@ -0,0 +1,59 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UMATH_DUAL_QUAT_HPP__
+#define __UMATH_DUAL_QUAT_HPP__
+
+#include "mathutildefinitions.h"
+#include "mathutil/uvec.h"
+#include "mathutil/uquat.h"
+#include "mathutil/transform.hpp"
+#include "mathutil/vertex.hpp"
+#include <span>
+
+namespace umath {
+	// Rigid transformation (rotation + translation) as a dual quaternion. Unlike Transform, dual quaternions can be blended
+	// linearly (followed by a normalization), which makes them suitable for skinning. Scale is not supported.
+	class DLLMUTIL DualQuat {
+	  public:
+		constexpr DualQuat() : real {uquat::identity()}, dual {0.f, 0.f, 0.f, 0.f} {}
+		constexpr DualQuat(const Quat &real, const Quat &dual) : real {real}, dual {dual} {}
+		DualQuat(const Quat &rotation, const Vector3 &translation);
+		DualQuat(const Transform &t);
+
+		Transform ToTransform() const;
+		const Quat &GetRotation() const { return real; }
+		Vector3 GetTranslation() const;
+
+		// Same order as the Transform multiplication
+		DualQuat operator*(const DualQuat &other) const;
+		DualQuat &operator*=(const DualQuat &other);
+		// Component-wise, for blending. The result has to be normalized.
+		DualQuat operator*(float weight) const;
+		DualQuat operator+(const DualQuat &other) const;
+		DualQuat &operator+=(const DualQuat &other);
+
+		// Normalizes the real part and makes the dual part orthogonal to it
+		void Normalize();
+		DualQuat GetNormal() const;
+		// Only valid for normalized dual quaternions
+		DualQuat GetInverse() const;
+
+		Vector3 TransformPoint(const Vector3 &p) const;
+		// Only applies the rotation
+		Vector3 TransformVector(const Vector3 &v) const;
+		Vector3 operator*(const Vector3 &p) const { return TransformPoint(p); }
+
+		Quat real;
+		Quat dual;
+	};
+
+	// Dual quaternion skinning. For every vertex, the bone transforms are blended by the vertex weights, with the signs of the
+	// rotations aligned to the first bone, and the position (and normal, if specified) is transformed by the normalized result.
+	// Bones with a negative id are ignored. Vertices are processed in parallel SIMD lanes.
+	DLLMUTIL void skin_dual_quat(std::span<const DualQuat> boneTransforms, std::span<const VertexWeight> vertexWeights, std::span<const Vector3> positions, std::span<Vector3> outPositions, std::span<const Vector3> normals = {},
+	  std::span<Vector3> outNormals = {});
+};
+
+#endif
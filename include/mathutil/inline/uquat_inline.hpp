@@ -0,0 +1,18 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UQUAT_INLINE_HPP__
+#define __UQUAT_INLINE_HPP__
+
+#include "mathutil/glmutil.h"
+
+// Inline versions of small uquat functions for hot loops, see uvec_inline.hpp
+namespace uquat::inl {
+	constexpr Vector3 forward(const Quat &q) { return Vector3 {2 * (q.x * q.z + q.w * q.y), 2 * (q.y * q.z - q.w * q.x), 1 - 2 * (q.x * q.x + q.y * q.y)}; }
+	constexpr Vector3 right(const Quat &q) { return Vector3 {-(1 - 2 * (q.y * q.y + q.z * q.z)), -2 * (q.x * q.y + q.w * q.z), -2 * (q.x * q.z - q.w * q.y)}; }
+	constexpr Vector3 up(const Quat &q) { return Vector3 {2 * (q.x * q.y - q.w * q.z), 1 - 2 * (q.x * q.x + q.z * q.z), 2 * (q.y * q.z + q.w * q.x)}; }
+	constexpr float dot_product(const Quat &q1, const Quat &q2) { return (q1.w * q2.w + q1.x * q2.x) + (q1.y * q2.y + q1.z * q2.z); }
+};
+
+#endif
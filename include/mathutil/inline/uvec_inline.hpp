@@ -0,0 +1,19 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UVEC_INLINE_HPP__
+#define __UVEC_INLINE_HPP__
+
+#include "mathutil/glmutil.h"
+
+// Inline versions of small uvec functions for hot loops, included by uvec.h. The exported functions (uvec::dot, etc.) are implemented with these and
+// return the same results, but can't be inlined into the calling code if the library is built as a shared library.
+namespace uvec::inl {
+	constexpr float dot(const Vector3 &a, const Vector3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	constexpr float length_sqr(const Vector3 &v) { return dot(v, v); }
+	constexpr Vector3 cross(const Vector3 &a, const Vector3 &b) { return Vector3 {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x}; }
+	constexpr float distance_sqr(const Vector3 &p0, const Vector3 &p1) { return length_sqr(p1 - p0); }
+};
+
+#endif
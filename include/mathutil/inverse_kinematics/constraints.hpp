@@ -8,13 +8,38 @@
 #include "mathutil/mathutildefinitions.h"
 #include "mathutil/uvec.h"
 #include <optional>
+#include <variant>
 
 namespace uvec::ik {
 	class IkJoint;
+
+	// Plain parameters of the built-in constraint types, see IkHingeConstraint, IkBallSocketConstraint and IkTwistLimitConstraint.
+	// IkSolver and IkBatchSolver store the constraints of a chain as a flat array of these and apply them in a single pass.
+	struct DLLMUTIL IkHingeParams {
+		Vector3 axis {0.f, 0.f, 1.f};
+		std::optional<Vector2> limits {};
+	};
+	struct DLLMUTIL IkBallSocketParams {
+		float limit = 0.f; // Maximum angle in degrees between the joint's forward axis and the parent's
+	};
+	struct DLLMUTIL IkTwistLimitParams {
+		Vector3 axis {0.f, 0.f, 1.f}; // Twist axis in the joint's local space, has to be normalized
+		float limit = 0.f;           // Maximum twist angle in degrees around the axis relative to the parent, in either direction
+	};
+	using IkConstraintParams = std::variant<IkHingeParams, IkBallSocketParams, IkTwistLimitParams>;
+	struct DLLMUTIL IkJointConstraint {
+		uint32_t jointIndex; // Index within the chain
+		IkConstraintParams params;
+	};
+
 	class DLLMUTIL IkConstraint {
 	  public:
 		IkConstraint(IkJoint &joint) : m_joint {joint} {}
+		virtual ~IkConstraint() = default;
 		virtual void Apply(int i) = 0;
+		// Parameters of the built-in constraint types, which IkSolver applies without going through Apply.
+		// Custom constraints return an empty value and are applied through Apply after the built-in constraints of the same joint.
+		virtual std::optional<IkConstraintParams> GetParams() const { return {}; }
 		IkJoint &GetJoint() const { return m_joint; }
 	  public:
 		IkJoint &m_joint;
@@ -22,25 +47,44 @@ namespace uvec::ik {
 
 	class DLLMUTIL IkHingeConstraint : public IkConstraint {
 	  public:
-		IkHingeConstraint(IkJoint &joint, const Vector3 &axis) : IkConstraint {joint}, m_axis {axis} {}
+		IkHingeConstraint(IkJoint &joint, const Vector3 &axis) : IkConstraint {joint}, m_params {axis} {}
 		virtual void Apply(int i) override;
+		virtual std::optional<IkConstraintParams> GetParams() const override { return m_params; }
 		void SetLimits(const Vector2 &limits);
 		void ClearLimits();
 		std::optional<Vector2> GetLimits() const;
 	  private:
-		Vector3 m_axis {0.f, 0.f, 1.f};
-		std::optional<Vector2> m_limits {};
+		IkHingeParams m_params;
 	};
 
 	class DLLMUTIL IkBallSocketConstraint : public IkConstraint {
 	  public:
-		IkBallSocketConstraint(IkJoint &joint, float limit) : IkConstraint {joint}, m_limit {limit} {}
+		IkBallSocketConstraint(IkJoint &joint, float limit) : IkConstraint {joint}, m_params {limit} {}
+		virtual void Apply(int i) override;
+		virtual std::optional<IkConstraintParams> GetParams() const override { return m_params; }
+
+		void SetLimit(float limit);
+		bool GetLimit(float &outLimit) const
+		{
+			outLimit = m_params.limit;
+			return true;
+		}
+	  private:
+		IkBallSocketParams m_params;
+	};
+
+	// Limits the rotation of the joint around an axis (e.g. the forearm around the bone direction), the swing is unaffected
+	class DLLMUTIL IkTwistLimitConstraint : public IkConstraint {
+	  public:
+		IkTwistLimitConstraint(IkJoint &joint, const Vector3 &axis, float limit);
 		virtual void Apply(int i) override;
+		virtual std::optional<IkConstraintParams> GetParams() const override { return m_params; }
 
-		void SetLimit(float limit) { m_limit = limit; }
-		bool GetLimit(float &outLimit) const { return m_limit; }
+		void SetLimit(float limit);
+		float GetLimit() const { return m_params.limit; }
+		const Vector3 &GetAxis() const { return m_params.axis; }
 	  private:
-		float m_limit = 0.f;
+		IkTwistLimitParams m_params;
 	};
 };
 
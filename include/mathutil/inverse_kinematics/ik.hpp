@@ -9,7 +9,12 @@
 #include "mathutil/uvec.h"
 #include "mathutil/transform.hpp"
 #include "mathutil/inverse_kinematics/constraints.hpp"
+#include <array>
+#include <chrono>
 #include <memory>
+#include <span>
+#include <utility>
+#include <vector>
 
 namespace uvec::ik {
 	class IkConstraint;
@@ -18,14 +23,15 @@ namespace uvec::ik {
 	class DLLMUTIL IkJoint {
 	  public:
 		IkJoint() = default;
-		IkJoint(IkSolver &solver) : m_ikSolver {&solver} {}
+		IkJoint(IkSolver &solver, uint32_t chainIndex = 0) : m_ikSolver {&solver}, m_chainIndex {chainIndex} {}
 		IkJoint(const IkJoint &) = delete;
 		IkJoint &operator=(const IkJoint &) = delete;
-		IkJoint(IkJoint &&other) : m_ikSolver {other.m_ikSolver}, m_jointIndex {other.m_jointIndex}, m_constraints {std::move(other.m_constraints)}, m_pose {other.m_pose} {}
+		IkJoint(IkJoint &&other) : m_ikSolver {other.m_ikSolver}, m_jointIndex {other.m_jointIndex}, m_chainIndex {other.m_chainIndex}, m_constraints {std::move(other.m_constraints)}, m_pose {other.m_pose} {}
 		IkJoint &operator=(IkJoint &&other)
 		{
 			m_ikSolver = other.m_ikSolver;
 			m_jointIndex = other.m_jointIndex;
+			m_chainIndex = other.m_chainIndex;
 			m_constraints = std::move(other.m_constraints);
 			m_pose = other.m_pose;
 			return *this;
@@ -35,9 +41,12 @@ namespace uvec::ik {
 
 		void SetJointIndex(uint32_t jointIndex) { m_jointIndex = jointIndex; }
 		uint32_t GetJointIndex() const { return m_jointIndex; }
+		// Index of the joint within the chain of the solver
+		uint32_t GetChainIndex() const { return m_chainIndex; }
 
-		umath::ScaledTransform &GetPose() { return m_pose; }
-		const umath::ScaledTransform &GetPose() const { return const_cast<IkJoint *>(this)->GetPose(); }
+		// The non-const version invalidates the cached global transforms of the solver from this joint onwards
+		umath::ScaledTransform &GetPose();
+		const umath::ScaledTransform &GetPose() const { return m_pose; }
 
 		bool HasConstraints() const { return !m_constraints.empty(); }
 		IkConstraint &AddConstraint(std::unique_ptr<IkConstraint> constraint);
@@ -49,23 +58,66 @@ namespace uvec::ik {
 	  protected:
 		IkSolver *m_ikSolver = nullptr;
 		uint32_t m_jointIndex = 0;
+		uint32_t m_chainIndex = 0;
 		std::vector<std::unique_ptr<IkConstraint>> m_constraints;
 		umath::ScaledTransform m_pose {};
 	};
 
+	struct DLLMUTIL IkSolveStats {
+		uint32_t iterations = 0;
+		float residual = 0.f; // Remaining distance of the effector to its target (DLSSolver: norm of the weighted errors of all effectors)
+		std::chrono::nanoseconds duration {0};
+		bool solved = false;
+		bool warmStarted = false;
+	};
+
 	class DLLMUTIL IkSolver {
 	  public:
 		IkSolver() = default;
 		IkSolver(const IkSolver &) = delete;
 		IkSolver &operator=(const IkSolver &) = delete;
 		virtual ~IkSolver() = default;
-		umath::ScaledTransform GetGlobalTransform(unsigned int index) const;
+		// Global transforms are cached. Modifying a joint pose through this class or IkJoint::GetPose invalidates the
+		// cache from that joint onwards, and only the invalidated part is recomputed on the next query.
+		umath::ScaledTransform GetGlobalTransform(unsigned int index) const { return GetCachedGlobalTransform(index); }
+		const umath::ScaledTransform &GetCachedGlobalTransform(uint32_t index) const;
+		// Global transforms of all joints of the chain
+		std::span<const umath::ScaledTransform> GetGlobalTransforms() const;
+		// Has to be called if a joint pose was changed through a reference that was obtained before the last query
+		void InvalidateGlobalTransforms(uint32_t firstIndex = 0) { m_numValidGlobalTransforms = umath::min(m_numValidGlobalTransforms, firstIndex); }
 		umath::ScaledTransform &GetJointPose(uint32_t idx) { return mIKChain[idx].GetPose(); }
+		// Applies the constraints of all joints in joint order in a single pass over the chain
 		void ApplyConstraints();
+		// Applies the constraints of the specified joint
 		void ApplyConstraints(uint32_t iConstraint);
+		void ApplyConstraint(const IkJointConstraint &constraint);
+		// Parameters of the built-in constraints of all joints, sorted by joint. Custom constraints (see IkConstraint::GetParams) are not included.
+		std::span<const IkJointConstraint> GetConstraintData() const;
+		// Has to be called if constraints were added or their parameters were changed outside of IkJoint and the built-in constraint classes
+		void InvalidateConstraintData() { m_constraintDataDirty = true; }
 		unsigned int Size() { return mIKChain.size(); }
 		virtual void Resize(unsigned int newSize);
+		// Implementations have to call BeginSolve and EndSolve, otherwise no statistics are recorded
 		virtual bool Solve(const umath::ScaledTransform &target) = 0;
+		// The statistics are reset beforehand, so a solver that doesn't record any only reports whether it was solved
+		IkSolveStats SolveWithStats(const umath::ScaledTransform &target)
+		{
+			m_lastSolveStats = {};
+			m_lastSolveStats.solved = Solve(target);
+			return m_lastSolveStats;
+		}
+		// Statistics of the last call to Solve, see BeginSolve / EndSolve
+		const IkSolveStats &GetLastSolveStats() const { return m_lastSolveStats; }
+
+		// If enabled, the solutions of the last WARM_START_CACHE_SIZE targets are cached. A solve towards a target within the radius
+		// of a cached one starts with the rotations of that solution instead of the current pose, which usually requires far fewer
+		// iterations for targets that only move slightly between frames.
+		void SetWarmStartEnabled(bool enabled, float radius = 1.f);
+		bool IsWarmStartEnabled() const { return m_warmStartEnabled; }
+		void ClearWarmStartCache();
+		// Solving stops as soon as an iteration reduces the residual by less than epsilon (0 = always use all iterations)
+		void SetStallEpsilon(float epsilon) { m_stallEpsilon = epsilon; }
+		float GetStallEpsilon() const { return m_stallEpsilon; }
 
 		umath::ScaledTransform GetLocalTransform(unsigned int index);
 		void SetLocalTransform(unsigned int index, const umath::ScaledTransform &t);
@@ -73,7 +125,38 @@ namespace uvec::ik {
 		IkJoint &GetJoint(uint32_t i) { return mIKChain[i]; }
 		const IkJoint &GetJoint(uint32_t i) const { return const_cast<IkSolver *>(this)->GetJoint(i); }
 	  protected:
+		static constexpr uint32_t WARM_START_CACHE_SIZE = 4;
+		// To be called by the implementations of Solve. BeginSolve applies the warm start for the target,
+		// EndSolve updates the statistics and the warm start cache and returns solved.
+		void BeginSolve(const Vector3 &target);
+		bool EndSolve(uint32_t iterations, float residual, bool solved);
+		bool IsStalled(float prevResidual, float residual) const { return m_stallEpsilon > 0.f && prevResidual - residual < m_stallEpsilon; }
+
 		std::vector<IkJoint> mIKChain;
+	  private:
+		struct WarmStartEntry {
+			Vector3 target;
+			std::vector<Quat> rotations;
+			uint64_t lastUse = 0;
+		};
+		IkSolveStats m_lastSolveStats {};
+		std::chrono::steady_clock::time_point m_solveStart {};
+		Vector3 m_solveTarget {};
+		bool m_warmStartEnabled = false;
+		float m_warmStartRadius = 1.f;
+		float m_stallEpsilon = 0.f;
+		uint64_t m_solveIndex = 0;
+		std::array<WarmStartEntry, WARM_START_CACHE_SIZE> m_warmStartCache {};
+
+		// Global transforms of the joints [0, m_numValidGlobalTransforms) are up to date
+		mutable std::vector<umath::ScaledTransform> m_globalTransforms;
+		mutable uint32_t m_numValidGlobalTransforms = 0;
+
+		// Flattened copy of the constraints of the chain, rebuilt on demand
+		void UpdateConstraintData() const;
+		mutable std::vector<IkJointConstraint> m_constraintData;
+		mutable std::vector<std::pair<uint32_t, IkConstraint *>> m_customConstraints;
+		mutable bool m_constraintDataDirty = true;
 	};
 
 	class DLLMUTIL CCDSolver : public IkSolver {
@@ -115,6 +198,62 @@ namespace uvec::ik {
 		void IterateBackward(const Vector3 &base);
 		void WorldToIKChain();
 	};
+
+	struct DLLMUTIL IkEffector {
+		uint32_t jointIndex = 0;
+		umath::ScaledTransform target {};
+		// Relative weights of the position and orientation errors (position in units, orientation in radians).
+		// A weight of 0 ignores the respective part of the target.
+		float positionWeight = 1.f;
+		float rotationWeight = 0.f;
+	};
+
+	// Damped least squares solver, which moves all effectors towards their targets at once. Every joint is treated as a
+	// ball joint with three rotational degrees of freedom, so only the joints up to the deepest effector are affected.
+	// The Jacobian has a fixed maximum size and all scratch data is part of the solver, so solving doesn't allocate.
+	class DLLMUTIL DLSSolver : public IkSolver {
+	  public:
+		static constexpr uint32_t MAX_EFFECTORS = 4;
+		// Maximum joint index of an effector + 1
+		static constexpr uint32_t MAX_JOINTS = 32;
+
+		DLSSolver();
+
+		unsigned int GetNumSteps();
+		void SetNumSteps(unsigned int numSteps);
+
+		// Maximum distance of every effector to its target position
+		float GetThreshold();
+		void SetThreshold(float value);
+		// Maximum angle in degrees of every effector to its target rotation, only for effectors with a rotation weight
+		float GetAngleThreshold();
+		void SetAngleThreshold(float value);
+		// Higher values are more stable close to singular configurations (e.g. fully stretched chains) but converge more slowly
+		float GetDamping();
+		void SetDamping(float damping);
+
+		// Solves for the position and rotation of the last joint
+		virtual bool Solve(const umath::ScaledTransform &target) override;
+		// Returns false if the effectors haven't reached their targets or are invalid (more than MAX_EFFECTORS, or a joint index out of range)
+		bool Solve(std::span<const IkEffector> effectors);
+	  protected:
+		static constexpr uint32_t MAX_ROWS = MAX_EFFECTORS * 6;
+		static constexpr uint32_t MAX_COLUMNS = MAX_JOINTS * 3;
+		unsigned int mNumSteps;
+		float mThreshold;
+		float m_angleThreshold = 0.1f;
+		float m_damping = 0.5f;
+		// Row-major, only the upper left part is used
+		std::array<float, MAX_ROWS * MAX_COLUMNS> m_jacobian;
+		std::array<float, MAX_ROWS * MAX_ROWS> m_system;
+		std::array<float, MAX_ROWS> m_errors;
+		std::array<float, MAX_COLUMNS> m_deltas;
+	  private:
+		// outResidual is the norm of the weighted errors of all effectors
+		bool ComputeErrors(std::span<const IkEffector> effectors, uint32_t &outNumRows, float &outResidual);
+		void ComputeJacobian(std::span<const IkEffector> effectors);
+		bool ComputeDeltas(uint32_t numRows, uint32_t numColumns);
+	};
 };
 
 #endif
@@ -0,0 +1,95 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UMATH_INVERSE_KINEMATICS_BATCH_HPP__
+#define __UMATH_INVERSE_KINEMATICS_BATCH_HPP__
+
+#include "mathutil/mathutildefinitions.h"
+#include "mathutil/uvec.h"
+#include "mathutil/transform.hpp"
+#include "mathutil/inverse_kinematics/constraints.hpp"
+#include <memory>
+#include <span>
+#include <vector>
+
+#pragma warning(disable : 4251)
+namespace umath {
+	class TaskPool;
+};
+namespace uvec::ik {
+	enum class IkAlgorithm : uint8_t { CCD = 0, FABRIK };
+	struct DLLMUTIL IkChainSettings {
+		IkAlgorithm algorithm = IkAlgorithm::FABRIK;
+		uint32_t numSteps = 15;
+		float threshold = 0.00001f;
+	};
+
+	// Solves large numbers of independent chains (e.g. the limbs of a crowd) at once. The joints of all chains are stored
+	// in one structure-of-arrays pool and the chains are distributed over worker threads. Every chain is solved by a single
+	// thread, so the results are identical for any thread count.
+	// The algorithms match CCDSolver and FABRIKSolver, with the constraints applied in joint order like IkSolver::ApplyConstraints.
+	class DLLMUTIL IkBatchSolver {
+	  public:
+		using ChainId = uint32_t;
+		using Algorithm = IkAlgorithm;
+		using ChainSettings = IkChainSettings;
+		using JointConstraint = IkJointConstraint;
+
+		// threadCount: Number of threads used by Solve, including the calling thread (0 = one thread per hardware thread)
+		IkBatchSolver(uint32_t threadCount = 0);
+		~IkBatchSolver();
+		IkBatchSolver(const IkBatchSolver &) = delete;
+		IkBatchSolver &operator=(const IkBatchSolver &) = delete;
+
+		// Adds a chain with the specified local joint poses, the first joint is the root of the chain
+		ChainId AddChain(std::span<const umath::ScaledTransform> localPoses, std::span<const JointConstraint> constraints = {}, const ChainSettings &settings = {});
+		// Removes all chains, the memory of the pool is retained
+		void Clear();
+		size_t GetChainCount() const { return m_chains.size(); }
+		uint32_t GetJointCount(ChainId chainId) const { return m_chains[chainId].jointCount; }
+
+		void SetTarget(ChainId chainId, const Vector3 &target) { m_chains[chainId].target = target; }
+		const Vector3 &GetTarget(ChainId chainId) const { return m_chains[chainId].target; }
+		void SetLocalPose(ChainId chainId, uint32_t jointIndex, const umath::ScaledTransform &pose);
+		umath::ScaledTransform GetLocalPose(ChainId chainId, uint32_t jointIndex) const;
+		void GetLocalPoses(ChainId chainId, std::span<umath::ScaledTransform> outPoses) const;
+
+		// Solves all chains towards their targets and returns the number of chains that have reached their target
+		uint32_t Solve();
+		// Whether the chain reached its target in the last call to Solve
+		bool IsSolved(ChainId chainId) const { return m_chains[chainId].solved; }
+	  private:
+		struct Chain {
+			uint32_t firstJoint;
+			uint32_t jointCount;
+			uint32_t firstConstraint;
+			uint32_t constraintCount;
+			ChainSettings settings;
+			Vector3 target;
+			bool solved;
+		};
+		class ChainState;
+		bool SolveChain(const Chain &chain);
+		bool SolveCCD(ChainState &state, const Chain &chain);
+		bool SolveFABRIK(ChainState &state, const Chain &chain);
+
+		std::unique_ptr<umath::TaskPool> m_taskPool;
+		std::vector<Chain> m_chains;
+
+		// Local joint poses. The scales don't affect the solution and are only carried along.
+		std::vector<Vector3> m_positions;
+		std::vector<Quat> m_rotations;
+		std::vector<Vector3> m_scales;
+		// Scratch data per joint
+		std::vector<Vector3> m_worldPositions;
+		std::vector<Quat> m_worldRotations;
+		std::vector<Vector3> m_fabrikPositions;
+		std::vector<float> m_lengths;
+		// Constraints of all chains, sorted by joint within a chain
+		std::vector<JointConstraint> m_constraints;
+	};
+};
+#pragma warning(default : 4251)
+
+#endif
@@ -0,0 +1,82 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UMATH_PROFILING_HPP__
+#define __UMATH_PROFILING_HPP__
+
+#include "mathutildefinitions.h"
+#include <array>
+#include <chrono>
+#include <cinttypes>
+#include <string_view>
+
+// Call counters and latency histograms for the hot entry points of the library. The instrumentation is only compiled in if the
+// library was built with MATHUTIL_ENABLE_PROFILING, otherwise the instrumented functions are unchanged and all snapshots are empty.
+// The counters are kept per thread, so recording a call doesn't require any synchronization.
+namespace umath::profiling {
+	enum class Function : uint32_t {
+		LineAabb = 0,
+		LineAabbBatch,
+		AabbInPlaneMesh,
+		AabbInPlaneMeshBatch,
+		SphereInPlaneMesh,
+		AabbTriangle,
+		AabbTriangleBatch,
+		// IkSolver::Solve of all solvers, with the same duration as IkSolver::SolveStats
+		IkSolve,
+		IkBatchSolve,
+		ComputeWorldTransforms,
+		SkinDualQuat,
+
+		Count
+	};
+	static constexpr auto FUNCTION_COUNT = static_cast<uint32_t>(Function::Count);
+	// Bucket 0 holds calls that took less than 2ns, bucket i > 0 the ones in [2^i, 2^(i + 1)) ns. The last bucket also
+	// holds all longer calls.
+	static constexpr uint32_t HISTOGRAM_BUCKET_COUNT = 32;
+
+	struct DLLMUTIL FunctionStats {
+		static constexpr uint32_t GetBucketIndex(uint64_t nanoseconds)
+		{
+			uint32_t index = 0;
+			while(nanoseconds > 1 && index < HISTOGRAM_BUCKET_COUNT - 1) {
+				nanoseconds >>= 1;
+				++index;
+			}
+			return index;
+		}
+		static constexpr uint64_t GetBucketLowerBound(uint32_t index) { return (index == 0) ? 0 : (uint64_t {1} << index); }
+
+		double GetAverageNanoseconds() const;
+		// Upper bound of the bucket containing the given percentile in [0, 1], or 0 if there were no calls
+		uint64_t GetPercentileNanoseconds(double percentile) const;
+		FunctionStats &operator+=(const FunctionStats &other);
+
+		uint64_t callCount = 0;
+		uint64_t totalNanoseconds = 0;
+		std::array<uint64_t, HISTOGRAM_BUCKET_COUNT> histogram {};
+	};
+
+	struct DLLMUTIL Snapshot {
+		const FunctionStats &operator[](Function function) const { return functions[static_cast<uint32_t>(function)]; }
+		FunctionStats &operator[](Function function) { return functions[static_cast<uint32_t>(function)]; }
+		std::array<FunctionStats, FUNCTION_COUNT> functions {};
+	};
+
+	// True if the library was built with MATHUTIL_ENABLE_PROFILING
+	DLLMUTIL bool is_enabled();
+	DLLMUTIL std::string_view get_function_name(Function function);
+
+	// Counters of all threads since the last reset, including threads that have exited in the meantime
+	DLLMUTIL Snapshot get_snapshot();
+	// Counters of the calling thread since the last reset
+	DLLMUTIL Snapshot get_thread_snapshot();
+	// Resets the counters of all threads. Calls that finish on other threads while the reset is in progress may be counted on either side of it.
+	DLLMUTIL void reset();
+
+	// Adds a call to the counters of the calling thread. Used by the instrumented functions, no-op if profiling is disabled.
+	DLLMUTIL void record(Function function, std::chrono::nanoseconds duration);
+};
+
+#endif
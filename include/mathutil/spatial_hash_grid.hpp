@@ -0,0 +1,69 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __SPATIAL_HASH_GRID_HPP__
+#define __SPATIAL_HASH_GRID_HPP__
+
+#include "mathutildefinitions.h"
+#include "uvec.h"
+#include <limits>
+#include <span>
+#include <vector>
+
+#pragma warning(disable : 4251)
+namespace bounding_volume {
+	// Uniform grid for neighborhood queries of points and spheres, stored in a hash table with open addressing.
+	// Every item is assigned to the cell containing its center, the items of a cell are linked through a flat index array,
+	// so no per-cell containers are required. Clear retains all memory, so the grid can be rebuilt every frame without reallocations.
+	// The cell size should be in the order of the query radius; sphere radii larger than the cell size are supported but enlarge the queried area for all items.
+	class DLLMUTIL SpatialHashGrid {
+	  public:
+		SpatialHashGrid(float cellSize = 1.f);
+		// Changes the cell size, which also clears the grid
+		void SetCellSize(float cellSize);
+		float GetCellSize() const { return m_cellSize; }
+		// Reserves memory for the specified number of items and occupied cells
+		void Reserve(size_t itemCount);
+		void Clear();
+		size_t GetItemCount() const { return m_points.size(); }
+		size_t GetCellCount() const { return m_cellCount; }
+
+		// Appends a batch of points (or spheres, if radii are specified). If no payloads are specified, the index of the item
+		// within the grid (i.e. the number of previously inserted items + the index within the span) is used as payload.
+		void Insert(std::span<const Vector3> points, std::span<const float> radii = {}, std::span<const uint32_t> payloads = {});
+		void Insert(const Vector3 &point, float radius, uint32_t payload);
+
+		// Appends the payloads of all items overlapping the sphere (see umath::intersection::sphere_sphere) in no particular order
+		void FindSphereOverlaps(const Vector3 &origin, float radius, std::vector<uint32_t> &outPayloads) const;
+		// Appends the payloads of all items overlapping the box (see umath::intersection::aabb_sphere) in no particular order
+		void FindAABBOverlaps(const Vector3 &min, const Vector3 &max, std::vector<uint32_t> &outPayloads) const;
+	  private:
+		static constexpr uint32_t INVALID_ITEM = std::numeric_limits<uint32_t>::max();
+		struct Cell {
+			Vector3i coord;
+			uint32_t firstItem; // INVALID_ITEM for empty table slots
+		};
+		Vector3i GetCellCoordinates(const Vector3 &p) const;
+		const Cell *FindCell(const Vector3i &coord) const;
+		void InsertIntoCell(uint32_t itemIdx);
+		void Rehash(size_t capacity);
+		template<class TTest>
+		void FindOverlaps(const Vector3 &min, const Vector3 &max, const TTest &fTest, std::vector<uint32_t> &outPayloads) const;
+
+		float m_cellSize = 1.f;
+		float m_invCellSize = 1.f;
+		// Table size is always a power of two
+		std::vector<Cell> m_table;
+		size_t m_cellCount = 0;
+		float m_maxRadius = 0.f;
+
+		std::vector<Vector3> m_points;
+		std::vector<float> m_radii;
+		std::vector<uint32_t> m_payloads;
+		std::vector<uint32_t> m_nextItems; // Next item in the same cell
+	};
+};
+#pragma warning(default : 4251)
+
+#endif
@@ -16,6 +16,7 @@
 #include "mathutil/plane.hpp"
 #include <memory>
 #include <sharedutils/def_handle.h>
+#include <span>
 #include <vector>
 
 namespace umath {
@@ -30,6 +31,7 @@ namespace umath {
 	};
 
 	class ScaledTransform;
+	class UniformScaledTransform;
 	class DLLMUTIL Transform {
 	  public:
 		constexpr Transform() : translation {}, rotation {uquat::identity()} {}
@@ -91,6 +93,7 @@ namespace umath {
 		ScaledTransform(const Transform &t, const Vector3 &scale);
 		ScaledTransform(const Transform &t);
 		ScaledTransform(const Vector3 &pos, const Quat &rot, const Vector3 &scale);
+		ScaledTransform(const UniformScaledTransform &t);
 		void SetIdentity();
 		const Vector3 &GetScale() const;
 		Vector3 &GetScale();
@@ -122,6 +125,45 @@ namespace umath {
 	  public:
 		Vector3 scale = {1.f, 1.f, 1.f};
 	};
+
+	// ScaledTransform with the same scale on all axes. Follows the same conventions as ScaledTransform, but only has to deal with
+	// a single scale factor and inverts the rotation by conjugating it, so the rotation is expected to be normalized.
+	// Mixing it with ScaledTransforms requires an explicit conversion, otherwise it would be treated as an unscaled Transform.
+	class DLLMUTIL UniformScaledTransform : public Transform {
+	  public:
+		using Transform::Transform;
+		UniformScaledTransform(const Transform &t, float scale);
+		explicit UniformScaledTransform(const Transform &t);
+		UniformScaledTransform(const Vector3 &pos, const Quat &rot, float scale);
+		// Only the x component of the scale is used, the scale has to be uniform
+		explicit UniformScaledTransform(const ScaledTransform &t);
+		void SetIdentity();
+		float GetScale() const { return scale; }
+		void SetScale(float scale) { this->scale = scale; }
+		void Scale(float scale) { this->scale *= scale; }
+		void Interpolate(const UniformScaledTransform &dst, float factor);
+		UniformScaledTransform GetInverse() const;
+		UniformScaledTransform operator*(const UniformScaledTransform &tOther) const;
+		UniformScaledTransform &operator*=(const UniformScaledTransform &tOther);
+		Vector3 operator*(const Vector3 &translation) const;
+		Quat operator*(const Quat &rot) const;
+
+		Mat4 ToMatrix() const;
+
+		// Note: Getter/Setter methods should be preferred, these are public primarily to allow
+		// the class to be used as a literal non-type template parameter
+	  public:
+		float scale = 1.f;
+	};
+
+	// Computes the world transforms of a hierarchy (e.g. a skeleton) from its local transforms in a single pass.
+	// parentIndices contains the parent of every bone, which has to precede the bone, or -1 for root bones.
+	// Multiple instances of the same hierarchy can be processed at once by concatenating their local transforms; the instances
+	// are processed in parallel SIMD lanes. outWorldTransforms may be the same span as localTransforms.
+	// If outMatrices is specified, it receives the world transforms multiplied with the inverse bind poses of the bones
+	// (shared by all instances) as matrices, e.g. for skinning. Without inverse bind poses it receives the world matrices.
+	DLLMUTIL void compute_world_transforms(std::span<const int32_t> parentIndices, std::span<const ScaledTransform> localTransforms, std::span<ScaledTransform> outWorldTransforms, std::span<Mat4> outMatrices = {},
+	  std::span<const ScaledTransform> inverseBindPoses = {});
 };
 DLLMUTIL Vector3 operator*(const Vector3 &v, const umath::Transform &t);
 DLLMUTIL Vector3 &operator*=(Vector3 &v, const umath::Transform &t);
@@ -0,0 +1,68 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UMATH_TRANSFORM_COMPRESSION_HPP__
+#define __UMATH_TRANSFORM_COMPRESSION_HPP__
+
+#include "mathutildefinitions.h"
+#include "mathutil/transform.hpp"
+#include "mathutil/umath_float_compressor.h"
+#include <array>
+#include <cinttypes>
+#include <span>
+#include <vector>
+
+#pragma warning(disable : 4251)
+namespace umath {
+	// Quantized ScaledTransform, 18 bytes instead of 40
+	struct CompressedTransform {
+		std::array<uint16_t, 3> rotation;    // Smallest three, see compress_rotation
+		std::array<uint16_t, 3> translation; // FloatCompressor codes of the stream
+		std::array<uint16_t, 3> scale;       // Float16Compressor
+	};
+
+	// Smallest-three quaternion encoding in 48 bits: The largest component is dropped (and restored from the unit length on
+	// decompression) and the other three are quantized to 15 bits each in the range [-1/sqrt(2), 1/sqrt(2)].
+	// The index of the dropped component is stored in the remaining bits. The maximum error per component is about 2.2e-5.
+	DLLMUTIL std::array<uint16_t, 3> compress_rotation(const Quat &rot);
+	DLLMUTIL Quat decompress_rotation(const std::array<uint16_t, 3> &rot);
+
+	// Sequence of compressed transforms, e.g. the keys of an animation track. The translations of all keys share a
+	// FloatCompressor, whose range is determined from the largest absolute translation component on encoding. The translation
+	// precision is the number of mantissa bits that are kept, the epsilon (values below are flushed to zero) is chosen
+	// as small as possible while still fitting all codes into 16 bits.
+	class DLLMUTIL CompressedTransformStream {
+	  public:
+		static constexpr int DEFAULT_TRANSLATION_PRECISION = 11;
+		CompressedTransformStream();
+		CompressedTransformStream(std::span<const ScaledTransform> transforms, int translationPrecision = DEFAULT_TRANSLATION_PRECISION);
+		// Restores a stream from previously encoded data, e.g. after deserialization
+		CompressedTransformStream(std::vector<CompressedTransform> keys, float translationRange, float translationEpsilon, int translationPrecision);
+
+		void Encode(std::span<const ScaledTransform> transforms, int translationPrecision = DEFAULT_TRANSLATION_PRECISION);
+		// Decodes outTransforms.size() keys starting at the specified offset. The keys are decoded in blocks of the SIMD width.
+		void Decode(size_t offset, std::span<ScaledTransform> outTransforms) const;
+		void Decode(std::span<ScaledTransform> outTransforms) const { Decode(0, outTransforms); }
+		std::vector<ScaledTransform> Decode() const;
+		ScaledTransform Get(size_t index) const;
+
+		size_t GetCount() const { return m_keys.size(); }
+		const std::vector<CompressedTransform> &GetKeys() const { return m_keys; }
+		float GetTranslationRange() const { return m_translationRange; }
+		float GetTranslationEpsilon() const { return m_translationEpsilon; }
+		int GetTranslationPrecision() const { return m_translationPrecision; }
+	  private:
+		void InitializeTranslationCompressor(float range, float epsilon, int precision);
+
+		std::vector<CompressedTransform> m_keys;
+		float m_translationRange = 1.f;
+		float m_translationEpsilon = 0.f;
+		int m_translationPrecision = DEFAULT_TRANSLATION_PRECISION;
+		// FloatCompressor::decompress isn't const
+		mutable FloatCompressor m_translationCompressor {-1.f, 1.f, 1.f, DEFAULT_TRANSLATION_PRECISION};
+	};
+};
+#pragma warning(default : 4251)
+
+#endif
@@ -0,0 +1,83 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UMATH_TRANSFORM_SOA_HPP__
+#define __UMATH_TRANSFORM_SOA_HPP__
+
+#include "mathutildefinitions.h"
+#include "mathutil/transform.hpp"
+#include <cinttypes>
+#include <span>
+#include <vector>
+
+#pragma warning(disable : 4251)
+namespace umath {
+	// Structure-of-arrays container of ScaledTransforms. Every component is stored in its own array, which starts at a
+	// 32 byte boundary and is padded to a multiple of LANE_COUNT elements, so that the bulk operations can process 4 or 8
+	// transforms at once without scalar remainder loops. The padding elements hold identity transforms.
+	class DLLMUTIL TransformSoA {
+	  public:
+		static constexpr size_t ALIGNMENT = 32;
+		static constexpr size_t LANE_COUNT = 8;
+		enum class Component : uint8_t {
+			PositionX = 0,
+			PositionY,
+			PositionZ,
+			RotationW,
+			RotationX,
+			RotationY,
+			RotationZ,
+			ScaleX,
+			ScaleY,
+			ScaleZ,
+
+			Count
+		};
+
+		TransformSoA() = default;
+		TransformSoA(size_t count);
+		TransformSoA(std::span<const ScaledTransform> transforms);
+		TransformSoA(const TransformSoA &other);
+		TransformSoA(TransformSoA &&other) noexcept;
+		~TransformSoA();
+		TransformSoA &operator=(const TransformSoA &other);
+		TransformSoA &operator=(TransformSoA &&other) noexcept;
+
+		// New elements are identity transforms
+		void Resize(size_t count);
+		void Clear() { Resize(0); }
+		size_t GetCount() const { return m_count; }
+
+		void Assign(std::span<const ScaledTransform> transforms);
+		void CopyTo(std::span<ScaledTransform> outTransforms) const;
+		std::vector<ScaledTransform> ToVector() const;
+
+		void Set(size_t index, const ScaledTransform &t);
+		ScaledTransform Get(size_t index) const;
+		// GetCount elements, the array itself is padded to a multiple of LANE_COUNT
+		std::span<float> GetComponent(Component component) { return {GetComponentData(component), m_count}; }
+		std::span<const float> GetComponent(Component component) const { return {GetComponentData(component), m_count}; }
+
+		// Bulk versions of the ScaledTransform operations, applied to every element
+
+		// outPoints[i] = Get(i) * points[i]
+		void TransformPoints(std::span<const Vector3> points, std::span<Vector3> outPoints) const;
+		// Both containers have to have the same number of elements
+		void GetInverse(TransformSoA &outInverse) const;
+		void Interpolate(const TransformSoA &dst, float factor);
+		void ToMatrices(std::span<Mat4> outMatrices) const;
+	  private:
+		float *GetComponentData(Component component) { return m_data + static_cast<size_t>(component) * m_capacity; }
+		const float *GetComponentData(Component component) const { return m_data + static_cast<size_t>(component) * m_capacity; }
+		void Reallocate(size_t capacity);
+		void InitializeRange(size_t start, size_t end);
+
+		float *m_data = nullptr;
+		size_t m_count = 0;
+		size_t m_capacity = 0; // Elements per component array, a multiple of LANE_COUNT
+	};
+};
+#pragma warning(default : 4251)
+
+#endif
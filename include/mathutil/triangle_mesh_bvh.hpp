@@ -0,0 +1,67 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __TRIANGLE_MESH_BVH_HPP__
+#define __TRIANGLE_MESH_BVH_HPP__
+
+#include "mathutildefinitions.h"
+#include "boundingvolume.h"
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+#pragma warning(disable : 4251)
+namespace bounding_volume {
+	// Bounding volume hierarchy over the triangles of a mesh for ray casting. The triangle data is copied
+	// on construction, so the source buffers don't have to outlive the hierarchy.
+	// Triangles are intersected with the Moller-Trumbore algorithm in single precision, the results match
+	// umath::intersection::line_triangle within float tolerance.
+	class DLLMUTIL TriangleMeshBVH {
+	  public:
+		struct RayHit {
+			float t; // Hit distance in units of the ray direction
+			float u;
+			float v;
+			uint32_t triangleIndex; // Index of the triangle, i.e. the first vertex index is at indices[triangleIndex * 3]
+		};
+		// Number of rays traced together by the packet functions
+		static constexpr uint32_t PACKET_SIZE = 8;
+		static constexpr uint32_t DEFAULT_MAX_LEAF_SIZE = 4;
+
+		TriangleMeshBVH() = default;
+		// threadCount: See BVH::Build
+		TriangleMeshBVH(std::span<const Vector3> verts, std::span<const uint16_t> indices, uint32_t maxLeafSize = DEFAULT_MAX_LEAF_SIZE, uint32_t threadCount = 1);
+		TriangleMeshBVH(std::span<const Vector3> verts, std::span<const uint32_t> indices, uint32_t maxLeafSize = DEFAULT_MAX_LEAF_SIZE, uint32_t threadCount = 1);
+		void Build(std::span<const Vector3> verts, std::span<const uint16_t> indices, uint32_t maxLeafSize = DEFAULT_MAX_LEAF_SIZE, uint32_t threadCount = 1);
+		void Build(std::span<const Vector3> verts, std::span<const uint32_t> indices, uint32_t maxLeafSize = DEFAULT_MAX_LEAF_SIZE, uint32_t threadCount = 1);
+		void Clear();
+		bool IsEmpty() const { return m_nodes.empty(); }
+		size_t GetTriangleCount() const { return m_triangles.size(); }
+		const std::vector<BVHNode> &GetNodes() const { return m_nodes; }
+
+		// Returns the closest hit with t in [0, maxDist]. If cull is true, back-facing triangles are ignored (see line_triangle).
+		std::optional<RayHit> Raycast(const Vector3 &origin, const Vector3 &dir, float maxDist = std::numeric_limits<float>::max(), bool cull = false) const;
+		// Traces the rays in packets of PACKET_SIZE, which is considerably faster for coherent rays (e.g. screen-space picking).
+		// All spans must have the same size. Rays without a hit receive an empty optional.
+		void Raycast(std::span<const Vector3> origins, std::span<const Vector3> dirs, std::span<std::optional<RayHit>> outHits, float maxDist = std::numeric_limits<float>::max(), bool cull = false) const;
+	  private:
+		// Triangle in leaf order, pre-transformed for Moller-Trumbore
+		struct Triangle {
+			Vector3 v0;
+			Vector3 edge1;
+			Vector3 edge2;
+			uint32_t index;
+		};
+		template<typename TIndex>
+		void BuildFromIndices(std::span<const Vector3> verts, std::span<const TIndex> indices, uint32_t maxLeafSize, uint32_t threadCount);
+		void RaycastPacket(const Vector3 *origins, const Vector3 *dirs, std::optional<RayHit> *outHits, uint32_t count, float maxDist, bool cull) const;
+
+		std::vector<BVHNode> m_nodes;
+		std::vector<Triangle> m_triangles;
+	};
+};
+#pragma warning(default : 4251)
+
+#endif
@@ -8,7 +8,9 @@
 #include "mathutildefinitions.h"
 #include "umath.h"
 #include "uvec.h"
+#include "plane.hpp"
 #include <array>
+#include <vector>
 
 namespace umath {
 	namespace frustum {
@@ -17,6 +19,38 @@ namespace umath {
 		DLLMUTIL std::array<Vector3, 4> get_plane_boundaries(const Vector3 &pos, const Vector3 &forward, const Vector3 &up, float fovRad, float z, float aspectRatio, float *outFarW, float *outFarH);
 		DLLMUTIL Vector3 get_plane_point(const Vector3 &pos, const Vector3 &forward, const Vector3 &right, const Vector3 &up, float fovRad, float z, float aspectRatio, const Vector2 &uv);
 	};
+
+	// Compact frustum for culling. The planes are stored in structure-of-arrays order (normal x, y, z and distance),
+	// which allows testing them with SIMD and without heap allocations.
+	// Same convention as umath::Plane: Normals point outwards, a point p is inside if dot(n, p) - d <= 0 for all planes.
+	class DLLMUTIL Frustum {
+	  public:
+		enum class PlaneIndex : uint8_t { Left = 0, Right, Bottom, Top, Near, Far, Count };
+		static constexpr uint32_t PLANE_COUNT = 6;
+		// The arrays are padded to 8 entries for 8-wide SIMD, padding planes never cull anything
+		static constexpr uint32_t PADDED_PLANE_COUNT = 8;
+
+		Frustum();
+		// Extracts the planes from a view-projection matrix (with a depth range of [0,1])
+		Frustum(const Mat4 &viewProjection);
+		// Constructs the planes from the near and far plane boundaries, see umath::frustum::get_plane_boundaries
+		Frustum(const Vector3 &pos, const Vector3 &forward, const Vector3 &up, float fovRad, float nearZ, float farZ, float aspectRatio);
+		// Up to PLANE_COUNT planes are used, missing planes are filled with padding planes
+		Frustum(const std::vector<Plane> &planes);
+
+		void SetPlane(PlaneIndex idx, const Vector3 &n, float d);
+		void SetPlane(PlaneIndex idx, const Plane &plane);
+		Plane GetPlane(PlaneIndex idx) const;
+		Vector4 GetPlaneVector(PlaneIndex idx) const;
+		std::vector<Plane> ToPlanes() const;
+
+		// Note: Getter/Setter methods should be preferred, these are public primarily for the batch intersection functions
+	  public:
+		alignas(32) std::array<float, PADDED_PLANE_COUNT> normalX;
+		alignas(32) std::array<float, PADDED_PLANE_COUNT> normalY;
+		alignas(32) std::array<float, PADDED_PLANE_COUNT> normalZ;
+		alignas(32) std::array<float, PADDED_PLANE_COUNT> distance;
+	};
 };
 
 #endif
@@ -9,9 +9,11 @@
 #include "uvec.h"
 #include "boundingvolume.h"
 #include "plane.hpp"
+#include "umath_frustum.hpp"
 #include <functional>
 #include <optional>
 #include <string>
+#include <span>
 
 namespace umath::intersection {
 	enum class Result : uint32_t {
@@ -42,6 +44,62 @@ namespace umath::intersection {
 	DLLMUTIL bool point_in_plane_mesh(const Vector3 &vec, const std::vector<Plane> &planes);
 	DLLMUTIL Intersect sphere_in_plane_mesh(const Vector3 &vec, float radius, const std::vector<Plane> &planes, bool skipInsideTest = false);
 	DLLMUTIL Intersect aabb_in_plane_mesh(const Vector3 &min, const Vector3 &max, const std::vector<Plane> &planes);
+
+	// Non-owning structure-of-arrays view over a set of axis-aligned bounding boxes. All spans must have the same size.
+	struct DLLMUTIL AABBSoAView {
+		std::span<const float> minX;
+		std::span<const float> minY;
+		std::span<const float> minZ;
+		std::span<const float> maxX;
+		std::span<const float> maxY;
+		std::span<const float> maxZ;
+		size_t size() const { return minX.size(); }
+	};
+	// Batched version of aabb_in_plane_mesh, which tests all boxes against the planes using SIMD and writes one result per box
+	// into outResults (which must be at least as large as the number of boxes). Results are identical to calling aabb_in_plane_mesh for each box individually.
+	DLLMUTIL void aabb_in_plane_mesh(const AABBSoAView &aabbs, const std::vector<Plane> &planes, std::span<Intersect> outResults);
+
+	// Overloads for umath::Frustum, which test all planes at once with SIMD and don't allocate any memory.
+	// The results match the std::vector<Plane> versions for normalized plane normals.
+	DLLMUTIL bool point_in_plane_mesh(const Vector3 &vec, const Frustum &frustum);
+	DLLMUTIL Intersect sphere_in_plane_mesh(const Vector3 &vec, float radius, const Frustum &frustum, bool skipInsideTest = false);
+	DLLMUTIL Intersect aabb_in_plane_mesh(const Vector3 &min, const Vector3 &max, const Frustum &frustum);
+	DLLMUTIL void aabb_in_plane_mesh(const AABBSoAView &aabbs, const Frustum &frustum, std::span<Intersect> outResults);
+
+	// Batched versions of aabb_triangle with SIMD. Results are identical to calling aabb_triangle for each box / triangle individually.
+	// Tests one triangle against all boxes, outResults must be at least as large as the number of boxes
+	DLLMUTIL void aabb_triangle(const AABBSoAView &aabbs, const Vector3 &a, const Vector3 &b, const Vector3 &c, std::span<bool> outResults);
+	// Tests all triangles of an indexed mesh against one box, outResults must have one entry per triangle
+	DLLMUTIL void aabb_triangle(const Vector3 &min, const Vector3 &max, std::span<const Vector3> verts, std::span<const uint16_t> indices, std::span<bool> outResults);
+	DLLMUTIL void aabb_triangle(const Vector3 &min, const Vector3 &max, std::span<const Vector3> verts, std::span<const uint32_t> indices, std::span<bool> outResults);
+
+	// Structure-of-arrays view of lines with precomputed reciprocal directions (1 / d) for the batched line_aabb
+	struct DLLMUTIL LineSoAView {
+		std::span<const float> originX;
+		std::span<const float> originY;
+		std::span<const float> originZ;
+		std::span<const float> dirInvX;
+		std::span<const float> dirInvY;
+		std::span<const float> dirInvZ;
+		size_t size() const { return originX.size(); }
+	};
+	// Output buffers of the batched line_aabb. Every buffer is optional, non-empty buffers must have one entry per tested line / box.
+	struct DLLMUTIL LineAABBResults {
+		// One bit per element (element i is stored in bit i % 64 of word i / 64), set if the result is Result::Intersect.
+		// Must have at least (count + 63) / 64 words.
+		std::span<uint64_t> hitMask;
+		// Intersect if the segment [o, o + d] intersects the box, OutOfRange if only the infinite line does
+		std::span<Result> results;
+		// Entry and exit distances in units of the direction, as returned by line_aabb. Only meaningful for hits.
+		std::span<float> tMin;
+		std::span<float> tMax;
+	};
+	// Batched slab tests with SIMD. tMin / tMax are identical to the values returned by line_aabb for d = 1 / dirInv, however unlike line_aabb
+	// the results distinguish between hits within the segment and hits outside of it.
+	// Tests one line against all boxes
+	DLLMUTIL void line_aabb(const Vector3 &o, const Vector3 &dirInv, const AABBSoAView &aabbs, const LineAABBResults &outResults);
+	// Tests all lines against one box
+	DLLMUTIL void line_aabb(const LineSoAView &lines, const Vector3 &min, const Vector3 &max, const LineAABBResults &outResults);
 	DLLMUTIL Intersect triangle_in_plane_mesh(const Vector3 &a, const Vector3 &b, const Vector3 &c, const std::vector<Plane> &planes);
 	DLLMUTIL bool sphere_cone(const Vector3 &sphereOrigin, float radius, const Vector3 &coneOrigin, const Vector3 &coneDir, float coneAngle);
 	DLLMUTIL bool sphere_cone(const Vector3 &sphereOrigin, float radius, const Vector3 &coneOrigin, const Vector3 &coneDir, float coneAngle, float coneSize);
@@ -63,6 +121,28 @@ namespace umath::geometry {
 	DLLMUTIL void generate_truncated_elliptic_cone_mesh(const Vector3 &origin, float startRadiusX, float startRadiusY, const Vector3 &dir, float dist, float endRadiusX, float endRadiusY, std::vector<Vector3> &verts, std::vector<uint16_t> *triangles = nullptr,
 	  std::vector<Vector3> *normals = nullptr, uint32_t segmentCount = 12, bool bAddCaps = true);
 
+	// Dense occupancy grid, as generated by voxelize. Voxel (x, y, z) covers the box [origin + (x, y, z) * voxelSize, origin + (x + 1, y + 1, z + 1) * voxelSize].
+	struct DLLMUTIL VoxelGrid {
+		Vector3 origin {};
+		float voxelSize = 1.f;
+		Vector3i resolution {0, 0, 0};
+		// One bit per voxel, the linear voxel index is x + (y + z * resolution.y) * resolution.x
+		std::vector<uint64_t> occupancy;
+		size_t GetVoxelIndex(const Vector3i &voxel) const { return voxel.x + (voxel.y + static_cast<size_t>(voxel.z) * resolution.y) * resolution.x; }
+		bool IsOccupied(const Vector3i &voxel) const
+		{
+			auto idx = GetVoxelIndex(voxel);
+			return (occupancy[idx / 64] & (uint64_t {1} << (idx % 64))) != 0;
+		}
+	};
+	// Conservative voxelization of an indexed triangle mesh: Every voxel that overlaps (or touches) a triangle according to
+	// umath::intersection::aabb_triangle is occupied. Triangles outside of the grid are ignored.
+	DLLMUTIL void voxelize(std::span<const Vector3> verts, std::span<const uint16_t> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, VoxelGrid &outGrid);
+	DLLMUTIL void voxelize(std::span<const Vector3> verts, std::span<const uint32_t> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, VoxelGrid &outGrid);
+	// Sparse variant, outVoxels receives the occupied voxels ordered by their linear index (see VoxelGrid)
+	DLLMUTIL void voxelize(std::span<const Vector3> verts, std::span<const uint16_t> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, std::vector<Vector3i> &outVoxels);
+	DLLMUTIL void voxelize(std::span<const Vector3> verts, std::span<const uint32_t> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, std::vector<Vector3i> &outVoxels);
+
 	DLLMUTIL double calc_volume_of_triangle(const Vector3 &v0, const Vector3 &v1, const Vector3 &v2);
 	DLLMUTIL double calc_volume_of_polyhedron(const std::function<bool(const Vector3 **, const Vector3 **, const Vector3 **)> &fGetNextTriangle, Vector3 *centerOfMass = nullptr);
 	DLLMUTIL double calc_volume_of_polyhedron(const std::vector<Vector3> &verts, const std::vector<uint16_t> &triangles, Vector3 *centerOfMass = nullptr);
@@ -9,6 +9,9 @@
 #include "umath.h"
 #include "uvec.h"
 #include "umat.h"
+#include "inline/uquat_inline.hpp"
+#include <array>
+#include <span>
 
 class EulerAngles;
 namespace uquat {
@@ -24,6 +27,22 @@ namespace uquat {
 	DLLMUTIL Vector3 up(const Quat &q);
 	DLLMUTIL Quat slerp(const Quat &q1, const Quat &q2, Float factor);
 	DLLMUTIL Quat lerp(const Quat &q1, const Quat &q2, Float factor);
+	// Normalized linear interpolation along the shortest path
+	DLLMUTIL Quat nlerp(const Quat &q1, const Quat &q2, Float factor);
+	// Approximation of slerp: nlerp with a polynomially corrected factor, which compensates the non-constant angular velocity
+	// of nlerp. The maximum angular deviation from slerp is about 8e-4 radians (0.05 degrees).
+	DLLMUTIL Quat slerp_fast(const Quat &q1, const Quat &q2, Float factor);
+
+	// Batch versions of the interpolation functions with the same results, processed in SIMD lanes:
+	// Either out[i] = f(q1[i], q2[i], factor) for N pairs, or out[i] = f(q1, q2, factors[i]) for one pair and N factors.
+	DLLMUTIL void slerp(std::span<const Quat> q1, std::span<const Quat> q2, Float factor, std::span<Quat> out);
+	DLLMUTIL void slerp(const Quat &q1, const Quat &q2, std::span<const Float> factors, std::span<Quat> out);
+	DLLMUTIL void slerp_fast(std::span<const Quat> q1, std::span<const Quat> q2, Float factor, std::span<Quat> out);
+	DLLMUTIL void slerp_fast(const Quat &q1, const Quat &q2, std::span<const Float> factors, std::span<Quat> out);
+	DLLMUTIL void nlerp(std::span<const Quat> q1, std::span<const Quat> q2, Float factor, std::span<Quat> out);
+	DLLMUTIL void nlerp(const Quat &q1, const Quat &q2, std::span<const Float> factors, std::span<Quat> out);
+	DLLMUTIL void lerp(std::span<const Quat> q1, std::span<const Quat> q2, Float factor, std::span<Quat> out);
+	DLLMUTIL void lerp(const Quat &q1, const Quat &q2, std::span<const Float> factors, std::span<Quat> out);
 	DLLMUTIL void get_orientation(const Quat &q, Vector3 *forward, Vector3 *right, Vector3 *up);
 	DLLMUTIL Float dot_product(const Quat &q1, const Quat &q2);
 	DLLMUTIL void rotate(Quat &q, const EulerAngles &ang);
@@ -43,6 +62,29 @@ namespace uquat {
 	DLLMUTIL constexpr Quat identity() { return Quat {1.f, 0.f, 0.f, 0.f}; }
 	DLLMUTIL Quat calc_average(const std::vector<Quat> &rotations);
 	DLLMUTIL Quat calc_average(const std::vector<Quat> &rotations, const std::vector<float> &weights);
+	// Weighted average of rotations after Markley et al. ("Averaging Quaternions"): The dominant eigenvector of the sum of the
+	// weighted outer products q * q^T. Unlike calc_average, the result neither depends on the order of the rotations nor on their signs,
+	// and it stays accurate for rotations that are far apart. The weights don't have to be normalized, by default every rotation has a
+	// weight of 1. The result has a non-negative w component, or is the identity if the total weight is 0.
+	DLLMUTIL Quat calc_average_markley(std::span<const Quat> rotations, std::span<const float> weights = {});
+
+	// Accumulates rotations for calc_average_markley one at a time or in chunks, e.g. for streamed samples
+#pragma warning(disable : 4251)
+	class DLLMUTIL AverageAccumulator {
+	  public:
+		void Add(const Quat &rot, float weight = 1.f);
+		void Add(std::span<const Quat> rotations, std::span<const float> weights = {});
+		void Reset();
+		Quat GetAverage() const;
+		double GetTotalWeight() const { return m_totalWeight; }
+		size_t GetCount() const { return m_count; }
+	  private:
+		// Upper triangle of the symmetric 4x4 matrix in w, x, y, z order, in double precision since thousands of samples may be added
+		std::array<double, 10> m_matrix {};
+		double m_totalWeight = 0.0;
+		size_t m_count = 0;
+	};
+#pragma warning(default : 4251)
 	DLLMUTIL Quat clamp_rotation(const Quat &q, const EulerAngles &minBounds, const EulerAngles &maxBounds);
 	DLLMUTIL float distance(const Quat &q0, const Quat &q1);
 	DLLMUTIL std::string to_string(const Quat &q, char sep = ',');
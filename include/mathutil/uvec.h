@@ -13,6 +13,7 @@
 #include "umath.h"
 #include "eulerangles.h"
 #include "uquat.h"
+#include "inline/uvec_inline.hpp"
 
 DLLMUTIL std::ostream &operator<<(std::ostream &os, const Vector4 &vec);
 DLLMUTIL bool operator==(const Vector4 &a, const Vector4 &b);
@@ -0,0 +1,218 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/boundingvolume.h"
+#include "mathutil/umath_geometry.hpp"
+#include "bvh_builder.hpp"
+#include <array>
+#include <cassert>
+
+using namespace bounding_volume;
+
+namespace {
+	struct Ray {
+		Ray(const Vector3 &origin, const Vector3 &dir) : origin {origin}, dirInv {1 / dir.x, 1 / dir.y, 1 / dir.z}, sign {dirInv.x < 0, dirInv.y < 0, dirInv.z < 0} {}
+		Vector3 origin;
+		Vector3 dirInv;
+		int sign[3];
+	};
+	using TraversalStack = std::array<uint32_t, BVHNode::MAX_DEPTH>;
+};
+
+// Equivalent to umath::intersection::line_aabb with a precomputed inverse direction, restricted to [0, maxDist]
+static bool ray_aabb(const Ray &ray, const Vector3 &min, const Vector3 &max, float maxDist, float &outT)
+{
+	const Vector3 *bounds[] = {&min, &max};
+	auto &o = ray.origin;
+	auto &dirInv = ray.dirInv;
+	float tMin = (bounds[ray.sign[0]]->x - o.x) * dirInv.x;
+	float tMax = (bounds[1 - ray.sign[0]]->x - o.x) * dirInv.x;
+	float tyMin = (bounds[ray.sign[1]]->y - o.y) * dirInv.y;
+	float tyMax = (bounds[1 - ray.sign[1]]->y - o.y) * dirInv.y;
+	if((tMin > tyMax) || (tyMin > tMax))
+		return false;
+	if(tyMin > tMin)
+		tMin = tyMin;
+	if(tyMax < tMax)
+		tMax = tyMax;
+	float tzMin = (bounds[ray.sign[2]]->z - o.z) * dirInv.z;
+	float tzMax = (bounds[1 - ray.sign[2]]->z - o.z) * dirInv.z;
+	if((tMin > tzMax) || (tzMin > tMax))
+		return false;
+	if(tzMin > tMin)
+		tMin = tzMin;
+	if(tzMax < tMax)
+		tMax = tzMax;
+	if(tMax < 0.f || tMin > maxDist)
+		return false;
+	outT = umath::max(tMin, 0.f);
+	return true;
+}
+
+// Generic overlap traversal. fTest returns Outside to cull a box, Inside if the box and all of its
+// contents are known to overlap, or Overlap otherwise.
+template<class TTest>
+static void find_overlaps(const std::vector<BVHNode> &nodes, const std::vector<AABB> &primitives, const std::vector<uint32_t> &payloads, const TTest &fTest, std::vector<uint32_t> &outPayloads)
+{
+	if(nodes.empty())
+		return;
+	// The most significant bit marks subtrees which are fully contained
+	constexpr uint32_t insideFlag = 1u << 31u;
+	TraversalStack stack;
+	uint32_t stackSize = 0;
+	uint32_t cur = 0;
+	for(;;) {
+		auto inside = (cur & insideFlag) != 0;
+		auto &node = nodes[cur & ~insideFlag];
+		if(!inside) {
+			auto res = fTest(node.min, node.max);
+			if(res == umath::intersection::Intersect::Inside)
+				inside = true;
+			else if(res == umath::intersection::Intersect::Outside) {
+				if(stackSize == 0)
+					return;
+				cur = stack[--stackSize];
+				continue;
+			}
+		}
+		auto flag = inside ? insideFlag : 0u;
+		if(!node.IsLeaf()) {
+			assert(stackSize < stack.size());
+			stack[stackSize++] = node.index | flag;
+			cur = static_cast<uint32_t>((&node - nodes.data()) + 1) | flag;
+			continue;
+		}
+		for(auto i = node.index; i < node.index + node.count; ++i) {
+			if(inside || fTest(primitives[i].min, primitives[i].max) != umath::intersection::Intersect::Outside)
+				outPayloads.push_back(payloads[i]);
+		}
+		if(stackSize == 0)
+			return;
+		cur = stack[--stackSize];
+	}
+}
+
+BVH::BVH(std::span<const AABB> aabbs, std::span<const uint32_t> payloads, uint32_t maxLeafSize, uint32_t threadCount) { Build(aabbs, payloads, maxLeafSize, threadCount); }
+
+void BVH::Build(std::span<const AABB> aabbs, std::span<const uint32_t> payloads, uint32_t maxLeafSize, uint32_t threadCount)
+{
+	assert(payloads.empty() || payloads.size() == aabbs.size());
+	std::vector<uint32_t> order;
+	bvh_builder::build(aabbs, maxLeafSize, m_nodes, order, threadCount);
+	m_primitives.resize(order.size());
+	m_payloads.resize(order.size());
+	for(size_t i = 0; i < order.size(); ++i) {
+		m_primitives[i] = aabbs[order[i]];
+		m_payloads[i] = payloads.empty() ? order[i] : payloads[order[i]];
+	}
+}
+
+void BVH::Clear()
+{
+	m_nodes.clear();
+	m_primitives.clear();
+	m_payloads.clear();
+}
+
+std::optional<BVH::RayHit> BVH::FindClosestRayHit(const Vector3 &origin, const Vector3 &dir, float maxDist) const
+{
+	if(m_nodes.empty())
+		return {};
+	Ray ray {origin, dir};
+	float t;
+	if(!ray_aabb(ray, m_nodes.front().min, m_nodes.front().max, maxDist, t))
+		return {};
+	std::optional<RayHit> closest {};
+	TraversalStack stack;
+	uint32_t stackSize = 0;
+	uint32_t cur = 0;
+	for(;;) {
+		auto &node = m_nodes[cur];
+		if(node.IsLeaf()) {
+			for(auto i = node.index; i < node.index + node.count; ++i) {
+				if(ray_aabb(ray, m_primitives[i].min, m_primitives[i].max, maxDist, t)) {
+					maxDist = t;
+					closest = RayHit {m_payloads[i], t};
+				}
+			}
+		}
+		else {
+			// Visit the closer child first, the other one is only visited if it may still contain a closer hit
+			uint32_t children[2] = {cur + 1, node.index};
+			float tChildren[2];
+			bool hits[2];
+			for(uint8_t i = 0; i < 2; ++i)
+				hits[i] = ray_aabb(ray, m_nodes[children[i]].min, m_nodes[children[i]].max, maxDist, tChildren[i]);
+			if(hits[0] && hits[1]) {
+				if(tChildren[1] < tChildren[0])
+					std::swap(children[0], children[1]);
+				assert(stackSize < stack.size());
+				stack[stackSize++] = children[1];
+				cur = children[0];
+				continue;
+			}
+			if(hits[0] || hits[1]) {
+				cur = hits[0] ? children[0] : children[1];
+				continue;
+			}
+		}
+		// Pop the next node that can still be closer than the closest hit
+		auto found = false;
+		while(stackSize > 0) {
+			cur = stack[--stackSize];
+			if(ray_aabb(ray, m_nodes[cur].min, m_nodes[cur].max, maxDist, t)) {
+				found = true;
+				break;
+			}
+		}
+		if(!found)
+			break;
+	}
+	return closest;
+}
+
+void BVH::FindRayHits(const Vector3 &origin, const Vector3 &dir, std::vector<RayHit> &outHits, float maxDist) const
+{
+	if(m_nodes.empty())
+		return;
+	Ray ray {origin, dir};
+	TraversalStack stack;
+	uint32_t stackSize = 0;
+	uint32_t cur = 0;
+	float t;
+	for(;;) {
+		auto &node = m_nodes[cur];
+		if(ray_aabb(ray, node.min, node.max, maxDist, t)) {
+			if(!node.IsLeaf()) {
+				assert(stackSize < stack.size());
+				stack[stackSize++] = node.index;
+				++cur;
+				continue;
+			}
+			for(auto i = node.index; i < node.index + node.count; ++i) {
+				if(ray_aabb(ray, m_primitives[i].min, m_primitives[i].max, maxDist, t))
+					outHits.push_back({m_payloads[i], t});
+			}
+		}
+		if(stackSize == 0)
+			break;
+		cur = stack[--stackSize];
+	}
+}
+
+void BVH::FindSphereOverlaps(const Vector3 &origin, float radius, std::vector<uint32_t> &outPayloads) const
+{
+	find_overlaps(
+	  m_nodes, m_primitives, m_payloads, [&origin, radius](const Vector3 &min, const Vector3 &max) { return umath::intersection::aabb_sphere(min, max, origin, radius) ? umath::intersection::Intersect::Overlap : umath::intersection::Intersect::Outside; }, outPayloads);
+}
+
+void BVH::FindFrustumOverlaps(const umath::Frustum &frustum, std::vector<uint32_t> &outPayloads) const
+{
+	find_overlaps(m_nodes, m_primitives, m_payloads, [&frustum](const Vector3 &min, const Vector3 &max) { return umath::intersection::aabb_in_plane_mesh(min, max, frustum); }, outPayloads);
+}
+
+void BVH::FindFrustumOverlaps(const std::vector<umath::Plane> &planes, std::vector<uint32_t> &outPayloads) const
+{
+	find_overlaps(m_nodes, m_primitives, m_payloads, [&planes](const Vector3 &min, const Vector3 &max) { return umath::intersection::aabb_in_plane_mesh(min, max, planes); }, outPayloads);
+}
@@ -0,0 +1,327 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/boundingvolume.h"
+#include "mathutil/umath_geometry.hpp"
+#include <cassert>
+
+using namespace bounding_volume;
+
+static AABB get_union(const AABB &a, const AABB &b) { return {glm::min(a.min, b.min), glm::max(a.max, b.max)}; }
+static float get_half_area(const AABB &aabb)
+{
+	auto ext = aabb.max - aabb.min;
+	return ext.x * ext.y + ext.y * ext.z + ext.z * ext.x;
+}
+
+DynamicAABBTree::DynamicAABBTree(float fatMargin) : m_fatMargin {fatMargin} {}
+
+uint32_t DynamicAABBTree::AllocateNode()
+{
+	uint32_t nodeId;
+	if(m_freeList != INVALID_NODE) {
+		nodeId = m_freeList;
+		m_freeList = m_nodes[nodeId].parent;
+	}
+	else {
+		nodeId = static_cast<uint32_t>(m_nodes.size());
+		m_nodes.push_back({});
+	}
+	auto &node = m_nodes[nodeId];
+	node.parent = INVALID_NODE;
+	node.child1 = INVALID_NODE;
+	node.child2 = INVALID_NODE;
+	node.height = 0;
+	node.payload = 0;
+	return nodeId;
+}
+
+void DynamicAABBTree::FreeNode(uint32_t nodeId)
+{
+	auto &node = m_nodes[nodeId];
+	node.parent = m_freeList;
+	node.height = -1;
+	m_freeList = nodeId;
+}
+
+void DynamicAABBTree::Clear()
+{
+	m_nodes.clear();
+	m_root = INVALID_NODE;
+	m_freeList = INVALID_NODE;
+	m_proxyCount = 0;
+}
+
+DynamicAABBTree::ProxyId DynamicAABBTree::Insert(const AABB &aabb, uint32_t payload)
+{
+	auto nodeId = AllocateNode();
+	auto &node = m_nodes[nodeId];
+	node.aabb = {aabb.min - Vector3 {m_fatMargin}, aabb.max + Vector3 {m_fatMargin}};
+	node.payload = payload;
+	InsertLeaf(nodeId);
+	++m_proxyCount;
+	return nodeId;
+}
+
+void DynamicAABBTree::Remove(ProxyId proxyId)
+{
+	assert(proxyId < m_nodes.size() && m_nodes[proxyId].IsLeaf() && m_nodes[proxyId].height == 0);
+	RemoveLeaf(proxyId);
+	FreeNode(proxyId);
+	--m_proxyCount;
+}
+
+bool DynamicAABBTree::Move(ProxyId proxyId, const AABB &aabb, const Vector3 &displacement)
+{
+	assert(proxyId < m_nodes.size() && m_nodes[proxyId].IsLeaf() && m_nodes[proxyId].height == 0);
+	auto &fatAABB = m_nodes[proxyId].aabb;
+	if(umath::intersection::aabb_in_aabb(aabb.min, aabb.max, fatAABB.min, fatAABB.max))
+		return false;
+	RemoveLeaf(proxyId);
+
+	// Extend the box in the direction of movement, so it stays valid for longer
+	AABB newAABB {aabb.min - Vector3 {m_fatMargin}, aabb.max + Vector3 {m_fatMargin}};
+	auto d = displacement * DISPLACEMENT_MULTIPLIER;
+	for(uint8_t i = 0; i < 3; ++i) {
+		if(d[i] < 0.f)
+			newAABB.min[i] += d[i];
+		else
+			newAABB.max[i] += d[i];
+	}
+	m_nodes[proxyId].aabb = newAABB;
+	InsertLeaf(proxyId);
+	return true;
+}
+
+const AABB &DynamicAABBTree::GetFatAABB(ProxyId proxyId) const { return m_nodes[proxyId].aabb; }
+uint32_t DynamicAABBTree::GetPayload(ProxyId proxyId) const { return m_nodes[proxyId].payload; }
+int32_t DynamicAABBTree::GetHeight() const { return (m_root != INVALID_NODE) ? m_nodes[m_root].height : -1; }
+
+void DynamicAABBTree::Refit(uint32_t nodeId)
+{
+	auto &node = m_nodes[nodeId];
+	auto &child1 = m_nodes[node.child1];
+	auto &child2 = m_nodes[node.child2];
+	node.height = 1 + umath::max(child1.height, child2.height);
+	node.aabb = get_union(child1.aabb, child2.aabb);
+}
+
+void DynamicAABBTree::InsertLeaf(uint32_t leafId)
+{
+	if(m_root == INVALID_NODE) {
+		m_root = leafId;
+		m_nodes[leafId].parent = INVALID_NODE;
+		return;
+	}
+
+	// Find the best sibling by descending into the child with the lowest cost increase
+	auto leafAABB = m_nodes[leafId].aabb;
+	auto nodeId = m_root;
+	while(!m_nodes[nodeId].IsLeaf()) {
+		auto &node = m_nodes[nodeId];
+		auto area = get_half_area(node.aabb);
+		auto combinedArea = get_half_area(get_union(node.aabb, leafAABB));
+		// Cost of creating a new parent for this node and the new leaf
+		auto cost = 2.f * combinedArea;
+		// Minimum cost of pushing the leaf further down the tree
+		auto inheritanceCost = 2.f * (combinedArea - area);
+		auto getChildCost = [this, &leafAABB, inheritanceCost](uint32_t childId) {
+			auto &child = m_nodes[childId];
+			auto unionArea = get_half_area(get_union(leafAABB, child.aabb));
+			if(child.IsLeaf())
+				return unionArea + inheritanceCost;
+			return (unionArea - get_half_area(child.aabb)) + inheritanceCost;
+		};
+		auto cost1 = getChildCost(node.child1);
+		auto cost2 = getChildCost(node.child2);
+		if(cost < cost1 && cost < cost2)
+			break;
+		nodeId = (cost1 < cost2) ? node.child1 : node.child2;
+	}
+
+	auto siblingId = nodeId;
+	auto oldParentId = m_nodes[siblingId].parent;
+	auto newParentId = AllocateNode();
+	auto &newParent = m_nodes[newParentId];
+	auto &sibling = m_nodes[siblingId];
+	newParent.parent = oldParentId;
+	newParent.aabb = get_union(leafAABB, sibling.aabb);
+	newParent.height = sibling.height + 1;
+	newParent.child1 = siblingId;
+	newParent.child2 = leafId;
+	sibling.parent = newParentId;
+	m_nodes[leafId].parent = newParentId;
+	if(oldParentId != INVALID_NODE) {
+		auto &oldParent = m_nodes[oldParentId];
+		if(oldParent.child1 == siblingId)
+			oldParent.child1 = newParentId;
+		else
+			oldParent.child2 = newParentId;
+	}
+	else
+		m_root = newParentId;
+
+	// Walk back up the tree fixing heights and bounds
+	nodeId = m_nodes[leafId].parent;
+	while(nodeId != INVALID_NODE) {
+		nodeId = Balance(nodeId);
+		Refit(nodeId);
+		nodeId = m_nodes[nodeId].parent;
+	}
+}
+
+void DynamicAABBTree::RemoveLeaf(uint32_t leafId)
+{
+	if(leafId == m_root) {
+		m_root = INVALID_NODE;
+		return;
+	}
+	auto parentId = m_nodes[leafId].parent;
+	auto &parent = m_nodes[parentId];
+	auto grandParentId = parent.parent;
+	auto siblingId = (parent.child1 == leafId) ? parent.child2 : parent.child1;
+	if(grandParentId == INVALID_NODE) {
+		m_root = siblingId;
+		m_nodes[siblingId].parent = INVALID_NODE;
+		FreeNode(parentId);
+		return;
+	}
+	// Replace the parent with the sibling
+	auto &grandParent = m_nodes[grandParentId];
+	if(grandParent.child1 == parentId)
+		grandParent.child1 = siblingId;
+	else
+		grandParent.child2 = siblingId;
+	m_nodes[siblingId].parent = grandParentId;
+	FreeNode(parentId);
+
+	auto nodeId = grandParentId;
+	while(nodeId != INVALID_NODE) {
+		nodeId = Balance(nodeId);
+		Refit(nodeId);
+		nodeId = m_nodes[nodeId].parent;
+	}
+}
+
+// Performs a left or right rotation if node A is imbalanced and returns the new root of the subtree
+uint32_t DynamicAABBTree::Balance(uint32_t iA)
+{
+	auto &a = m_nodes[iA];
+	if(a.IsLeaf() || a.height < 2)
+		return iA;
+	auto iB = a.child1;
+	auto iC = a.child2;
+	auto &b = m_nodes[iB];
+	auto &c = m_nodes[iC];
+	auto balance = c.height - b.height;
+
+	auto replaceInParent = [this, iA](uint32_t iNew) {
+		auto parentId = m_nodes[iNew].parent;
+		if(parentId == INVALID_NODE) {
+			m_root = iNew;
+			return;
+		}
+		auto &parent = m_nodes[parentId];
+		if(parent.child1 == iA)
+			parent.child1 = iNew;
+		else
+			parent.child2 = iNew;
+	};
+
+	// Rotate C up
+	if(balance > 1) {
+		auto iF = c.child1;
+		auto iG = c.child2;
+		auto &f = m_nodes[iF];
+		auto &g = m_nodes[iG];
+		c.child1 = iA;
+		c.parent = a.parent;
+		a.parent = iC;
+		replaceInParent(iC);
+		if(f.height > g.height) {
+			c.child2 = iF;
+			a.child2 = iG;
+			g.parent = iA;
+		}
+		else {
+			c.child2 = iG;
+			a.child2 = iF;
+			f.parent = iA;
+		}
+		Refit(iA);
+		Refit(iC);
+		return iC;
+	}
+
+	// Rotate B up
+	if(balance < -1) {
+		auto iD = b.child1;
+		auto iE = b.child2;
+		auto &d = m_nodes[iD];
+		auto &e = m_nodes[iE];
+		b.child1 = iA;
+		b.parent = a.parent;
+		a.parent = iB;
+		replaceInParent(iB);
+		if(d.height > e.height) {
+			b.child2 = iD;
+			a.child1 = iE;
+			e.parent = iA;
+		}
+		else {
+			b.child2 = iE;
+			a.child1 = iD;
+			d.parent = iA;
+		}
+		Refit(iA);
+		Refit(iB);
+		return iB;
+	}
+	return iA;
+}
+
+template<class TCallback>
+void DynamicAABBTree::QueryNodes(const AABB &aabb, std::vector<uint32_t> &stack, const TCallback &callback) const
+{
+	if(m_root == INVALID_NODE)
+		return;
+	stack.clear();
+	stack.push_back(m_root);
+	while(!stack.empty()) {
+		auto nodeId = stack.back();
+		stack.pop_back();
+		auto &node = m_nodes[nodeId];
+		if(!umath::intersection::aabb_aabb(node.aabb, aabb))
+			continue;
+		if(node.IsLeaf()) {
+			callback(nodeId);
+			continue;
+		}
+		stack.push_back(node.child1);
+		stack.push_back(node.child2);
+	}
+}
+
+void DynamicAABBTree::Query(const AABB &aabb, std::vector<uint32_t> &outPayloads) const
+{
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	QueryNodes(aabb, stack, [this, &outPayloads](uint32_t nodeId) { outPayloads.push_back(m_nodes[nodeId].payload); });
+}
+
+void DynamicAABBTree::FindOverlappingPairs(std::vector<std::pair<uint32_t, uint32_t>> &outPairs) const
+{
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	for(uint32_t nodeId = 0; nodeId < m_nodes.size(); ++nodeId) {
+		auto &node = m_nodes[nodeId];
+		if(node.height != 0)
+			continue;
+		// Only pairs with a larger proxy id are reported, so every pair is found once
+		QueryNodes(node.aabb, stack, [this, nodeId, &node, &outPairs](uint32_t otherId) {
+			if(otherId > nodeId)
+				outPairs.push_back({node.payload, m_nodes[otherId].payload});
+		});
+	}
+}
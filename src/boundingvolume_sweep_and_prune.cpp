@@ -0,0 +1,180 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/boundingvolume.h"
+#include "mathutil/umath_geometry.hpp"
+#include <algorithm>
+#include <cassert>
+
+using namespace bounding_volume;
+
+SweepAndPrune::ProxyId SweepAndPrune::Insert(const AABB &aabb, uint32_t payload, const Vector3 &displacement)
+{
+	ProxyId proxyId;
+	if(!m_freeProxies.empty()) {
+		proxyId = m_freeProxies.back();
+		m_freeProxies.pop_back();
+	}
+	else {
+		proxyId = static_cast<ProxyId>(m_proxies.size());
+		m_proxies.push_back({});
+	}
+	auto &proxy = m_proxies[proxyId];
+	proxy.payload = payload;
+	proxy.valid = true;
+	Update(proxyId, aabb, displacement);
+	// The endpoint values are assigned in the next update
+	for(auto &endpoints : m_endpoints) {
+		endpoints.push_back({0.f, proxyId << 1});
+		endpoints.push_back({0.f, (proxyId << 1) | 1u});
+	}
+	m_insertedEndpointCount += 2;
+	++m_proxyCount;
+	return proxyId;
+}
+
+void SweepAndPrune::Remove(ProxyId proxyId)
+{
+	assert(proxyId < m_proxies.size() && m_proxies[proxyId].valid);
+	m_proxies[proxyId].valid = false;
+	m_removedProxies.push_back(proxyId);
+	--m_proxyCount;
+}
+
+void SweepAndPrune::Update(ProxyId proxyId, const AABB &aabb, const Vector3 &displacement)
+{
+	assert(proxyId < m_proxies.size() && m_proxies[proxyId].valid);
+	auto &proxy = m_proxies[proxyId];
+	proxy.aabb = aabb;
+	proxy.displacement = displacement;
+	proxy.sweptAABB = {glm::min(aabb.min, aabb.min + displacement), glm::max(aabb.max, aabb.max + displacement)};
+}
+
+void SweepAndPrune::Clear()
+{
+	m_proxies.clear();
+	m_freeProxies.clear();
+	m_removedProxies.clear();
+	for(auto &endpoints : m_endpoints)
+		endpoints.clear();
+	m_insertedEndpointCount = 0;
+	m_proxyCount = 0;
+}
+
+const AABB &SweepAndPrune::GetAABB(ProxyId proxyId) const { return m_proxies[proxyId].aabb; }
+const Vector3 &SweepAndPrune::GetDisplacement(ProxyId proxyId) const { return m_proxies[proxyId].displacement; }
+const AABB &SweepAndPrune::GetSweptAABB(ProxyId proxyId) const { return m_proxies[proxyId].sweptAABB; }
+uint32_t SweepAndPrune::GetPayload(ProxyId proxyId) const { return m_proxies[proxyId].payload; }
+
+void SweepAndPrune::UpdateEndpoints()
+{
+	if(!m_removedProxies.empty()) {
+		auto isRemoved = [this](const Endpoint &endpoint) { return !m_proxies[endpoint.data >> 1].valid; };
+		auto &endpoints0 = m_endpoints[0];
+		auto numRemovedInserted = static_cast<size_t>(std::count_if(endpoints0.end() - m_insertedEndpointCount, endpoints0.end(), isRemoved));
+		for(auto &endpoints : m_endpoints)
+			endpoints.erase(std::remove_if(endpoints.begin(), endpoints.end(), isRemoved), endpoints.end());
+		m_insertedEndpointCount -= numRemovedInserted;
+		// The ids can only be re-used once their endpoints are gone
+		m_freeProxies.insert(m_freeProxies.end(), m_removedProxies.begin(), m_removedProxies.end());
+		m_removedProxies.clear();
+	}
+
+	// Min endpoints are sorted before max endpoints with the same value, so touching bounds overlap
+	auto less = [](const Endpoint &a, const Endpoint &b) { return a.value < b.value || (a.value == b.value && (a.data & 1u) < (b.data & 1u)); };
+	for(uint8_t axis = 0; axis < 3; ++axis) {
+		auto &endpoints = m_endpoints[axis];
+		for(auto &endpoint : endpoints) {
+			auto &bounds = m_proxies[endpoint.data >> 1].sweptAABB;
+			endpoint.value = (endpoint.data & 1u) ? bounds.max[axis] : bounds.min[axis];
+		}
+		// The existing endpoints are still mostly sorted from the previous update
+		auto sortedCount = endpoints.size() - m_insertedEndpointCount;
+		for(size_t i = 1; i < sortedCount; ++i) {
+			auto endpoint = endpoints[i];
+			auto j = i;
+			for(; j > 0 && less(endpoint, endpoints[j - 1]); --j)
+				endpoints[j] = endpoints[j - 1];
+			endpoints[j] = endpoint;
+		}
+		// New endpoints are in arbitrary order, so they are sorted separately and merged
+		if(m_insertedEndpointCount > 0) {
+			auto itNew = endpoints.begin() + sortedCount;
+			std::sort(itNew, endpoints.end(), less);
+			std::inplace_merge(endpoints.begin(), itNew, endpoints.end(), less);
+		}
+	}
+	m_insertedEndpointCount = 0;
+}
+
+template<class TCallback>
+void SweepAndPrune::FindPairs(const TCallback &callback)
+{
+	UpdateEndpoints();
+	if(m_proxyCount < 2)
+		return;
+
+	// Sweep along the axis with the largest spread, which produces the fewest candidates
+	Vector3 sum {0.f};
+	Vector3 sumSqr {0.f};
+	for(auto &proxy : m_proxies) {
+		if(!proxy.valid)
+			continue;
+		auto center = proxy.sweptAABB.GetCenter();
+		sum += center;
+		sumSqr += center * center;
+	}
+	auto variance = sumSqr - sum * sum / static_cast<float>(m_proxyCount);
+	uint8_t axis = 0;
+	if(variance.y > variance[axis])
+		axis = 1;
+	if(variance.z > variance[axis])
+		axis = 2;
+	auto axis1 = (axis + 1) % 3;
+	auto axis2 = (axis + 2) % 3;
+
+	m_activeProxies.clear();
+	m_activeIndices.resize(m_proxies.size());
+	for(auto &endpoint : m_endpoints[axis]) {
+		auto proxyId = endpoint.data >> 1;
+		if(endpoint.data & 1u) {
+			auto idx = m_activeIndices[proxyId];
+			auto lastId = m_activeProxies.back();
+			m_activeProxies[idx] = lastId;
+			m_activeIndices[lastId] = idx;
+			m_activeProxies.pop_back();
+			continue;
+		}
+		// All active proxies overlap this one on the sweep axis
+		auto &bounds = m_proxies[proxyId].sweptAABB;
+		for(auto otherId : m_activeProxies) {
+			auto &otherBounds = m_proxies[otherId].sweptAABB;
+			if(bounds.min[axis1] <= otherBounds.max[axis1] && otherBounds.min[axis1] <= bounds.max[axis1] && bounds.min[axis2] <= otherBounds.max[axis2] && otherBounds.min[axis2] <= bounds.max[axis2])
+				callback(otherId, proxyId);
+		}
+		m_activeIndices[proxyId] = static_cast<uint32_t>(m_activeProxies.size());
+		m_activeProxies.push_back(proxyId);
+	}
+}
+
+void SweepAndPrune::FindOverlappingPairs(std::vector<std::pair<uint32_t, uint32_t>> &outPairs)
+{
+	outPairs.clear();
+	FindPairs([this, &outPairs](ProxyId a, ProxyId b) { outPairs.push_back({m_proxies[a].payload, m_proxies[b].payload}); });
+}
+
+void SweepAndPrune::FindSweptCollisions(std::vector<SweptCollision> &outCollisions)
+{
+	outCollisions.clear();
+	FindPairs([this, &outCollisions](ProxyId a, ProxyId b) {
+		auto &proxyA = m_proxies[a];
+		auto &proxyB = m_proxies[b];
+		auto centerA = proxyA.aabb.GetCenter();
+		auto centerB = proxyB.aabb.GetCenter();
+		float entryTime, exitTime;
+		Vector3 normal;
+		if(umath::sweep::aabb_with_aabb(centerA, centerA + proxyA.displacement, proxyA.aabb.GetExtents(), centerB, centerB + proxyB.displacement, proxyB.aabb.GetExtents(), &entryTime, &exitTime, &normal))
+			outCollisions.push_back({proxyA.payload, proxyB.payload, entryTime, normal});
+	});
+}
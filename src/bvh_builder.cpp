@@ -0,0 +1,349 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "bvh_builder.hpp"
+#include "task_pool.hpp"
+#include <algorithm>
+#include <array>
+#include <limits>
+
+using namespace bounding_volume;
+
+namespace {
+	struct Bounds {
+		Vector3 min {std::numeric_limits<float>::max()};
+		Vector3 max {std::numeric_limits<float>::lowest()};
+		void Grow(const Vector3 &p)
+		{
+			min = glm::min(min, p);
+			max = glm::max(max, p);
+		}
+		void Grow(const Vector3 &pMin, const Vector3 &pMax)
+		{
+			min = glm::min(min, pMin);
+			max = glm::max(max, pMax);
+		}
+		float GetHalfArea() const
+		{
+			auto ext = max - min;
+			return ext.x * ext.y + ext.y * ext.z + ext.z * ext.x;
+		}
+	};
+	using Bins = std::array<std::array<Bounds, bvh_builder::BIN_COUNT>, 3>;
+	using BinCounts = std::array<std::array<uint32_t, bvh_builder::BIN_COUNT>, 3>;
+	struct BuildContext {
+		std::span<const AABB> bounds;
+		std::vector<Vector3> centroids;
+		std::vector<uint32_t> &order;
+		std::vector<uint32_t> scratch; // Temporary storage for partitioning, subtrees use disjoint ranges
+		uint32_t maxLeafSize;
+		umath::TaskPool *pool;
+	};
+	// Per-chunk results; the common single-chunk case doesn't require a heap allocation
+	template<class T>
+	class ChunkStorage {
+	  public:
+		ChunkStorage(uint32_t numChunks)
+		{
+			if(numChunks > 1)
+				m_multi.resize(numChunks);
+		}
+		T &operator[](uint32_t chunkIdx) { return m_multi.empty() ? m_single : m_multi[chunkIdx]; }
+		T *begin() { return m_multi.empty() ? &m_single : m_multi.data(); }
+		T *end() { return m_multi.empty() ? (&m_single + 1) : (m_multi.data() + m_multi.size()); }
+	  private:
+		T m_single {};
+		std::vector<T> m_multi;
+	};
+	struct Split {
+		uint8_t axis = 0;
+		uint32_t bin = 0; // Primitives in bins below this index go to the left child
+		bool median = false;
+	};
+};
+
+// After this depth, nodes are split at the object median, which halves the primitive count with every level and
+// therefore guarantees that BVHNode::MAX_DEPTH is never exceeded.
+static constexpr uint32_t MEDIAN_SPLIT_DEPTH = BVHNode::MAX_DEPTH - 33;
+
+// Subtrees with at least this many primitives are built as separate tasks
+static constexpr uint32_t PARALLEL_SUBTREE_THRESHOLD = 1'024;
+// Nodes with at least this many primitives are binned and partitioned in parallel chunks
+static constexpr uint32_t PARALLEL_LOOP_THRESHOLD = 32 * 1'024;
+static constexpr uint32_t PARALLEL_LOOP_GRAIN_SIZE = 8 * 1'024;
+
+static uint32_t get_bin_index(float c, float cmin, float scale) { return umath::min(static_cast<uint32_t>((c - cmin) * scale), bvh_builder::BIN_COUNT - 1); }
+
+static uint32_t get_chunk_count(const BuildContext &ctx, uint32_t count) { return (!ctx.pool || count < PARALLEL_LOOP_THRESHOLD) ? 1 : (count + PARALLEL_LOOP_GRAIN_SIZE - 1) / PARALLEL_LOOP_GRAIN_SIZE; }
+static uint32_t get_chunk_size(uint32_t numChunks, uint32_t chunkIdx, uint32_t count) { return (numChunks == 1) ? count : umath::min(PARALLEL_LOOP_GRAIN_SIZE, count - chunkIdx * PARALLEL_LOOP_GRAIN_SIZE); }
+
+// Calls fChunk(chunkIdx, begin, end) for the get_chunk_count consecutive chunks of [first, first + count),
+// which are processed in parallel if there is more than one.
+template<class TChunkFunc>
+static void for_each_chunk(const BuildContext &ctx, uint32_t first, uint32_t count, const TChunkFunc &fChunk)
+{
+	auto numChunks = get_chunk_count(ctx, count);
+	if(numChunks == 1) {
+		fChunk(0, first, first + count);
+		return;
+	}
+	ctx.pool->ParallelFor(numChunks, 1, [first, count, numChunks, &fChunk](uint32_t chunkBegin, uint32_t chunkEnd) {
+		for(auto i = chunkBegin; i < chunkEnd; ++i) {
+			auto begin = first + i * PARALLEL_LOOP_GRAIN_SIZE;
+			fChunk(i, begin, begin + get_chunk_size(numChunks, i, count));
+		}
+	});
+}
+
+// Only min/max operations and integer sums are used for the reductions below, so the results don't depend on the chunking.
+static void calc_bounds(const BuildContext &ctx, uint32_t first, uint32_t count, Bounds &outNodeBounds, Bounds &outCentroidBounds)
+{
+	ChunkStorage<std::pair<Bounds, Bounds>> chunkBounds {get_chunk_count(ctx, count)};
+	for_each_chunk(ctx, first, count, [&ctx, &chunkBounds](uint32_t chunkIdx, uint32_t begin, uint32_t end) {
+		auto &[nodeBounds, centroidBounds] = chunkBounds[chunkIdx];
+		for(auto i = begin; i < end; ++i) {
+			auto primIdx = ctx.order[i];
+			auto &aabb = ctx.bounds[primIdx];
+			nodeBounds.Grow(aabb.min, aabb.max);
+			centroidBounds.Grow(ctx.centroids[primIdx]);
+		}
+	});
+	outNodeBounds = {};
+	outCentroidBounds = {};
+	for(auto &[nodeBounds, centroidBounds] : chunkBounds) {
+		outNodeBounds.Grow(nodeBounds.min, nodeBounds.max);
+		outCentroidBounds.Grow(centroidBounds.min, centroidBounds.max);
+	}
+}
+
+static void calc_bins(const BuildContext &ctx, uint32_t first, uint32_t count, const Bounds &centroidBounds, Bins &outBins, BinCounts &outBinCounts)
+{
+	auto ext = centroidBounds.max - centroidBounds.min;
+	ChunkStorage<std::pair<Bins, BinCounts>> chunkBins {get_chunk_count(ctx, count)};
+	for_each_chunk(ctx, first, count, [&ctx, &chunkBins, &centroidBounds, &ext](uint32_t chunkIdx, uint32_t begin, uint32_t end) {
+		auto &[bins, binCounts] = chunkBins[chunkIdx];
+		binCounts = {};
+		for(uint8_t axis = 0; axis < 3; ++axis) {
+			if(ext[axis] <= 0.f)
+				continue;
+			auto cmin = centroidBounds.min[axis];
+			auto scale = bvh_builder::BIN_COUNT / ext[axis];
+			for(auto i = begin; i < end; ++i) {
+				auto primIdx = ctx.order[i];
+				auto binIdx = get_bin_index(ctx.centroids[primIdx][axis], cmin, scale);
+				auto &aabb = ctx.bounds[primIdx];
+				bins[axis][binIdx].Grow(aabb.min, aabb.max);
+				++binCounts[axis][binIdx];
+			}
+		}
+	});
+	outBins = {};
+	outBinCounts = {};
+	for(auto &[bins, binCounts] : chunkBins) {
+		for(uint8_t axis = 0; axis < 3; ++axis) {
+			for(uint32_t i = 0; i < bvh_builder::BIN_COUNT; ++i) {
+				if(binCounts[axis][i] == 0)
+					continue;
+				outBins[axis][i].Grow(bins[axis][i].min, bins[axis][i].max);
+				outBinCounts[axis][i] += binCounts[axis][i];
+			}
+		}
+	}
+}
+
+static bool find_split(const BuildContext &ctx, uint32_t first, uint32_t count, uint32_t depth, const Bounds &nodeBounds, const Bounds &centroidBounds, Split &outSplit)
+{
+	if(count <= 1)
+		return false;
+	auto ext = centroidBounds.max - centroidBounds.min;
+	uint8_t largestAxis = 0;
+	for(uint8_t i = 1; i < 3; ++i) {
+		if(ext[i] > ext[largestAxis])
+			largestAxis = i;
+	}
+	if(ext[largestAxis] <= 0.f) {
+		// All centroids are identical, no spatial split is possible
+		if(count <= ctx.maxLeafSize)
+			return false;
+		outSplit.median = true;
+		outSplit.axis = largestAxis;
+		return true;
+	}
+	if(depth >= MEDIAN_SPLIT_DEPTH) {
+		outSplit.median = true;
+		outSplit.axis = largestAxis;
+		return true;
+	}
+
+	constexpr auto binCount = bvh_builder::BIN_COUNT;
+	Bins allBins;
+	BinCounts allBinCounts;
+	calc_bins(ctx, first, count, centroidBounds, allBins, allBinCounts);
+	auto bestCost = std::numeric_limits<float>::max();
+	for(uint8_t axis = 0; axis < 3; ++axis) {
+		if(ext[axis] <= 0.f)
+			continue;
+		auto &bins = allBins[axis];
+		auto &binCounts = allBinCounts[axis];
+
+		// Sweep from the right to gather the right-hand side areas, then from the left to evaluate the cost
+		std::array<float, binCount - 1> rightAreas;
+		std::array<uint32_t, binCount - 1> rightCounts;
+		Bounds accum {};
+		uint32_t accumCount = 0;
+		for(auto i = binCount - 1; i > 0; --i) {
+			if(binCounts[i] > 0)
+				accum.Grow(bins[i].min, bins[i].max);
+			accumCount += binCounts[i];
+			rightAreas[i - 1] = accum.GetHalfArea();
+			rightCounts[i - 1] = accumCount;
+		}
+		accum = {};
+		accumCount = 0;
+		for(uint32_t i = 0; i < binCount - 1; ++i) {
+			if(binCounts[i] > 0)
+				accum.Grow(bins[i].min, bins[i].max);
+			accumCount += binCounts[i];
+			if(accumCount == 0 || rightCounts[i] == 0)
+				continue;
+			auto cost = accum.GetHalfArea() * accumCount + rightAreas[i] * rightCounts[i];
+			if(cost < bestCost) {
+				bestCost = cost;
+				outSplit.axis = axis;
+				outSplit.bin = i + 1;
+			}
+		}
+	}
+	if(bestCost == std::numeric_limits<float>::max())
+		return false;
+
+	// Traversal cost of 1, intersection cost of 1 per primitive
+	auto parentArea = nodeBounds.GetHalfArea();
+	auto splitCost = (parentArea > 0.f) ? (1.f + bestCost / parentArea) : std::numeric_limits<float>::max();
+	if(count <= ctx.maxLeafSize && splitCost >= static_cast<float>(count))
+		return false;
+	return true;
+}
+
+static uint32_t partition(BuildContext &ctx, uint32_t first, uint32_t count, const Split &split, const Bounds &centroidBounds)
+{
+	if(split.median) {
+		auto itBegin = ctx.order.begin() + first;
+		auto itMid = itBegin + count / 2;
+		std::nth_element(itBegin, itMid, itBegin + count, [&ctx, &split](uint32_t a, uint32_t b) {
+			auto ca = ctx.centroids[a][split.axis];
+			auto cb = ctx.centroids[b][split.axis];
+			return (ca != cb) ? (ca < cb) : (a < b);
+		});
+		return first + count / 2;
+	}
+	// Bin indices are recomputed the same way as in find_split, so both sides are guaranteed to be non-empty.
+	// The partition is stable, which makes the result independent of the chunking.
+	auto cmin = centroidBounds.min[split.axis];
+	auto scale = bvh_builder::BIN_COUNT / (centroidBounds.max[split.axis] - cmin);
+	auto isLeft = [&ctx, &split, cmin, scale](uint32_t primIdx) { return get_bin_index(ctx.centroids[primIdx][split.axis], cmin, scale) < split.bin; };
+	auto numChunks = get_chunk_count(ctx, count);
+	ChunkStorage<uint32_t> chunkLeftCounts {numChunks};
+	for_each_chunk(ctx, first, count, [&ctx, &chunkLeftCounts, &isLeft](uint32_t chunkIdx, uint32_t begin, uint32_t end) {
+		for(auto i = begin; i < end; ++i) {
+			if(isLeft(ctx.order[i]))
+				++chunkLeftCounts[chunkIdx];
+		}
+	});
+
+	// Output offsets of every chunk for both sides
+	uint32_t numLeft = 0;
+	for(auto n : chunkLeftCounts)
+		numLeft += n;
+	ChunkStorage<std::pair<uint32_t, uint32_t>> chunkOffsets {numChunks};
+	auto leftOffset = first;
+	auto rightOffset = first + numLeft;
+	for(uint32_t i = 0; i < numChunks; ++i) {
+		chunkOffsets[i] = {leftOffset, rightOffset};
+		leftOffset += chunkLeftCounts[i];
+		rightOffset += get_chunk_size(numChunks, i, count) - chunkLeftCounts[i];
+	}
+
+	for_each_chunk(ctx, first, count, [&ctx, &chunkOffsets, &isLeft](uint32_t chunkIdx, uint32_t begin, uint32_t end) {
+		auto [left, right] = chunkOffsets[chunkIdx];
+		for(auto i = begin; i < end; ++i) {
+			auto primIdx = ctx.order[i];
+			ctx.scratch[isLeft(primIdx) ? left++ : right++] = primIdx;
+		}
+	});
+	for_each_chunk(ctx, first, count, [&ctx](uint32_t, uint32_t begin, uint32_t end) { std::copy(ctx.scratch.begin() + begin, ctx.scratch.begin() + end, ctx.order.begin() + begin); });
+	return first + numLeft;
+}
+
+// Builds the subtree for the primitives [first, first + count) and appends its nodes to outNodes.
+// The right child indices are relative to the start of outNodes.
+static void build_node(BuildContext &ctx, std::vector<BVHNode> &outNodes, uint32_t first, uint32_t count, uint32_t depth)
+{
+	Bounds nodeBounds {};
+	Bounds centroidBounds {};
+	calc_bounds(ctx, first, count, nodeBounds, centroidBounds);
+
+	auto nodeIdx = static_cast<uint32_t>(outNodes.size());
+	outNodes.push_back({nodeBounds.min, first, nodeBounds.max, count});
+
+	Split split {};
+	if(!find_split(ctx, first, count, depth, nodeBounds, centroidBounds, split))
+		return;
+	auto mid = partition(ctx, first, count, split, centroidBounds);
+	outNodes[nodeIdx].count = 0;
+	auto leftCount = mid - first;
+	auto rightCount = first + count - mid;
+	if(!ctx.pool || umath::min(leftCount, rightCount) < PARALLEL_SUBTREE_THRESHOLD) {
+		build_node(ctx, outNodes, first, leftCount, depth + 1);
+		outNodes[nodeIdx].index = static_cast<uint32_t>(outNodes.size());
+		build_node(ctx, outNodes, mid, rightCount, depth + 1);
+		return;
+	}
+
+	// The right subtree is built by another task and appended afterwards, which results in the same layout as the serial build
+	std::vector<BVHNode> rightNodes;
+	umath::TaskPool::Group group {};
+	ctx.pool->Run(group, [&ctx, &rightNodes, mid, rightCount, depth]() {
+		rightNodes.reserve(rightCount * 2 - 1);
+		build_node(ctx, rightNodes, mid, rightCount, depth + 1);
+	});
+	build_node(ctx, outNodes, first, leftCount, depth + 1);
+	ctx.pool->Wait(group);
+
+	auto offset = static_cast<uint32_t>(outNodes.size());
+	outNodes[nodeIdx].index = offset;
+	for(auto &node : rightNodes) {
+		outNodes.push_back(node);
+		if(!node.IsLeaf())
+			outNodes.back().index += offset;
+	}
+}
+
+void bvh_builder::build(std::span<const AABB> primitiveBounds, uint32_t maxLeafSize, std::vector<BVHNode> &outNodes, std::vector<uint32_t> &outPrimitiveOrder, uint32_t threadCount)
+{
+	outNodes.clear();
+	outPrimitiveOrder.resize(primitiveBounds.size());
+	if(primitiveBounds.empty())
+		return;
+	outNodes.reserve(primitiveBounds.size() * 2 - 1);
+	for(uint32_t i = 0; i < outPrimitiveOrder.size(); ++i)
+		outPrimitiveOrder[i] = i;
+
+	if(threadCount == 0)
+		threadCount = umath::max(std::thread::hardware_concurrency(), 1u);
+	// Small inputs are not worth spawning threads for. The pool only lives for the duration of the build, so no threads are
+	// kept around between builds.
+	std::unique_ptr<umath::TaskPool> pool {};
+	if(threadCount > 1 && primitiveBounds.size() >= PARALLEL_SUBTREE_THRESHOLD * 2)
+		pool = std::make_unique<umath::TaskPool>(threadCount - 1);
+
+	BuildContext ctx {primitiveBounds, {}, outPrimitiveOrder, {}, umath::max(maxLeafSize, 1u), pool.get()};
+	ctx.centroids.resize(primitiveBounds.size());
+	ctx.scratch.resize(primitiveBounds.size());
+	for_each_chunk(ctx, 0, static_cast<uint32_t>(primitiveBounds.size()), [&ctx](uint32_t, uint32_t begin, uint32_t end) {
+		for(auto i = begin; i < end; ++i)
+			ctx.centroids[i] = ctx.bounds[i].GetCenter();
+	});
+	build_node(ctx, outNodes, 0, static_cast<uint32_t>(primitiveBounds.size()), 0);
+}
@@ -0,0 +1,25 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __BVH_BUILDER_HPP__
+#define __BVH_BUILDER_HPP__
+
+#include "mathutil/boundingvolume.h"
+#include <span>
+#include <vector>
+
+// Internal binned SAH builder shared by the BVH types
+namespace bounding_volume::bvh_builder {
+	constexpr uint32_t BIN_COUNT = 16;
+
+	// Builds the flattened node array (depth-first order, see BVHNode) for the specified primitive bounds.
+	// outPrimitiveOrder receives the primitive indices in leaf order, the leaves reference ranges of it.
+	// The depth of the tree never exceeds BVHNode::MAX_DEPTH.
+	// If threadCount is not 1, large subtrees and nodes are processed in parallel (0 = one thread per hardware thread). The worker
+	// threads are started for the build and joined before it returns.
+	// The output is identical to the single-threaded build.
+	void build(std::span<const AABB> primitiveBounds, uint32_t maxLeafSize, std::vector<BVHNode> &outNodes, std::vector<uint32_t> &outPrimitiveOrder, uint32_t threadCount = 1);
+};
+
+#endif
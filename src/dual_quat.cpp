@@ -0,0 +1,169 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/dual_quat.hpp"
+#include "transform_kernels.hpp"
+#include "profile_scope.hpp"
+#include <cassert>
+
+using namespace umath;
+
+static Quat conjugate(const Quat &q) { return Quat {q.w, -q.x, -q.y, -q.z}; }
+
+umath::DualQuat::DualQuat(const Quat &rotation, const Vector3 &translation) : real {rotation}, dual {(Quat {0.f, translation.x, translation.y, translation.z} * rotation) * 0.5f} {}
+umath::DualQuat::DualQuat(const Transform &t) : DualQuat {t.GetRotation(), t.GetOrigin()} {}
+
+Transform umath::DualQuat::ToTransform() const { return Transform {GetTranslation(), real}; }
+
+Vector3 umath::DualQuat::GetTranslation() const
+{
+	auto t = (dual * conjugate(real)) * 2.f;
+	return {t.x, t.y, t.z};
+}
+
+DualQuat umath::DualQuat::operator*(const DualQuat &other) const { return DualQuat {real * other.real, real * other.dual + dual * other.real}; }
+DualQuat &umath::DualQuat::operator*=(const DualQuat &other)
+{
+	*this = *this * other;
+	return *this;
+}
+DualQuat umath::DualQuat::operator*(float weight) const { return DualQuat {real * weight, dual * weight}; }
+DualQuat umath::DualQuat::operator+(const DualQuat &other) const { return DualQuat {real + other.real, dual + other.dual}; }
+DualQuat &umath::DualQuat::operator+=(const DualQuat &other)
+{
+	real = real + other.real;
+	dual = dual + other.dual;
+	return *this;
+}
+
+void umath::DualQuat::Normalize()
+{
+	auto len = uquat::length(real);
+	if(len == 0.f) {
+		*this = {};
+		return;
+	}
+	auto invLen = 1.f / len;
+	real = real * invLen;
+	dual = dual * invLen;
+	dual = dual - real * uquat::dot_product(real, dual);
+}
+DualQuat umath::DualQuat::GetNormal() const
+{
+	auto res = *this;
+	res.Normalize();
+	return res;
+}
+DualQuat umath::DualQuat::GetInverse() const { return DualQuat {conjugate(real), conjugate(dual)}; }
+
+Vector3 umath::DualQuat::TransformPoint(const Vector3 &p) const { return TransformVector(p) + GetTranslation(); }
+Vector3 umath::DualQuat::TransformVector(const Vector3 &v) const { return real * v; }
+
+/////////////
+
+namespace {
+	template<class T>
+	struct DualQuatLanes {
+		T rw, rx, ry, rz;
+		T dw, dx, dy, dz;
+	};
+	template<class T>
+	struct Vector3Lanes {
+		T x, y, z;
+	};
+};
+
+void umath::skin_dual_quat(std::span<const DualQuat> boneTransforms, std::span<const VertexWeight> vertexWeights, std::span<const Vector3> positions, std::span<Vector3> outPositions, std::span<const Vector3> normals,
+  std::span<Vector3> outNormals)
+{
+	MATHUTIL_PROFILE_SCOPE(SkinDualQuat);
+	using TFloat = simd::FloatN;
+	constexpr auto width = TFloat::width;
+	assert(vertexWeights.size() == positions.size() && outPositions.size() == positions.size());
+	assert(normals.size() == outNormals.size() && (normals.empty() || normals.size() == positions.size()));
+	auto hasNormals = !normals.empty();
+	auto numVerts = positions.size();
+	auto zero = TFloat::Set(0.f);
+	auto one = TFloat::Set(1.f);
+	auto two = TFloat::Set(2.f);
+	for(size_t i = 0; i < numVerts; i += width) {
+		auto count = static_cast<uint32_t>(umath::min<size_t>(width, numVerts - i));
+		// The bone transforms are gathered per influence, ignored bones use the identity with a weight of 0
+		DualQuatLanes<float> bones[4][width];
+		float weights[4][width];
+		Vector3Lanes<float> points[width];
+		Vector3Lanes<float> vecs[width];
+		for(uint32_t lane = 0; lane < width; ++lane) {
+			auto v = i + umath::min(lane, count - 1);
+			auto &vw = vertexWeights[v];
+			for(uint8_t j = 0; j < 4; ++j) {
+				auto boneId = vw.boneIds[j];
+				assert(boneId < static_cast<int32_t>(boneTransforms.size()));
+				DualQuat dq {};
+				weights[j][lane] = 0.f;
+				if(boneId >= 0) {
+					dq = boneTransforms[boneId];
+					weights[j][lane] = vw.weights[j];
+				}
+				bones[j][lane] = {dq.real.w, dq.real.x, dq.real.y, dq.real.z, dq.dual.w, dq.dual.x, dq.dual.y, dq.dual.z};
+			}
+			auto &p = positions[v];
+			points[lane] = {p.x, p.y, p.z};
+			if(hasNormals) {
+				auto &n = normals[v];
+				vecs[lane] = {n.x, n.y, n.z};
+			}
+		}
+
+		DualQuatLanes<TFloat> blended {zero, zero, zero, zero, zero, zero, zero, zero};
+		DualQuatLanes<TFloat> pivot;
+		for(uint8_t j = 0; j < 4; ++j) {
+			auto dq = kernels::load_lanes<TFloat>(bones[j]);
+			auto w = TFloat::Load(weights[j]);
+			if(j == 0)
+				pivot = dq;
+			else {
+				// Antipodal rotations would cancel each other out
+				auto d = dq.rw * pivot.rw + dq.rx * pivot.rx + dq.ry * pivot.ry + dq.rz * pivot.rz;
+				w = select(d < zero, -w, w);
+			}
+			blended.rw = blended.rw + dq.rw * w;
+			blended.rx = blended.rx + dq.rx * w;
+			blended.ry = blended.ry + dq.ry * w;
+			blended.rz = blended.rz + dq.rz * w;
+			blended.dw = blended.dw + dq.dw * w;
+			blended.dx = blended.dx + dq.dx * w;
+			blended.dy = blended.dy + dq.dy * w;
+			blended.dz = blended.dz + dq.dz * w;
+		}
+
+		// Vertices without any influence keep their position
+		auto lenSqr = blended.rw * blended.rw + blended.rx * blended.rx + blended.ry * blended.ry + blended.rz * blended.rz;
+		auto isValid = lenSqr > TFloat::Set(1e-12f);
+		auto invLenSqr = select(isValid, one / select(isValid, lenSqr, one), zero);
+		auto invLen = sqrt(invLenSqr);
+		kernels::QuatLanes<TFloat> rot {select(isValid, blended.rw * invLen, one), blended.rx * invLen, blended.ry * invLen, blended.rz * invLen};
+		// translation = 2 * (dual * conjugate(real)) / |real|^2, the part of the dual quaternion parallel to the real one doesn't contribute
+		auto s = two * invLenSqr;
+		auto tx = (blended.rw * blended.dx - blended.dw * blended.rx + (blended.ry * blended.dz - blended.rz * blended.dy)) * s;
+		auto ty = (blended.rw * blended.dy - blended.dw * blended.ry + (blended.rz * blended.dx - blended.rx * blended.dz)) * s;
+		auto tz = (blended.rw * blended.dz - blended.dw * blended.rz + (blended.rx * blended.dy - blended.ry * blended.dx)) * s;
+
+		auto p = kernels::load_lanes<TFloat>(points);
+		kernels::rotate(rot, p.x, p.y, p.z);
+		p.x = p.x + tx;
+		p.y = p.y + ty;
+		p.z = p.z + tz;
+		kernels::store_lanes(p, points, count);
+		for(uint32_t lane = 0; lane < count; ++lane)
+			outPositions[i + lane] = {points[lane].x, points[lane].y, points[lane].z};
+		if(!hasNormals)
+			continue;
+		auto n = kernels::load_lanes<TFloat>(vecs);
+		kernels::rotate(rot, n.x, n.y, n.z);
+		kernels::store_lanes(n, vecs, count);
+		for(uint32_t lane = 0; lane < count; ++lane)
+			outNormals[i + lane] = {vecs[lane].x, vecs[lane].y, vecs[lane].z};
+	}
+}
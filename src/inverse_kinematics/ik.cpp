@@ -4,36 +4,13 @@
 
 #include "mathutil/inverse_kinematics/ik.hpp"
 #include "mathutil/inverse_kinematics/constraints.hpp"
+#include "ik_kernels.hpp"
+#include "../profile_scope.hpp"
+#include <algorithm>
+#include <utility>
 
 using namespace uvec::ik;
 
-static Quat fromTo(const Vector3 &from, const Vector3 &to)
-{
-	auto f = uvec::get_normal(from);
-	auto t = uvec::get_normal(to);
-
-	if(f == t) {
-		return uquat::identity();
-	}
-	else if(f == t * -1.0f) {
-		auto ortho = Vector3(1, 0, 0);
-		if(fabsf(f.y) < fabsf(f.x)) {
-			ortho = Vector3(0, 1, 0);
-		}
-		if(fabsf(f.z) < fabs(f.y) && fabs(f.z) < fabsf(f.x)) {
-			ortho = Vector3(0, 0, 1);
-		}
-
-		auto axis = uvec::get_normal(uvec::cross(f, ortho));
-		return Quat(0, axis.x, axis.y, axis.z);
-	}
-
-	auto half = uvec::get_normal(f + t);
-	auto axis = uvec::cross(f, half);
-
-	return Quat(dot(f, half), axis.x, axis.y, axis.z);
-}
-
 CCDSolver::CCDSolver()
 {
 	mNumSteps = 15;
@@ -57,15 +34,18 @@ bool CCDSolver::Solve(const umath::ScaledTransform &target)
 	unsigned int last = size - 1;
 	float thresholdSq = mThreshold * mThreshold;
 	auto goal = target.GetOrigin();
+	BeginSolve(goal);
+	auto hasConstraints = std::any_of(mIKChain.begin(), mIKChain.end(), [](const IkJoint &joint) { return joint.HasConstraints(); });
+	auto effector = GetCachedGlobalTransform(last).GetOrigin();
+	auto residual = uvec::length(goal - effector);
 	for(unsigned int i = 0; i < mNumSteps; ++i) {
-		auto effector = GetGlobalTransform(last).GetOrigin();
+		effector = GetCachedGlobalTransform(last).GetOrigin();
 		if(uvec::length_sqr(goal - effector) < thresholdSq) {
-			return true;
+			return EndSolve(i, uvec::length(goal - effector), true);
 		}
 		for(int j = (int)size - 2; j >= 0; --j) {
-			effector = GetGlobalTransform(last).GetOrigin();
-
-			auto world = GetGlobalTransform(j);
+			// Only the transforms up to the joint are required, which are still cached
+			auto &world = GetCachedGlobalTransform(j);
 			auto position = world.GetOrigin();
 			auto rotation = world.GetRotation();
 
@@ -73,21 +53,34 @@ bool CCDSolver::Solve(const umath::ScaledTransform &target)
 			auto toGoal = goal - position;
 			Quat effectorToGoal = uquat::identity();
 			if(uvec::length_sqr(toGoal) > 0.00001f) {
-				effectorToGoal = fromTo(toEffector, toGoal);
+				effectorToGoal = kernels::from_to(toEffector, toGoal);
 			}
 
 			auto worldRotated = effectorToGoal * rotation;
 			auto localRotate = inverse(rotation) * worldRotated;
-			mIKChain[j].GetPose().SetRotation(mIKChain[j].GetPose().GetRotation() * localRotate);
-			ApplyConstraints();
-			effector = GetGlobalTransform(last).GetOrigin();
+			auto &pose = GetJointPose(j);
+			pose.SetRotation(pose.GetRotation() * localRotate);
+			if(hasConstraints) {
+				ApplyConstraints();
+				effector = GetCachedGlobalTransform(last).GetOrigin();
+			}
+			else {
+				// The rotation turns the subchain around the joint's origin, so the effector can be moved
+				// directly instead of recomputing the chain
+				effector = position + effectorToGoal * toEffector;
+			}
 			if(uvec::length_sqr(goal - effector) < thresholdSq) {
-				return true;
+				return EndSolve(i + 1, uvec::length(goal - effector), true);
 			}
 		}
+		auto prevResidual = residual;
+		residual = uvec::length(goal - effector);
+		if(IsStalled(prevResidual, residual)) {
+			return EndSolve(i + 1, residual, false);
+		}
 	}
 
-	return false;
+	return EndSolve(mNumSteps, residual, false);
 }
 
 /////
@@ -117,7 +110,7 @@ void FABRIKSolver::IKChainToWorld()
 {
 	unsigned int size = Size();
 	for(unsigned int i = 0; i < size; ++i) {
-		auto world = GetGlobalTransform(i);
+		auto &world = GetCachedGlobalTransform(i);
 		mWorldChain[i] = world.GetOrigin();
 
 		if(i >= 1) {
@@ -138,19 +131,20 @@ void FABRIKSolver::WorldToIKChain()
 	}
 
 	for(unsigned int i = 0; i < size - 1; ++i) {
-		auto world = GetGlobalTransform(i);
-		auto next = GetGlobalTransform(i + 1);
+		// Joint i was invalidated by the previous iteration, so only two transforms have to be recomputed
+		auto &world = GetCachedGlobalTransform(i);
 		auto position = world.GetOrigin();
 		auto rotation = world.GetRotation();
 
-		auto toNext = next.GetOrigin() - position;
+		auto toNext = GetCachedGlobalTransform(i + 1).GetOrigin() - position;
 		toNext = inverse(rotation) * toNext;
 
 		auto toDesired = mWorldChain[i + 1] - position;
 		toDesired = inverse(rotation) * toDesired;
 
-		auto delta = fromTo(toNext, toDesired);
-		mIKChain[i].GetPose().SetRotation(mIKChain[i].GetPose().GetRotation() * delta);
+		auto delta = kernels::from_to(toNext, toDesired);
+		auto &pose = GetJointPose(i);
+		pose.SetRotation(pose.GetRotation() * delta);
 	}
 }
 
@@ -191,15 +185,18 @@ bool FABRIKSolver::Solve(const umath::ScaledTransform &target)
 	unsigned int last = size - 1;
 	float thresholdSq = mThreshold * mThreshold;
 
-	IKChainToWorld();
 	auto goal = target.GetOrigin();
+	BeginSolve(goal);
+	IKChainToWorld();
 	auto base = mWorldChain[0];
+	auto residual = uvec::length(goal - mWorldChain[last]);
 
-	for(unsigned int i = 0; i < mNumSteps; ++i) {
+	unsigned int i = 0;
+	for(; i < mNumSteps; ++i) {
 		auto effector = mWorldChain[last];
 		if(uvec::length_sqr(goal - effector) < thresholdSq) {
 			WorldToIKChain();
-			return true;
+			return EndSolve(i, uvec::length(goal - effector), true);
 		}
 
 		IterateBackward(goal);
@@ -208,49 +205,177 @@ bool FABRIKSolver::Solve(const umath::ScaledTransform &target)
 		WorldToIKChain();
 		ApplyConstraints();
 		IKChainToWorld();
-	}
 
-	WorldToIKChain();
-	auto effector = GetGlobalTransform(last).GetOrigin();
-	if(uvec::length_sqr(goal - effector) < thresholdSq) {
-		return true;
+		auto prevResidual = residual;
+		residual = uvec::length(goal - mWorldChain[last]);
+		if(IsStalled(prevResidual, residual)) {
+			++i;
+			break;
+		}
 	}
 
-	return false;
+	WorldToIKChain();
+	auto effector = GetCachedGlobalTransform(last).GetOrigin();
+	return EndSolve(i, uvec::length(goal - effector), uvec::length_sqr(goal - effector) < thresholdSq);
 }
 
 /////
 
-umath::ScaledTransform IkSolver::GetLocalTransform(unsigned int index) { return mIKChain[index].GetPose(); }
+umath::ScaledTransform IkSolver::GetLocalTransform(unsigned int index) { return std::as_const(mIKChain[index]).GetPose(); }
 void IkSolver::SetLocalTransform(unsigned int index, const umath::ScaledTransform &t) { mIKChain[index].GetPose() = t; }
 
 void IkSolver::Resize(unsigned int newSize)
 {
 	mIKChain.resize(newSize);
-	for(auto &joint : mIKChain)
-		joint = IkJoint {*this};
+	for(uint32_t i = 0; i < newSize; ++i)
+		mIKChain[i] = IkJoint {*this, i};
+	m_globalTransforms.resize(newSize);
+	m_numValidGlobalTransforms = 0;
+	m_constraintDataDirty = true;
+}
+
+void IkSolver::SetWarmStartEnabled(bool enabled, float radius)
+{
+	m_warmStartEnabled = enabled;
+	m_warmStartRadius = radius;
+	if(!enabled)
+		ClearWarmStartCache();
+}
+
+void IkSolver::ClearWarmStartCache()
+{
+	for(auto &entry : m_warmStartCache) {
+		entry.rotations.clear();
+		entry.lastUse = 0;
+	}
+}
+
+void IkSolver::BeginSolve(const Vector3 &target)
+{
+	m_solveStart = std::chrono::steady_clock::now();
+	m_solveTarget = target;
+	m_lastSolveStats = {};
+	++m_solveIndex;
+	if(!m_warmStartEnabled)
+		return;
+	WarmStartEntry *best = nullptr;
+	auto bestDistSqr = m_warmStartRadius * m_warmStartRadius;
+	for(auto &entry : m_warmStartCache) {
+		if(entry.lastUse == 0 || entry.rotations.size() != mIKChain.size())
+			continue;
+		auto distSqr = uvec::length_sqr(entry.target - target);
+		if(distSqr <= bestDistSqr) {
+			best = &entry;
+			bestDistSqr = distSqr;
+		}
+	}
+	if(!best)
+		return;
+	best->lastUse = m_solveIndex;
+	for(size_t i = 0; i < mIKChain.size(); ++i)
+		GetJointPose(i).SetRotation(best->rotations[i]);
+	m_lastSolveStats.warmStarted = true;
+}
+
+bool IkSolver::EndSolve(uint32_t iterations, float residual, bool solved)
+{
+	if(m_warmStartEnabled) {
+		// The solution replaces the nearest entry within the radius, or the least recently used one
+		WarmStartEntry *entry = nullptr;
+		auto bestDistSqr = m_warmStartRadius * m_warmStartRadius;
+		for(auto &e : m_warmStartCache) {
+			auto distSqr = uvec::length_sqr(e.target - m_solveTarget);
+			if(e.lastUse != 0 && distSqr <= bestDistSqr) {
+				entry = &e;
+				bestDistSqr = distSqr;
+			}
+		}
+		if(!entry)
+			entry = &*std::min_element(m_warmStartCache.begin(), m_warmStartCache.end(), [](const WarmStartEntry &a, const WarmStartEntry &b) { return a.lastUse < b.lastUse; });
+		entry->target = m_solveTarget;
+		entry->lastUse = m_solveIndex;
+		entry->rotations.resize(mIKChain.size());
+		for(size_t i = 0; i < mIKChain.size(); ++i)
+			entry->rotations[i] = std::as_const(mIKChain[i]).GetPose().GetRotation();
+	}
+	m_lastSolveStats.iterations = iterations;
+	m_lastSolveStats.residual = residual;
+	m_lastSolveStats.solved = solved;
+	m_lastSolveStats.duration = std::chrono::steady_clock::now() - m_solveStart;
+#ifdef MATHUTIL_ENABLE_PROFILING
+	umath::profiling::record(umath::profiling::Function::IkSolve, m_lastSolveStats.duration);
+#endif
+	return solved;
+}
+
+void IkSolver::UpdateConstraintData() const
+{
+	if(!m_constraintDataDirty)
+		return;
+	m_constraintDataDirty = false;
+	m_constraintData.clear();
+	m_customConstraints.clear();
+	for(uint32_t i = 0; i < mIKChain.size(); ++i) {
+		for(auto &c : mIKChain[i].GetConstraints()) {
+			if(auto params = c->GetParams())
+				m_constraintData.push_back({i, *params});
+			else
+				m_customConstraints.push_back({i, c.get()});
+		}
+	}
+}
+
+std::span<const IkJointConstraint> IkSolver::GetConstraintData() const
+{
+	UpdateConstraintData();
+	return m_constraintData;
+}
+
+void IkSolver::ApplyConstraint(const IkJointConstraint &constraint)
+{
+	auto i = constraint.jointIndex;
+	Quat localRot;
+	if(kernels::apply_constraint(constraint.params, i, std::as_const(mIKChain[i]).GetPose().GetRotation(), [this](uint32_t j) -> const Quat & { return GetCachedGlobalTransform(j).GetRotation(); }, localRot))
+		GetJointPose(i).SetRotation(localRot);
 }
 
 void IkSolver::ApplyConstraints()
 {
-	for(auto i = decltype(mIKChain.size()) {0u}; i < mIKChain.size(); ++i) {
-		for(auto &c : mIKChain[i].GetConstraints())
-			c->Apply(i);
+	UpdateConstraintData();
+	auto itCustom = m_customConstraints.begin();
+	for(auto &c : m_constraintData) {
+		for(; itCustom != m_customConstraints.end() && itCustom->first < c.jointIndex; ++itCustom)
+			itCustom->second->Apply(itCustom->first);
+		ApplyConstraint(c);
 	}
+	for(; itCustom != m_customConstraints.end(); ++itCustom)
+		itCustom->second->Apply(itCustom->first);
 }
 
 void IkSolver::ApplyConstraints(uint32_t iConstraint)
 {
-	for(auto &c : mIKChain[iConstraint].GetConstraints())
-		c->Apply(iConstraint);
+	UpdateConstraintData();
+	auto itBegin = std::lower_bound(m_constraintData.begin(), m_constraintData.end(), iConstraint, [](const IkJointConstraint &c, uint32_t i) { return c.jointIndex < i; });
+	for(auto it = itBegin; it != m_constraintData.end() && it->jointIndex == iConstraint; ++it)
+		ApplyConstraint(*it);
+	for(auto &[i, c] : m_customConstraints) {
+		if(i == iConstraint)
+			c->Apply(i);
+	}
 }
 
-umath::ScaledTransform IkSolver::GetGlobalTransform(unsigned int index) const
+const umath::ScaledTransform &IkSolver::GetCachedGlobalTransform(uint32_t index) const
 {
-	unsigned int size = (unsigned int)mIKChain.size();
-	auto world = mIKChain[index].GetPose();
-	for(int i = (int)index - 1; i >= 0; --i) {
-		world = mIKChain[i].GetPose() * world;
-	}
-	return world;
+	// Only the joints after the last valid one have to be updated
+	for(auto i = m_numValidGlobalTransforms; i <= index; ++i)
+		m_globalTransforms[i] = (i > 0) ? m_globalTransforms[i - 1] * mIKChain[i].GetPose() : mIKChain[i].GetPose();
+	m_numValidGlobalTransforms = umath::max(m_numValidGlobalTransforms, index + 1);
+	return m_globalTransforms[index];
+}
+
+std::span<const umath::ScaledTransform> IkSolver::GetGlobalTransforms() const
+{
+	if(!mIKChain.empty())
+		GetCachedGlobalTransform(static_cast<uint32_t>(mIKChain.size() - 1));
+	return m_globalTransforms;
 }
@@ -0,0 +1,271 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/inverse_kinematics/ik_batch.hpp"
+#include "ik_kernels.hpp"
+#include "../task_pool.hpp"
+#include "../profile_scope.hpp"
+#include <algorithm>
+#include <cassert>
+
+using namespace uvec::ik;
+
+// Number of chains processed by a task at least
+static constexpr uint32_t CHAIN_GRAIN_SIZE = 16;
+
+// View of the pool data of one chain, with lazily updated global transforms (see IkSolver::GetCachedGlobalTransform)
+class IkBatchSolver::ChainState {
+  public:
+	ChainState(IkBatchSolver &solver, const Chain &chain)
+	    : positions {solver.m_positions.data() + chain.firstJoint}, rotations {solver.m_rotations.data() + chain.firstJoint}, worldPositions {solver.m_worldPositions.data() + chain.firstJoint},
+	      worldRotations {solver.m_worldRotations.data() + chain.firstJoint}, fabrikPositions {solver.m_fabrikPositions.data() + chain.firstJoint}, lengths {solver.m_lengths.data() + chain.firstJoint},
+	      constraints {solver.m_constraints.data() + chain.firstConstraint, chain.constraintCount}
+	{
+	}
+	Vector3 GetWorldPosition(uint32_t i)
+	{
+		Update(i);
+		return worldPositions[i];
+	}
+	Quat GetWorldRotation(uint32_t i)
+	{
+		Update(i);
+		return worldRotations[i];
+	}
+	void SetRotation(uint32_t i, const Quat &rot)
+	{
+		rotations[i] = rot;
+		m_numValid = umath::min(m_numValid, i);
+	}
+	void ApplyConstraints()
+	{
+		for(auto &c : constraints) {
+			Quat localRot;
+			if(kernels::apply_constraint(c.params, c.jointIndex, rotations[c.jointIndex], [this](uint32_t j) { return GetWorldRotation(j); }, localRot))
+				SetRotation(c.jointIndex, localRot);
+		}
+	}
+
+	Vector3 *const positions;
+	Quat *const rotations;
+	Vector3 *const worldPositions;
+	Quat *const worldRotations;
+	Vector3 *const fabrikPositions;
+	float *const lengths;
+	const std::span<const JointConstraint> constraints;
+  private:
+	// Same composition as the ScaledTransform multiplication, the scale doesn't affect positions
+	void Update(uint32_t i)
+	{
+		for(; m_numValid <= i; ++m_numValid) {
+			auto j = m_numValid;
+			if(j == 0) {
+				worldPositions[0] = positions[0];
+				worldRotations[0] = rotations[0];
+				continue;
+			}
+			auto &parentRot = worldRotations[j - 1];
+			worldPositions[j] = worldPositions[j - 1] + parentRot * positions[j];
+			worldRotations[j] = parentRot * rotations[j];
+		}
+	}
+	uint32_t m_numValid = 0;
+};
+
+IkBatchSolver::IkBatchSolver(uint32_t threadCount)
+{
+	if(threadCount == 0)
+		threadCount = umath::max(std::thread::hardware_concurrency(), 1u);
+	if(threadCount > 1)
+		m_taskPool = std::make_unique<umath::TaskPool>(threadCount - 1);
+}
+
+IkBatchSolver::~IkBatchSolver() {}
+
+IkBatchSolver::ChainId IkBatchSolver::AddChain(std::span<const umath::ScaledTransform> localPoses, std::span<const JointConstraint> constraints, const ChainSettings &settings)
+{
+	Chain chain {};
+	chain.firstJoint = static_cast<uint32_t>(m_positions.size());
+	chain.jointCount = static_cast<uint32_t>(localPoses.size());
+	chain.firstConstraint = static_cast<uint32_t>(m_constraints.size());
+	chain.constraintCount = static_cast<uint32_t>(constraints.size());
+	chain.settings = settings;
+	chain.target = localPoses.empty() ? Vector3 {} : localPoses.front().GetOrigin();
+	chain.solved = false;
+	for(auto &pose : localPoses) {
+		m_positions.push_back(pose.GetOrigin());
+		m_rotations.push_back(pose.GetRotation());
+		m_scales.push_back(pose.GetScale());
+	}
+	auto numJoints = m_positions.size();
+	m_worldPositions.resize(numJoints);
+	m_worldRotations.resize(numJoints);
+	m_fabrikPositions.resize(numJoints);
+	m_lengths.resize(numJoints);
+
+	// Constraints are applied in joint order, the order of multiple constraints on the same joint is retained
+	m_constraints.insert(m_constraints.end(), constraints.begin(), constraints.end());
+	auto itBegin = m_constraints.begin() + chain.firstConstraint;
+	std::stable_sort(itBegin, m_constraints.end(), [](const JointConstraint &a, const JointConstraint &b) { return a.jointIndex < b.jointIndex; });
+	assert(std::all_of(itBegin, m_constraints.end(), [&chain](const JointConstraint &c) { return c.jointIndex < chain.jointCount; }));
+
+	m_chains.push_back(chain);
+	return static_cast<ChainId>(m_chains.size() - 1);
+}
+
+void IkBatchSolver::Clear()
+{
+	m_chains.clear();
+	m_positions.clear();
+	m_rotations.clear();
+	m_scales.clear();
+	m_worldPositions.clear();
+	m_worldRotations.clear();
+	m_fabrikPositions.clear();
+	m_lengths.clear();
+	m_constraints.clear();
+}
+
+void IkBatchSolver::SetLocalPose(ChainId chainId, uint32_t jointIndex, const umath::ScaledTransform &pose)
+{
+	auto &chain = m_chains[chainId];
+	assert(jointIndex < chain.jointCount);
+	auto idx = chain.firstJoint + jointIndex;
+	m_positions[idx] = pose.GetOrigin();
+	m_rotations[idx] = pose.GetRotation();
+	m_scales[idx] = pose.GetScale();
+}
+
+umath::ScaledTransform IkBatchSolver::GetLocalPose(ChainId chainId, uint32_t jointIndex) const
+{
+	auto &chain = m_chains[chainId];
+	assert(jointIndex < chain.jointCount);
+	auto idx = chain.firstJoint + jointIndex;
+	return {m_positions[idx], m_rotations[idx], m_scales[idx]};
+}
+
+void IkBatchSolver::GetLocalPoses(ChainId chainId, std::span<umath::ScaledTransform> outPoses) const
+{
+	auto &chain = m_chains[chainId];
+	assert(outPoses.size() >= chain.jointCount);
+	for(uint32_t i = 0; i < chain.jointCount; ++i)
+		outPoses[i] = GetLocalPose(chainId, i);
+}
+
+uint32_t IkBatchSolver::Solve()
+{
+	MATHUTIL_PROFILE_SCOPE(IkBatchSolve);
+	auto solveChains = [this](uint32_t begin, uint32_t end) {
+		for(auto i = begin; i < end; ++i)
+			m_chains[i].solved = SolveChain(m_chains[i]);
+	};
+	auto numChains = static_cast<uint32_t>(m_chains.size());
+	if(m_taskPool && numChains > CHAIN_GRAIN_SIZE)
+		m_taskPool->ParallelFor(numChains, CHAIN_GRAIN_SIZE, solveChains);
+	else
+		solveChains(0, numChains);
+	return static_cast<uint32_t>(std::count_if(m_chains.begin(), m_chains.end(), [](const Chain &chain) { return chain.solved; }));
+}
+
+bool IkBatchSolver::SolveChain(const Chain &chain)
+{
+	if(chain.jointCount == 0)
+		return false;
+	ChainState state {*this, chain};
+	switch(chain.settings.algorithm) {
+	case Algorithm::CCD:
+		return SolveCCD(state, chain);
+	case Algorithm::FABRIK:
+		return SolveFABRIK(state, chain);
+	}
+	return false;
+}
+
+// See CCDSolver::Solve
+bool IkBatchSolver::SolveCCD(ChainState &state, const Chain &chain)
+{
+	auto last = chain.jointCount - 1;
+	auto thresholdSq = chain.settings.threshold * chain.settings.threshold;
+	auto &goal = chain.target;
+	auto hasConstraints = !state.constraints.empty();
+	for(uint32_t i = 0; i < chain.settings.numSteps; ++i) {
+		auto effector = state.GetWorldPosition(last);
+		if(uvec::length_sqr(goal - effector) < thresholdSq)
+			return true;
+		for(auto j = static_cast<int32_t>(last) - 1; j >= 0; --j) {
+			auto position = state.GetWorldPosition(j);
+			auto rotation = state.GetWorldRotation(j);
+
+			auto toEffector = effector - position;
+			auto toGoal = goal - position;
+			Quat effectorToGoal = uquat::identity();
+			if(uvec::length_sqr(toGoal) > 0.00001f)
+				effectorToGoal = kernels::from_to(toEffector, toGoal);
+
+			auto worldRotated = effectorToGoal * rotation;
+			auto localRotate = inverse(rotation) * worldRotated;
+			state.SetRotation(j, state.rotations[j] * localRotate);
+			if(hasConstraints) {
+				state.ApplyConstraints();
+				effector = state.GetWorldPosition(last);
+			}
+			else
+				effector = position + effectorToGoal * toEffector;
+			if(uvec::length_sqr(goal - effector) < thresholdSq)
+				return true;
+		}
+	}
+	return false;
+}
+
+// See FABRIKSolver::Solve
+bool IkBatchSolver::SolveFABRIK(ChainState &state, const Chain &chain)
+{
+	auto size = chain.jointCount;
+	auto last = size - 1;
+	auto thresholdSq = chain.settings.threshold * chain.settings.threshold;
+	auto &goal = chain.target;
+	auto *worldChain = state.fabrikPositions;
+	auto *lengths = state.lengths;
+	auto chainToWorld = [&]() {
+		for(uint32_t i = 0; i < size; ++i) {
+			worldChain[i] = state.GetWorldPosition(i);
+			if(i >= 1)
+				lengths[i] = uvec::length(worldChain[i] - worldChain[i - 1]);
+		}
+		lengths[0] = 0.f;
+	};
+	auto worldToChain = [&]() {
+		for(uint32_t i = 0; i < last; ++i) {
+			auto position = state.GetWorldPosition(i);
+			auto invRotation = inverse(state.GetWorldRotation(i));
+			auto toNext = invRotation * (state.GetWorldPosition(i + 1) - position);
+			auto toDesired = invRotation * (worldChain[i + 1] - position);
+			state.SetRotation(i, state.rotations[i] * kernels::from_to(toNext, toDesired));
+		}
+	};
+
+	chainToWorld();
+	auto base = worldChain[0];
+	for(uint32_t i = 0; i < chain.settings.numSteps; ++i) {
+		if(uvec::length_sqr(goal - worldChain[last]) < thresholdSq) {
+			worldToChain();
+			return true;
+		}
+		// Backward pass
+		worldChain[last] = goal;
+		for(auto j = static_cast<int32_t>(last) - 1; j >= 0; --j)
+			worldChain[j] = worldChain[j + 1] + uvec::get_normal(worldChain[j] - worldChain[j + 1]) * lengths[j + 1];
+		// Forward pass
+		worldChain[0] = base;
+		for(uint32_t j = 1; j < size; ++j)
+			worldChain[j] = worldChain[j - 1] + uvec::get_normal(worldChain[j] - worldChain[j - 1]) * lengths[j];
+
+		worldToChain();
+		state.ApplyConstraints();
+		chainToWorld();
+	}
+	worldToChain();
+	return uvec::length_sqr(goal - state.GetWorldPosition(last)) < thresholdSq;
+}
@@ -0,0 +1,227 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/inverse_kinematics/ik.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace uvec::ik;
+
+// Rotation vector (axis * angle) of the rotation from the current to the target rotation
+static Vector3 get_rotation_error(const Quat &rot, const Quat &target)
+{
+	auto delta = target * inverse(rot);
+	// Shortest path
+	if(delta.w < 0.f)
+		delta = -delta;
+	Vector3 v {delta.x, delta.y, delta.z};
+	auto len = uvec::length(v);
+	if(len < 0.000001f)
+		return {};
+	return v * (2.f * atan2f(len, delta.w) / len);
+}
+
+DLSSolver::DLSSolver()
+{
+	mNumSteps = 15;
+	mThreshold = 0.00001f;
+}
+
+unsigned int DLSSolver::GetNumSteps() { return mNumSteps; }
+void DLSSolver::SetNumSteps(unsigned int numSteps) { mNumSteps = numSteps; }
+
+float DLSSolver::GetThreshold() { return mThreshold; }
+void DLSSolver::SetThreshold(float value) { mThreshold = value; }
+
+float DLSSolver::GetAngleThreshold() { return m_angleThreshold; }
+void DLSSolver::SetAngleThreshold(float value) { m_angleThreshold = value; }
+
+float DLSSolver::GetDamping() { return m_damping; }
+void DLSSolver::SetDamping(float damping) { m_damping = damping; }
+
+bool DLSSolver::Solve(const umath::ScaledTransform &target)
+{
+	if(Size() == 0)
+		return false;
+	IkEffector effector {};
+	effector.jointIndex = Size() - 1;
+	effector.target = target;
+	effector.rotationWeight = 1.f;
+	return Solve(std::span<const IkEffector> {&effector, 1});
+}
+
+bool DLSSolver::ComputeErrors(std::span<const IkEffector> effectors, uint32_t &outNumRows, float &outResidual)
+{
+	outResidual = 0.f;
+	auto thresholdSq = mThreshold * mThreshold;
+	auto angleThreshold = static_cast<float>(umath::deg_to_rad(m_angleThreshold));
+	auto converged = true;
+	uint32_t row = 0;
+	for(auto &effector : effectors) {
+		auto &world = GetCachedGlobalTransform(effector.jointIndex);
+		if(effector.positionWeight > 0.f) {
+			auto error = effector.target.GetOrigin() - world.GetOrigin();
+			converged = converged && uvec::length_sqr(error) < thresholdSq;
+			for(uint8_t i = 0; i < 3; ++i)
+				m_errors[row++] = error[i] * effector.positionWeight;
+		}
+		if(effector.rotationWeight > 0.f) {
+			auto error = get_rotation_error(world.GetRotation(), effector.target.GetRotation());
+			converged = converged && uvec::length(error) < angleThreshold;
+			for(uint8_t i = 0; i < 3; ++i)
+				m_errors[row++] = error[i] * effector.rotationWeight;
+		}
+	}
+	outNumRows = row;
+	for(uint32_t r = 0; r < row; ++r)
+		outResidual += m_errors[r] * m_errors[r];
+	outResidual = std::sqrt(outResidual);
+	return converged;
+}
+
+void DLSSolver::ComputeJacobian(std::span<const IkEffector> effectors)
+{
+	uint32_t row = 0;
+	for(auto &effector : effectors) {
+		auto e = effector.jointIndex;
+		if(effector.positionWeight > 0.f) {
+			auto w = effector.positionWeight;
+			auto effectorPos = GetCachedGlobalTransform(e).GetOrigin();
+			auto *rx = &m_jacobian[row * MAX_COLUMNS];
+			auto *ry = rx + MAX_COLUMNS;
+			auto *rz = ry + MAX_COLUMNS;
+			// Rotating joint j around a world axis moves the effector by axis x (effector - joint)
+			for(uint32_t j = 0; j <= e; ++j) {
+				auto d = (j < e) ? (effectorPos - GetCachedGlobalTransform(j).GetOrigin()) * w : Vector3 {};
+				auto c = j * 3;
+				rx[c] = 0.f;
+				ry[c] = -d.z;
+				rz[c] = d.y;
+				rx[c + 1] = d.z;
+				ry[c + 1] = 0.f;
+				rz[c + 1] = -d.x;
+				rx[c + 2] = -d.y;
+				ry[c + 2] = d.x;
+				rz[c + 2] = 0.f;
+			}
+			row += 3;
+		}
+		if(effector.rotationWeight > 0.f) {
+			auto w = effector.rotationWeight;
+			for(uint8_t a = 0; a < 3; ++a) {
+				auto *r = &m_jacobian[(row + a) * MAX_COLUMNS];
+				for(uint32_t j = 0; j <= e; ++j) {
+					r[j * 3] = 0.f;
+					r[j * 3 + 1] = 0.f;
+					r[j * 3 + 2] = 0.f;
+					r[j * 3 + a] = w;
+				}
+			}
+			row += 3;
+		}
+	}
+}
+
+bool DLSSolver::ComputeDeltas(uint32_t numRows, uint32_t numColumns)
+{
+	// A = J * J^T + damping^2 * I, only the lower triangle is required for the Cholesky decomposition
+	auto dampingSq = m_damping * m_damping;
+	for(uint32_t r = 0; r < numRows; ++r) {
+		auto *jr = &m_jacobian[r * MAX_COLUMNS];
+		for(uint32_t c = 0; c <= r; ++c) {
+			auto *jc = &m_jacobian[c * MAX_COLUMNS];
+			auto sum = 0.f;
+			for(uint32_t k = 0; k < numColumns; ++k)
+				sum += jr[k] * jc[k];
+			m_system[r * MAX_ROWS + c] = sum + ((r == c) ? dampingSq : 0.f);
+		}
+	}
+	// In-place Cholesky decomposition A = L * L^T
+	for(uint32_t r = 0; r < numRows; ++r) {
+		for(uint32_t c = 0; c <= r; ++c) {
+			auto sum = m_system[r * MAX_ROWS + c];
+			for(uint32_t k = 0; k < c; ++k)
+				sum -= m_system[r * MAX_ROWS + k] * m_system[c * MAX_ROWS + k];
+			if(r == c) {
+				if(sum <= 0.f)
+					return false;
+				m_system[r * MAX_ROWS + r] = std::sqrt(sum);
+			}
+			else
+				m_system[r * MAX_ROWS + c] = sum / m_system[c * MAX_ROWS + c];
+		}
+	}
+	// Solve L * L^T * y = e, the errors are overwritten with y
+	for(uint32_t r = 0; r < numRows; ++r) {
+		auto sum = m_errors[r];
+		for(uint32_t k = 0; k < r; ++k)
+			sum -= m_system[r * MAX_ROWS + k] * m_errors[k];
+		m_errors[r] = sum / m_system[r * MAX_ROWS + r];
+	}
+	for(int32_t r = static_cast<int32_t>(numRows) - 1; r >= 0; --r) {
+		auto sum = m_errors[r];
+		for(uint32_t k = r + 1; k < numRows; ++k)
+			sum -= m_system[k * MAX_ROWS + r] * m_errors[k];
+		m_errors[r] = sum / m_system[r * MAX_ROWS + r];
+	}
+	// Joint deltas = J^T * y
+	std::fill(m_deltas.begin(), m_deltas.begin() + numColumns, 0.f);
+	for(uint32_t r = 0; r < numRows; ++r) {
+		auto *jr = &m_jacobian[r * MAX_COLUMNS];
+		for(uint32_t k = 0; k < numColumns; ++k)
+			m_deltas[k] += jr[k] * m_errors[r];
+	}
+	return true;
+}
+
+bool DLSSolver::Solve(std::span<const IkEffector> effectors)
+{
+	auto size = Size();
+	if(effectors.empty() || effectors.size() > MAX_EFFECTORS)
+		return false;
+	uint32_t numJoints = 0;
+	for(auto &effector : effectors) {
+		if(effector.jointIndex >= size || effector.jointIndex >= MAX_JOINTS)
+			return false;
+		numJoints = umath::max(numJoints, effector.jointIndex + 1);
+	}
+	auto numColumns = numJoints * 3;
+	auto hasConstraints = std::any_of(mIKChain.begin(), mIKChain.begin() + numJoints, [](const IkJoint &joint) { return joint.HasConstraints(); });
+	// The warm start is keyed by the target of the first effector
+	BeginSolve(effectors.front().target.GetOrigin());
+	uint32_t numRows;
+	float residual;
+	auto prevResidual = std::numeric_limits<float>::max();
+	for(unsigned int i = 0; i < mNumSteps; ++i) {
+		if(ComputeErrors(effectors, numRows, residual))
+			return EndSolve(i, residual, true);
+		if(IsStalled(prevResidual, residual))
+			return EndSolve(i, residual, false);
+		prevResidual = residual;
+		// Rows of effectors closer to the root than the deepest one are only partially written by ComputeJacobian
+		for(uint32_t r = 0; r < numRows; ++r)
+			std::fill_n(&m_jacobian[r * MAX_COLUMNS], numColumns, 0.f);
+		ComputeJacobian(effectors);
+		if(!ComputeDeltas(numRows, numColumns))
+			return EndSolve(i, residual, false);
+
+		// The deltas are rotations around world axes through the joint origins. They are converted to the local space of
+		// the joints with the parent rotations of the current pose, which remain cached when iterating from the end of the chain.
+		for(int32_t j = static_cast<int32_t>(numJoints) - 1; j >= 0; --j) {
+			Vector3 delta {m_deltas[j * 3], m_deltas[j * 3 + 1], m_deltas[j * 3 + 2]};
+			auto angle = uvec::length(delta);
+			if(angle < 0.000001f)
+				continue;
+			auto worldDelta = angleAxis(angle, delta / angle);
+			auto parentRot = (j > 0) ? GetCachedGlobalTransform(j - 1).GetRotation() : uquat::identity();
+			auto &pose = GetJointPose(j);
+			pose.SetRotation(inverse(parentRot) * worldDelta * parentRot * pose.GetRotation());
+		}
+		if(hasConstraints)
+			ApplyConstraints();
+	}
+	auto solved = ComputeErrors(effectors, numRows, residual);
+	return EndSolve(mNumSteps, residual, solved);
+}
@@ -0,0 +1,103 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "ik_kernels.hpp"
+#include "mathutil/eulerangles.h"
+
+using namespace uvec::ik;
+
+Quat kernels::from_to(const Vector3 &from, const Vector3 &to)
+{
+	auto f = uvec::get_normal(from);
+	auto t = uvec::get_normal(to);
+
+	if(f == t) {
+		return uquat::identity();
+	}
+	else if(f == t * -1.0f) {
+		auto ortho = Vector3(1, 0, 0);
+		if(fabsf(f.y) < fabsf(f.x)) {
+			ortho = Vector3(0, 1, 0);
+		}
+		if(fabsf(f.z) < fabs(f.y) && fabs(f.z) < fabsf(f.x)) {
+			ortho = Vector3(0, 0, 1);
+		}
+
+		auto axis = uvec::get_normal(uvec::cross(f, ortho));
+		return Quat(0, axis.x, axis.y, axis.z);
+	}
+
+	auto half = uvec::get_normal(f + t);
+	auto axis = uvec::cross(f, half);
+
+	return Quat(dot(f, half), axis.x, axis.y, axis.z);
+}
+
+Quat kernels::apply_hinge(const IkHingeParams &params, const Quat &localRot, const Quat &parentRot, const Quat &rot)
+{
+	auto currentHinge = rot * params.axis;
+	auto desiredHinge = parentRot * params.axis;
+
+	auto hingeRot = uvec::get_rotation(currentHinge, desiredHinge);
+
+	auto newLocalRot = hingeRot * localRot;
+	if(params.limits.has_value()) {
+		auto tmpRot = uquat::create_look_rotation(uvec::get_normal(uvec::cross(params.axis, uvec::RIGHT)), params.axis);
+		newLocalRot = uquat::get_inverse(tmpRot) * newLocalRot;
+		newLocalRot = uquat::clamp_rotation(newLocalRot, EulerAngles {0.f, params.limits->x, 0.f}, EulerAngles {0.f, params.limits->y, 0.f});
+		newLocalRot = tmpRot * newLocalRot;
+	}
+	return newLocalRot;
+}
+
+#define VEC3_EPSILON 0.000001f
+#define QUAT_DEG2RAD 0.0174533f
+static float angle(const Vector3 &l, const Vector3 &r)
+{
+	float sqMagL = l.x * l.x + l.y * l.y + l.z * l.z;
+	float sqMagR = r.x * r.x + r.y * r.y + r.z * r.z;
+
+	if(sqMagL < VEC3_EPSILON || sqMagR < VEC3_EPSILON) {
+		return 0.0f;
+	}
+
+	float dot = l.x * r.x + l.y * r.y + l.z * r.z;
+	float len = sqrtf(sqMagL) * sqrtf(sqMagR);
+	return acosf(dot / len);
+}
+
+bool kernels::apply_ball_socket(const IkBallSocketParams &params, const Quat &parentRot, const Quat &rot, Quat &outLocalRot)
+{
+	auto parentDir = parentRot * Vector3(0, 0, 1);
+	auto thisDir = rot * Vector3(0, 0, 1);
+	float angle = ::angle(parentDir, thisDir);
+	if(angle <= params.limit * QUAT_DEG2RAD)
+		return false;
+	auto correction = uvec::cross(parentDir, thisDir);
+	uvec::normalize(&correction);
+	auto worldSpaceRotation = angleAxis(params.limit * QUAT_DEG2RAD, correction) * parentRot;
+	outLocalRot = inverse(parentRot) * worldSpaceRotation;
+	return true;
+}
+
+bool kernels::apply_twist_limit(const IkTwistLimitParams &params, const Quat &localRot, Quat &outLocalRot)
+{
+	// Swing-twist decomposition: The twist is the projection of the rotation onto the axis
+	auto proj = params.axis * uvec::dot(Vector3 {localRot.x, localRot.y, localRot.z}, params.axis);
+	auto projLen = uvec::length(proj);
+	// Undefined for swings of 180 degrees, in which case the rotation is left as is
+	if(projLen < VEC3_EPSILON && fabsf(localRot.w) < VEC3_EPSILON)
+		return false;
+	// Twist angle in [0, pi], the direction is encoded in the sign of the projection
+	auto twistSign = (uvec::dot(proj, params.axis) * localRot.w >= 0.f) ? 1.f : -1.f;
+	auto twistAngle = 2.f * atan2f(projLen, fabsf(localRot.w));
+	auto limit = params.limit * QUAT_DEG2RAD;
+	if(twistAngle <= limit)
+		return false;
+	Quat twist {localRot.w, proj.x, proj.y, proj.z};
+	twist = uquat::get_normal(twist);
+	auto swing = localRot * inverse(twist);
+	outLocalRot = swing * angleAxis(limit * twistSign, params.axis);
+	return true;
+}
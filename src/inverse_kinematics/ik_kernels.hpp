@@ -0,0 +1,53 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+* License, v. 2.0. If a copy of the MPL was not distributed with this
+* file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UMATH_IK_KERNELS_HPP__
+#define __UMATH_IK_KERNELS_HPP__
+
+// Internal header, only to be included by the library's translation units.
+
+#include "mathutil/inverse_kinematics/constraints.hpp"
+#include <variant>
+
+// Stateless building blocks shared by the IK solvers
+namespace uvec::ik::kernels {
+	// Shortest rotation from one direction to another
+	Quat from_to(const Vector3 &from, const Vector3 &to);
+
+	// The constraint functions return the new local rotation of the joint, based on the global rotations of the joint and its parent.
+	// The parent rotation is the identity for the root joint.
+	Quat apply_hinge(const IkHingeParams &params, const Quat &localRot, const Quat &parentRot, const Quat &rot);
+	// Returns false if the joint is within the limit, in which case outLocalRot is left untouched
+	bool apply_ball_socket(const IkBallSocketParams &params, const Quat &parentRot, const Quat &rot, Quat &outLocalRot);
+	// Only depends on the local rotation. Returns false if the twist is within the limit, in which case outLocalRot is left untouched.
+	bool apply_twist_limit(const IkTwistLimitParams &params, const Quat &localRot, Quat &outLocalRot);
+
+	// Visitor consisting of several lambdas, for std::visit
+	template<class... TFunctions>
+	struct Overloaded : TFunctions... {
+		using TFunctions::operator()...;
+	};
+
+	// Applies a constraint of any type to joint i. fGetWorldRotation(i) has to return the current global rotation of a joint,
+	// it is only called for the types that depend on it. Returns false if the local rotation doesn't have to be changed.
+	template<class TGetWorldRotation>
+	bool apply_constraint(const IkConstraintParams &params, uint32_t i, const Quat &localRot, const TGetWorldRotation &fGetWorldRotation, Quat &outLocalRot)
+	{
+		auto applyHinge = [&](const IkHingeParams &hinge) {
+			if(i == 0)
+				return false;
+			outLocalRot = apply_hinge(hinge, localRot, fGetWorldRotation(i - 1), fGetWorldRotation(i));
+			return true;
+		};
+		auto applyBallSocket = [&](const IkBallSocketParams &ballSocket) {
+			auto parentRot = (i > 0) ? fGetWorldRotation(i - 1) : uquat::identity();
+			return apply_ball_socket(ballSocket, parentRot, fGetWorldRotation(i), outLocalRot);
+		};
+		auto applyTwistLimit = [&](const IkTwistLimitParams &twistLimit) { return apply_twist_limit(twistLimit, localRot, outLocalRot); };
+		// A parameter type without an overload fails to compile
+		return std::visit(Overloaded {applyHinge, applyBallSocket, applyTwistLimit}, params);
+	}
+};
+
+#endif
@@ -6,8 +6,17 @@
 
 using namespace uvec::ik;
 
+umath::ScaledTransform &IkJoint::GetPose()
+{
+	if(m_ikSolver)
+		m_ikSolver->InvalidateGlobalTransforms(m_chainIndex);
+	return m_pose;
+}
+
 IkConstraint &IkJoint::AddConstraint(std::unique_ptr<IkConstraint> constraint)
 {
 	m_constraints.push_back(std::move(constraint));
+	if(m_ikSolver)
+		m_ikSolver->InvalidateConstraintData();
 	return *m_constraints.back();
 }
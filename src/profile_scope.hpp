@@ -0,0 +1,35 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UMATH_PROFILE_SCOPE_HPP__
+#define __UMATH_PROFILE_SCOPE_HPP__
+
+// Internal header, only to be included by the library's translation units.
+// MATHUTIL_PROFILE_SCOPE(function) times the rest of the enclosing scope as one call of a umath::profiling::Function.
+
+#ifdef MATHUTIL_ENABLE_PROFILING
+#include "mathutil/profiling.hpp"
+#include <chrono>
+
+namespace umath::profiling {
+	// Records the time until the end of the scope as one call of the function
+	class ScopedTimer {
+	  public:
+		ScopedTimer(Function function) : m_function {function}, m_start {std::chrono::steady_clock::now()} {}
+		ScopedTimer(const ScopedTimer &) = delete;
+		ScopedTimer &operator=(const ScopedTimer &) = delete;
+		~ScopedTimer() { record(m_function, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start)); }
+	  private:
+		Function m_function;
+		std::chrono::steady_clock::time_point m_start;
+	};
+};
+
+#define MATHUTIL_PROFILE_SCOPE(function) ::umath::profiling::ScopedTimer mathutilProfileScope {::umath::profiling::Function::function}
+#else
+// Expands to nothing, so the instrumented functions are unchanged
+#define MATHUTIL_PROFILE_SCOPE(function)
+#endif
+
+#endif
@@ -0,0 +1,191 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/profiling.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+using namespace umath;
+
+double umath::profiling::FunctionStats::GetAverageNanoseconds() const { return (callCount > 0) ? static_cast<double>(totalNanoseconds) / static_cast<double>(callCount) : 0.0; }
+
+uint64_t umath::profiling::FunctionStats::GetPercentileNanoseconds(double percentile) const
+{
+	if(callCount == 0)
+		return 0;
+	auto rank = static_cast<uint64_t>(std::clamp(percentile, 0.0, 1.0) * static_cast<double>(callCount - 1)) + 1;
+	uint64_t count = 0;
+	for(uint32_t i = 0; i < HISTOGRAM_BUCKET_COUNT - 1; ++i) {
+		count += histogram[i];
+		if(count >= rank)
+			return GetBucketLowerBound(i + 1);
+	}
+	return GetBucketLowerBound(HISTOGRAM_BUCKET_COUNT - 1);
+}
+
+profiling::FunctionStats &umath::profiling::FunctionStats::operator+=(const FunctionStats &other)
+{
+	callCount += other.callCount;
+	totalNanoseconds += other.totalNanoseconds;
+	for(uint32_t i = 0; i < HISTOGRAM_BUCKET_COUNT; ++i)
+		histogram[i] += other.histogram[i];
+	return *this;
+}
+
+std::string_view umath::profiling::get_function_name(Function function)
+{
+	switch(function) {
+	case Function::LineAabb:
+		return "line_aabb";
+	case Function::LineAabbBatch:
+		return "line_aabb (batch)";
+	case Function::AabbInPlaneMesh:
+		return "aabb_in_plane_mesh";
+	case Function::AabbInPlaneMeshBatch:
+		return "aabb_in_plane_mesh (batch)";
+	case Function::SphereInPlaneMesh:
+		return "sphere_in_plane_mesh";
+	case Function::AabbTriangle:
+		return "aabb_triangle";
+	case Function::AabbTriangleBatch:
+		return "aabb_triangle (batch)";
+	case Function::IkSolve:
+		return "IkSolver::Solve";
+	case Function::IkBatchSolve:
+		return "IkBatchSolver::Solve";
+	case Function::ComputeWorldTransforms:
+		return "compute_world_transforms";
+	case Function::SkinDualQuat:
+		return "skin_dual_quat";
+	case Function::Count:
+		break;
+	}
+	return "";
+}
+
+#ifdef MATHUTIL_ENABLE_PROFILING
+
+namespace {
+	// Call count, total duration and histogram
+	constexpr uint32_t VALUE_COUNT = 2 + profiling::HISTOGRAM_BUCKET_COUNT;
+	using Values = std::array<uint64_t, VALUE_COUNT>;
+
+	// Only written by the owning thread, but read by others for the snapshots. Since there is a single writer, the
+	// increments don't have to be atomic read-modify-write operations.
+	struct ThreadCounters {
+		ThreadCounters();
+		~ThreadCounters();
+		void Add(profiling::Function function, uint32_t index, uint64_t value)
+		{
+			auto &v = values[static_cast<uint32_t>(function)][index];
+			v.store(v.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		}
+		Values Load(uint32_t function) const
+		{
+			Values result;
+			for(uint32_t i = 0; i < VALUE_COUNT; ++i)
+				result[i] = values[function][i].load(std::memory_order_relaxed);
+			return result;
+		}
+		std::array<std::array<std::atomic<uint64_t>, VALUE_COUNT>, profiling::FUNCTION_COUNT> values {};
+		// Values at the time of the last reset, guarded by the registry mutex
+		std::array<Values, profiling::FUNCTION_COUNT> baseline {};
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		std::vector<ThreadCounters *> threads;
+		// Counters of exited threads since the last reset
+		profiling::Snapshot retired;
+	};
+	// Intentionally leaked, threads may still exit after the static destructors have run
+	Registry &get_registry()
+	{
+		static auto *registry = new Registry {};
+		return *registry;
+	}
+
+	void add_to_snapshot(const ThreadCounters &counters, profiling::Snapshot &snapshot)
+	{
+		for(uint32_t f = 0; f < profiling::FUNCTION_COUNT; ++f) {
+			auto values = counters.Load(f);
+			auto &baseline = counters.baseline[f];
+			auto &stats = snapshot.functions[f];
+			stats.callCount += values[0] - baseline[0];
+			stats.totalNanoseconds += values[1] - baseline[1];
+			for(uint32_t i = 0; i < profiling::HISTOGRAM_BUCKET_COUNT; ++i)
+				stats.histogram[i] += values[2 + i] - baseline[2 + i];
+		}
+	}
+
+	ThreadCounters::ThreadCounters()
+	{
+		auto &registry = get_registry();
+		std::scoped_lock lock {registry.mutex};
+		registry.threads.push_back(this);
+	}
+	ThreadCounters::~ThreadCounters()
+	{
+		auto &registry = get_registry();
+		std::scoped_lock lock {registry.mutex};
+		add_to_snapshot(*this, registry.retired);
+		registry.threads.erase(std::find(registry.threads.begin(), registry.threads.end(), this));
+	}
+
+	thread_local ThreadCounters g_threadCounters;
+};
+
+bool umath::profiling::is_enabled() { return true; }
+
+profiling::Snapshot umath::profiling::get_snapshot()
+{
+	auto &registry = get_registry();
+	std::scoped_lock lock {registry.mutex};
+	auto snapshot = registry.retired;
+	for(auto *counters : registry.threads)
+		add_to_snapshot(*counters, snapshot);
+	return snapshot;
+}
+
+profiling::Snapshot umath::profiling::get_thread_snapshot()
+{
+	auto &counters = g_threadCounters;
+	auto &registry = get_registry();
+	std::scoped_lock lock {registry.mutex};
+	Snapshot snapshot {};
+	add_to_snapshot(counters, snapshot);
+	return snapshot;
+}
+
+void umath::profiling::reset()
+{
+	auto &registry = get_registry();
+	std::scoped_lock lock {registry.mutex};
+	registry.retired = {};
+	for(auto *counters : registry.threads) {
+		for(uint32_t f = 0; f < FUNCTION_COUNT; ++f)
+			counters->baseline[f] = counters->Load(f);
+	}
+}
+
+void umath::profiling::record(Function function, std::chrono::nanoseconds duration)
+{
+	auto ns = static_cast<uint64_t>(std::max<std::chrono::nanoseconds::rep>(duration.count(), 0));
+	auto &counters = g_threadCounters;
+	counters.Add(function, 0, 1);
+	counters.Add(function, 1, ns);
+	counters.Add(function, 2 + FunctionStats::GetBucketIndex(ns), 1);
+}
+
+#else
+
+bool umath::profiling::is_enabled() { return false; }
+profiling::Snapshot umath::profiling::get_snapshot() { return {}; }
+profiling::Snapshot umath::profiling::get_thread_snapshot() { return {}; }
+void umath::profiling::reset() {}
+void umath::profiling::record(Function, std::chrono::nanoseconds) {}
+
+#endif
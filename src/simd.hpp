@@ -0,0 +1,231 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UMATH_SIMD_HPP__
+#define __UMATH_SIMD_HPP__
+
+// Internal header, only to be included by the library's translation units.
+// Thin wrappers around the native vector types, so that batch kernels can be written once as templates
+// over the lane type and instantiated for whatever instruction set the library was compiled for.
+// Float4 is always available (SSE, NEON or a plain array fallback), Float8 maps to AVX2 if the library was
+// compiled with MATHUTIL_ENABLE_AVX2, otherwise it is emulated with two Float4. FloatN is the widest native type.
+
+#include <cinttypes>
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX2__)
+#define MATHUTIL_SIMD_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MATHUTIL_SIMD_SSE 1
+#include <emmintrin.h>
+#ifdef MATHUTIL_SIMD_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define MATHUTIL_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace umath::simd {
+#if defined(MATHUTIL_SIMD_SSE)
+	struct Mask4 {
+		__m128 v;
+		uint32_t GetBits() const { return static_cast<uint32_t>(_mm_movemask_ps(v)); }
+		friend Mask4 operator&(Mask4 a, Mask4 b) { return {_mm_and_ps(a.v, b.v)}; }
+		friend Mask4 operator|(Mask4 a, Mask4 b) { return {_mm_or_ps(a.v, b.v)}; }
+		friend Mask4 operator^(Mask4 a, Mask4 b) { return {_mm_xor_ps(a.v, b.v)}; }
+		Mask4 AndNot(Mask4 other) const { return {_mm_andnot_ps(other.v, v)}; } // this & ~other
+	};
+	struct Float4 {
+		using Mask = Mask4;
+		static constexpr uint32_t width = 4;
+		__m128 v;
+		static Float4 Load(const float *p) { return {_mm_loadu_ps(p)}; }
+		static Float4 Set(float f) { return {_mm_set1_ps(f)}; }
+		static Float4 Set(float a, float b, float c, float d) { return {_mm_setr_ps(a, b, c, d)}; }
+		void Store(float *p) const { _mm_storeu_ps(p, v); }
+		friend Float4 operator+(Float4 a, Float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+		friend Float4 operator-(Float4 a, Float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+		friend Float4 operator*(Float4 a, Float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+		friend Float4 operator/(Float4 a, Float4 b) { return {_mm_div_ps(a.v, b.v)}; }
+		friend Float4 operator-(Float4 a) { return {_mm_xor_ps(a.v, _mm_set1_ps(-0.f))}; }
+		friend Mask4 operator<(Float4 a, Float4 b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+		friend Mask4 operator<=(Float4 a, Float4 b) { return {_mm_cmple_ps(a.v, b.v)}; }
+		friend Mask4 operator>(Float4 a, Float4 b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+		friend Mask4 operator>=(Float4 a, Float4 b) { return {_mm_cmpge_ps(a.v, b.v)}; }
+		friend Float4 min(Float4 a, Float4 b) { return {_mm_min_ps(a.v, b.v)}; }
+		friend Float4 max(Float4 a, Float4 b) { return {_mm_max_ps(a.v, b.v)}; }
+		friend Float4 abs(Float4 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.f), a.v)}; }
+		friend Float4 sqrt(Float4 a) { return {_mm_sqrt_ps(a.v)}; }
+		// Returns a where the mask is set, otherwise b
+		friend Float4 select(Mask4 m, Float4 a, Float4 b) { return {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))}; }
+	};
+#elif defined(MATHUTIL_SIMD_NEON)
+	struct Mask4 {
+		uint32x4_t v;
+		uint32_t GetBits() const
+		{
+			static const int32_t shifts[4] = {0, 1, 2, 3};
+			auto bits = vshlq_u32(vshrq_n_u32(v, 31), vld1q_s32(shifts));
+			return vgetq_lane_u32(bits, 0) | vgetq_lane_u32(bits, 1) | vgetq_lane_u32(bits, 2) | vgetq_lane_u32(bits, 3);
+		}
+		friend Mask4 operator&(Mask4 a, Mask4 b) { return {vandq_u32(a.v, b.v)}; }
+		friend Mask4 operator|(Mask4 a, Mask4 b) { return {vorrq_u32(a.v, b.v)}; }
+		friend Mask4 operator^(Mask4 a, Mask4 b) { return {veorq_u32(a.v, b.v)}; }
+		Mask4 AndNot(Mask4 other) const { return {vbicq_u32(v, other.v)}; }
+	};
+	struct Float4 {
+		using Mask = Mask4;
+		static constexpr uint32_t width = 4;
+		float32x4_t v;
+		static Float4 Load(const float *p) { return {vld1q_f32(p)}; }
+		static Float4 Set(float f) { return {vdupq_n_f32(f)}; }
+		static Float4 Set(float a, float b, float c, float d)
+		{
+			const float tmp[4] = {a, b, c, d};
+			return Load(tmp);
+		}
+		void Store(float *p) const { vst1q_f32(p, v); }
+		friend Float4 operator+(Float4 a, Float4 b) { return {vaddq_f32(a.v, b.v)}; }
+		friend Float4 operator-(Float4 a, Float4 b) { return {vsubq_f32(a.v, b.v)}; }
+		friend Float4 operator*(Float4 a, Float4 b) { return {vmulq_f32(a.v, b.v)}; }
+		friend Float4 operator/(Float4 a, Float4 b)
+		{
+			float ta[4], tb[4];
+			a.Store(ta);
+			b.Store(tb);
+			return Set(ta[0] / tb[0], ta[1] / tb[1], ta[2] / tb[2], ta[3] / tb[3]);
+		}
+		friend Float4 operator-(Float4 a) { return {vnegq_f32(a.v)}; }
+		friend Mask4 operator<(Float4 a, Float4 b) { return {vcltq_f32(a.v, b.v)}; }
+		friend Mask4 operator<=(Float4 a, Float4 b) { return {vcleq_f32(a.v, b.v)}; }
+		friend Mask4 operator>(Float4 a, Float4 b) { return {vcgtq_f32(a.v, b.v)}; }
+		friend Mask4 operator>=(Float4 a, Float4 b) { return {vcgeq_f32(a.v, b.v)}; }
+		friend Float4 min(Float4 a, Float4 b) { return {vminq_f32(a.v, b.v)}; }
+		friend Float4 max(Float4 a, Float4 b) { return {vmaxq_f32(a.v, b.v)}; }
+		friend Float4 abs(Float4 a) { return {vabsq_f32(a.v)}; }
+		friend Float4 sqrt(Float4 a)
+		{
+			float t[4];
+			a.Store(t);
+			return Set(std::sqrt(t[0]), std::sqrt(t[1]), std::sqrt(t[2]), std::sqrt(t[3]));
+		}
+		friend Float4 select(Mask4 m, Float4 a, Float4 b) { return {vbslq_f32(m.v, a.v, b.v)}; }
+	};
+#else
+	struct Mask4 {
+		bool v[4];
+		uint32_t GetBits() const { return (v[0] ? 1u : 0u) | (v[1] ? 2u : 0u) | (v[2] ? 4u : 0u) | (v[3] ? 8u : 0u); }
+		friend Mask4 operator&(Mask4 a, Mask4 b) { return {a.v[0] && b.v[0], a.v[1] && b.v[1], a.v[2] && b.v[2], a.v[3] && b.v[3]}; }
+		friend Mask4 operator|(Mask4 a, Mask4 b) { return {a.v[0] || b.v[0], a.v[1] || b.v[1], a.v[2] || b.v[2], a.v[3] || b.v[3]}; }
+		friend Mask4 operator^(Mask4 a, Mask4 b) { return {a.v[0] != b.v[0], a.v[1] != b.v[1], a.v[2] != b.v[2], a.v[3] != b.v[3]}; }
+		Mask4 AndNot(Mask4 other) const { return {v[0] && !other.v[0], v[1] && !other.v[1], v[2] && !other.v[2], v[3] && !other.v[3]}; }
+	};
+	struct Float4 {
+		using Mask = Mask4;
+		static constexpr uint32_t width = 4;
+		float v[4];
+		static Float4 Load(const float *p) { return {p[0], p[1], p[2], p[3]}; }
+		static Float4 Set(float f) { return {f, f, f, f}; }
+		static Float4 Set(float a, float b, float c, float d) { return {a, b, c, d}; }
+		void Store(float *p) const { std::copy(v, v + 4, p); }
+#define UMATH_SIMD_FLOAT4_OP(OP)                                                                                                                                                                                                                                                                 \
+	friend Float4 operator OP(Float4 a, Float4 b) { return {a.v[0] OP b.v[0], a.v[1] OP b.v[1], a.v[2] OP b.v[2], a.v[3] OP b.v[3]}; }
+#define UMATH_SIMD_FLOAT4_CMP(OP)                                                                                                                                                                                                                                                                \
+	friend Mask4 operator OP(Float4 a, Float4 b) { return {a.v[0] OP b.v[0], a.v[1] OP b.v[1], a.v[2] OP b.v[2], a.v[3] OP b.v[3]}; }
+		UMATH_SIMD_FLOAT4_OP(+)
+		UMATH_SIMD_FLOAT4_OP(-)
+		UMATH_SIMD_FLOAT4_OP(*)
+		UMATH_SIMD_FLOAT4_OP(/)
+		UMATH_SIMD_FLOAT4_CMP(<)
+		UMATH_SIMD_FLOAT4_CMP(<=)
+		UMATH_SIMD_FLOAT4_CMP(>)
+		UMATH_SIMD_FLOAT4_CMP(>=)
+#undef UMATH_SIMD_FLOAT4_OP
+#undef UMATH_SIMD_FLOAT4_CMP
+		friend Float4 operator-(Float4 a) { return {-a.v[0], -a.v[1], -a.v[2], -a.v[3]}; }
+		// Same operand order as _mm_min_ps/_mm_max_ps, so NaN lanes behave identically on all backends
+		friend Float4 min(Float4 a, Float4 b) { return {a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1], a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3]}; }
+		friend Float4 max(Float4 a, Float4 b) { return {a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1], a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3]}; }
+		friend Float4 abs(Float4 a) { return {std::abs(a.v[0]), std::abs(a.v[1]), std::abs(a.v[2]), std::abs(a.v[3])}; }
+		friend Float4 sqrt(Float4 a) { return {std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3])}; }
+		friend Float4 select(Mask4 m, Float4 a, Float4 b) { return {m.v[0] ? a.v[0] : b.v[0], m.v[1] ? a.v[1] : b.v[1], m.v[2] ? a.v[2] : b.v[2], m.v[3] ? a.v[3] : b.v[3]}; }
+	};
+#endif
+
+#if defined(MATHUTIL_SIMD_AVX2)
+	struct Mask8 {
+		__m256 v;
+		uint32_t GetBits() const { return static_cast<uint32_t>(_mm256_movemask_ps(v)); }
+		friend Mask8 operator&(Mask8 a, Mask8 b) { return {_mm256_and_ps(a.v, b.v)}; }
+		friend Mask8 operator|(Mask8 a, Mask8 b) { return {_mm256_or_ps(a.v, b.v)}; }
+		friend Mask8 operator^(Mask8 a, Mask8 b) { return {_mm256_xor_ps(a.v, b.v)}; }
+		Mask8 AndNot(Mask8 other) const { return {_mm256_andnot_ps(other.v, v)}; }
+	};
+	struct Float8 {
+		using Mask = Mask8;
+		static constexpr uint32_t width = 8;
+		__m256 v;
+		static Float8 Load(const float *p) { return {_mm256_loadu_ps(p)}; }
+		static Float8 Set(float f) { return {_mm256_set1_ps(f)}; }
+		void Store(float *p) const { _mm256_storeu_ps(p, v); }
+		friend Float8 operator+(Float8 a, Float8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+		friend Float8 operator-(Float8 a, Float8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+		friend Float8 operator*(Float8 a, Float8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+		friend Float8 operator/(Float8 a, Float8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+		friend Float8 operator-(Float8 a) { return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.f))}; }
+		friend Mask8 operator<(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+		friend Mask8 operator<=(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+		friend Mask8 operator>(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+		friend Mask8 operator>=(Float8 a, Float8 b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)}; }
+		friend Float8 min(Float8 a, Float8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+		friend Float8 max(Float8 a, Float8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+		friend Float8 abs(Float8 a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v)}; }
+		friend Float8 sqrt(Float8 a) { return {_mm256_sqrt_ps(a.v)}; }
+		friend Float8 select(Mask8 m, Float8 a, Float8 b) { return {_mm256_blendv_ps(b.v, a.v, m.v)}; }
+	};
+	using FloatN = Float8;
+#else
+	struct Mask8 {
+		Mask4 lo, hi;
+		uint32_t GetBits() const { return lo.GetBits() | (hi.GetBits() << 4); }
+		friend Mask8 operator&(Mask8 a, Mask8 b) { return {a.lo & b.lo, a.hi & b.hi}; }
+		friend Mask8 operator|(Mask8 a, Mask8 b) { return {a.lo | b.lo, a.hi | b.hi}; }
+		friend Mask8 operator^(Mask8 a, Mask8 b) { return {a.lo ^ b.lo, a.hi ^ b.hi}; }
+		Mask8 AndNot(Mask8 other) const { return {lo.AndNot(other.lo), hi.AndNot(other.hi)}; }
+	};
+	struct Float8 {
+		using Mask = Mask8;
+		static constexpr uint32_t width = 8;
+		Float4 lo, hi;
+		static Float8 Load(const float *p) { return {Float4::Load(p), Float4::Load(p + 4)}; }
+		static Float8 Set(float f) { return {Float4::Set(f), Float4::Set(f)}; }
+		void Store(float *p) const
+		{
+			lo.Store(p);
+			hi.Store(p + 4);
+		}
+		friend Float8 operator+(Float8 a, Float8 b) { return {a.lo + b.lo, a.hi + b.hi}; }
+		friend Float8 operator-(Float8 a, Float8 b) { return {a.lo - b.lo, a.hi - b.hi}; }
+		friend Float8 operator*(Float8 a, Float8 b) { return {a.lo * b.lo, a.hi * b.hi}; }
+		friend Float8 operator/(Float8 a, Float8 b) { return {a.lo / b.lo, a.hi / b.hi}; }
+		friend Float8 operator-(Float8 a) { return {-a.lo, -a.hi}; }
+		friend Mask8 operator<(Float8 a, Float8 b) { return {a.lo < b.lo, a.hi < b.hi}; }
+		friend Mask8 operator<=(Float8 a, Float8 b) { return {a.lo <= b.lo, a.hi <= b.hi}; }
+		friend Mask8 operator>(Float8 a, Float8 b) { return {a.lo > b.lo, a.hi > b.hi}; }
+		friend Mask8 operator>=(Float8 a, Float8 b) { return {a.lo >= b.lo, a.hi >= b.hi}; }
+		friend Float8 min(Float8 a, Float8 b) { return {min(a.lo, b.lo), min(a.hi, b.hi)}; }
+		friend Float8 max(Float8 a, Float8 b) { return {max(a.lo, b.lo), max(a.hi, b.hi)}; }
+		friend Float8 abs(Float8 a) { return {abs(a.lo), abs(a.hi)}; }
+		friend Float8 sqrt(Float8 a) { return {sqrt(a.lo), sqrt(a.hi)}; }
+		friend Float8 select(Mask8 m, Float8 a, Float8 b) { return {select(m.lo, a.lo, b.lo), select(m.hi, a.hi, b.hi)}; }
+	};
+	using FloatN = Float4;
+#endif
+};
+
+#endif
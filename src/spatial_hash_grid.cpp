@@ -0,0 +1,211 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/spatial_hash_grid.hpp"
+#include "mathutil/umath_geometry.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace bounding_volume;
+
+static constexpr size_t MIN_TABLE_SIZE = 64;
+
+static uint32_t hash_cell(const Vector3i &coord)
+{
+	auto h = (static_cast<uint32_t>(coord.x) * 73'856'093u) ^ (static_cast<uint32_t>(coord.y) * 19'349'663u) ^ (static_cast<uint32_t>(coord.z) * 83'492'791u);
+	// Mix the upper bits into the lower ones, which are used as table index
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	return h;
+}
+
+SpatialHashGrid::SpatialHashGrid(float cellSize) { SetCellSize(cellSize); }
+
+void SpatialHashGrid::SetCellSize(float cellSize)
+{
+	assert(cellSize > 0.f);
+	m_cellSize = cellSize;
+	m_invCellSize = 1.f / cellSize;
+	Clear();
+}
+
+void SpatialHashGrid::Reserve(size_t itemCount)
+{
+	m_points.reserve(itemCount);
+	m_radii.reserve(itemCount);
+	m_payloads.reserve(itemCount);
+	m_nextItems.reserve(itemCount);
+	// Keep the load factor below 0.5 even if every item occupies its own cell
+	size_t capacity = MIN_TABLE_SIZE;
+	while(capacity < itemCount * 2)
+		capacity *= 2;
+	if(capacity > m_table.size())
+		Rehash(capacity);
+}
+
+void SpatialHashGrid::Clear()
+{
+	if(m_cellCount > 0) {
+		for(auto &cell : m_table)
+			cell.firstItem = INVALID_ITEM;
+	}
+	m_cellCount = 0;
+	m_maxRadius = 0.f;
+	m_points.clear();
+	m_radii.clear();
+	m_payloads.clear();
+	m_nextItems.clear();
+}
+
+Vector3i SpatialHashGrid::GetCellCoordinates(const Vector3 &p) const
+{
+	// Clamped to avoid overflows for points far away from the origin, these all end up in the boundary cells
+	constexpr float limit = static_cast<float>(1 << 30);
+	Vector3i coord;
+	for(uint8_t i = 0; i < 3; ++i)
+		coord[i] = static_cast<int32_t>(umath::clamp(std::floor(p[i] * m_invCellSize), -limit, limit));
+	return coord;
+}
+
+const SpatialHashGrid::Cell *SpatialHashGrid::FindCell(const Vector3i &coord) const
+{
+	if(m_table.empty())
+		return nullptr;
+	auto mask = m_table.size() - 1;
+	for(auto idx = hash_cell(coord) & mask;; idx = (idx + 1) & mask) {
+		auto &cell = m_table[idx];
+		if(cell.firstItem == INVALID_ITEM)
+			return nullptr;
+		if(cell.coord == coord)
+			return &cell;
+	}
+}
+
+void SpatialHashGrid::Rehash(size_t capacity)
+{
+	auto oldTable = std::move(m_table);
+	m_table.assign(capacity, Cell {{}, INVALID_ITEM});
+	auto mask = capacity - 1;
+	for(auto &cell : oldTable) {
+		if(cell.firstItem == INVALID_ITEM)
+			continue;
+		auto idx = hash_cell(cell.coord) & mask;
+		while(m_table[idx].firstItem != INVALID_ITEM)
+			idx = (idx + 1) & mask;
+		m_table[idx] = cell;
+	}
+}
+
+void SpatialHashGrid::InsertIntoCell(uint32_t itemIdx)
+{
+	if((m_cellCount + 1) * 2 > m_table.size())
+		Rehash(umath::max(m_table.size() * 2, MIN_TABLE_SIZE));
+	auto coord = GetCellCoordinates(m_points[itemIdx]);
+	auto mask = m_table.size() - 1;
+	auto idx = hash_cell(coord) & mask;
+	for(;; idx = (idx + 1) & mask) {
+		auto &cell = m_table[idx];
+		if(cell.firstItem == INVALID_ITEM) {
+			cell.coord = coord;
+			++m_cellCount;
+			break;
+		}
+		if(cell.coord == coord)
+			break;
+	}
+	// Items are prepended to the list of the cell
+	auto &cell = m_table[idx];
+	m_nextItems[itemIdx] = cell.firstItem;
+	cell.firstItem = itemIdx;
+}
+
+void SpatialHashGrid::Insert(const Vector3 &point, float radius, uint32_t payload)
+{
+	auto itemIdx = static_cast<uint32_t>(m_points.size());
+	m_points.push_back(point);
+	m_radii.push_back(radius);
+	m_payloads.push_back(payload);
+	m_nextItems.push_back(INVALID_ITEM);
+	m_maxRadius = umath::max(m_maxRadius, radius);
+	InsertIntoCell(itemIdx);
+}
+
+void SpatialHashGrid::Insert(std::span<const Vector3> points, std::span<const float> radii, std::span<const uint32_t> payloads)
+{
+	assert(radii.empty() || radii.size() == points.size());
+	assert(payloads.empty() || payloads.size() == points.size());
+	auto offset = static_cast<uint32_t>(m_points.size());
+	auto count = offset + points.size();
+	m_points.insert(m_points.end(), points.begin(), points.end());
+	if(radii.empty())
+		m_radii.resize(count, 0.f);
+	else {
+		m_radii.insert(m_radii.end(), radii.begin(), radii.end());
+		m_maxRadius = umath::max(m_maxRadius, *std::max_element(radii.begin(), radii.end()));
+	}
+	if(payloads.empty()) {
+		m_payloads.resize(count);
+		for(auto i = offset; i < count; ++i)
+			m_payloads[i] = i;
+	}
+	else
+		m_payloads.insert(m_payloads.end(), payloads.begin(), payloads.end());
+	m_nextItems.resize(count);
+	for(auto i = offset; i < count; ++i)
+		InsertIntoCell(i);
+}
+
+template<class TTest>
+void SpatialHashGrid::FindOverlaps(const Vector3 &min, const Vector3 &max, const TTest &fTest, std::vector<uint32_t> &outPayloads) const
+{
+	if(m_cellCount == 0)
+		return;
+	// Items are only assigned to the cell of their center, so the range has to be extended by the largest radius
+	auto start = GetCellCoordinates(min - Vector3 {m_maxRadius});
+	auto end = GetCellCoordinates(max + Vector3 {m_maxRadius});
+	auto visitCell = [this, &fTest, &outPayloads](const Cell &cell) {
+		for(auto itemIdx = cell.firstItem; itemIdx != INVALID_ITEM; itemIdx = m_nextItems[itemIdx]) {
+			if(fTest(m_points[itemIdx], m_radii[itemIdx]))
+				outPayloads.push_back(m_payloads[itemIdx]);
+		}
+	};
+	uint64_t rangeCellCount = 1;
+	for(uint8_t i = 0; i < 3; ++i)
+		rangeCellCount *= static_cast<uint64_t>(static_cast<int64_t>(end[i]) - start[i] + 1);
+	if(rangeCellCount > m_cellCount) {
+		// Cheaper to iterate over the occupied cells than over the range
+		for(auto &cell : m_table) {
+			if(cell.firstItem == INVALID_ITEM)
+				continue;
+			auto &c = cell.coord;
+			if(c.x >= start.x && c.y >= start.y && c.z >= start.z && c.x <= end.x && c.y <= end.y && c.z <= end.z)
+				visitCell(cell);
+		}
+		return;
+	}
+	Vector3i coord;
+	for(coord.z = start.z; coord.z <= end.z; ++coord.z) {
+		for(coord.y = start.y; coord.y <= end.y; ++coord.y) {
+			for(coord.x = start.x; coord.x <= end.x; ++coord.x) {
+				auto *cell = FindCell(coord);
+				if(cell)
+					visitCell(*cell);
+			}
+		}
+	}
+}
+
+void SpatialHashGrid::FindSphereOverlaps(const Vector3 &origin, float radius, std::vector<uint32_t> &outPayloads) const
+{
+	FindOverlaps(
+	  origin - Vector3 {radius}, origin + Vector3 {radius}, [&origin, radius](const Vector3 &p, float r) { return umath::intersection::sphere_sphere(origin, radius, p, r); }, outPayloads);
+}
+
+void SpatialHashGrid::FindAABBOverlaps(const Vector3 &min, const Vector3 &max, std::vector<uint32_t> &outPayloads) const
+{
+	FindOverlaps(
+	  min, max, [&min, &max](const Vector3 &p, float r) { return umath::intersection::aabb_sphere(min, max, p, r); }, outPayloads);
+}
@@ -0,0 +1,128 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "task_pool.hpp"
+#include "mathutil/umath.h"
+
+namespace {
+	struct LocalQueue {
+		const umath::TaskPool *pool = nullptr;
+		uint32_t queueIdx = 0;
+	};
+	thread_local LocalQueue g_localQueue {};
+};
+
+umath::TaskPool::TaskPool(uint32_t workerCount)
+{
+	if(workerCount == 0)
+		workerCount = umath::max(std::thread::hardware_concurrency(), 1u);
+	m_queues.reserve(workerCount + 1);
+	for(uint32_t i = 0; i < workerCount + 1; ++i)
+		m_queues.push_back(std::make_unique<Queue>());
+	m_workers.reserve(workerCount);
+	for(uint32_t i = 0; i < workerCount; ++i)
+		m_workers.push_back(std::thread {[this, i]() { WorkerMain(i); }});
+}
+
+umath::TaskPool::~TaskPool()
+{
+	{
+		std::scoped_lock lock {m_wakeMutex};
+		m_stop = true;
+	}
+	m_wakeCondition.notify_all();
+	for(auto &worker : m_workers)
+		worker.join();
+}
+
+uint32_t umath::TaskPool::GetLocalQueueIndex() const { return (g_localQueue.pool == this) ? g_localQueue.queueIdx : static_cast<uint32_t>(m_queues.size() - 1); }
+
+void umath::TaskPool::WorkerMain(uint32_t queueIdx)
+{
+	g_localQueue = {this, queueIdx};
+	for(;;) {
+		if(TryExecuteTask(queueIdx))
+			continue;
+		std::unique_lock lock {m_wakeMutex};
+		m_wakeCondition.wait(lock, [this]() { return m_stop || m_queuedTaskCount.load() > 0; });
+		if(m_stop)
+			return;
+	}
+}
+
+bool umath::TaskPool::TryExecuteTask(uint32_t queueIdx)
+{
+	if(m_queuedTaskCount.load() == 0)
+		return false;
+	Task task {};
+	auto found = false;
+	{
+		// Own tasks are taken from the back for locality
+		auto &queue = *m_queues[queueIdx];
+		std::scoped_lock lock {queue.mutex};
+		if(!queue.tasks.empty()) {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			found = true;
+		}
+	}
+	// Steal the oldest task, which is usually the largest one, from another queue
+	for(uint32_t i = 1; i < m_queues.size() && !found; ++i) {
+		auto &queue = *m_queues[(queueIdx + i) % m_queues.size()];
+		std::scoped_lock lock {queue.mutex};
+		if(!queue.tasks.empty()) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			found = true;
+		}
+	}
+	if(!found)
+		return false;
+	--m_queuedTaskCount;
+	task.function();
+	task.group->m_pending.fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+void umath::TaskPool::Run(Group &group, std::function<void()> task)
+{
+	group.m_pending.fetch_add(1, std::memory_order_relaxed);
+	{
+		auto &queue = *m_queues[GetLocalQueueIndex()];
+		std::scoped_lock lock {queue.mutex};
+		queue.tasks.push_back({std::move(task), &group});
+	}
+	++m_queuedTaskCount;
+	// Locking the mutex ensures that a worker can't miss the notification between checking the count and going to sleep
+	{
+		std::scoped_lock lock {m_wakeMutex};
+	}
+	m_wakeCondition.notify_one();
+}
+
+void umath::TaskPool::Wait(Group &group)
+{
+	auto queueIdx = GetLocalQueueIndex();
+	while(group.m_pending.load(std::memory_order_acquire) > 0) {
+		if(!TryExecuteTask(queueIdx))
+			std::this_thread::yield();
+	}
+}
+
+void umath::TaskPool::ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t, uint32_t)> &fTask)
+{
+	if(count == 0)
+		return;
+	grainSize = umath::max(grainSize, 1u);
+	auto maxChunks = (GetWorkerCount() + 1) * 4;
+	auto numChunks = umath::min((count + grainSize - 1) / grainSize, maxChunks);
+	auto chunkSize = (count + numChunks - 1) / numChunks;
+	Group group {};
+	for(auto begin = chunkSize; begin < count; begin += chunkSize) {
+		auto end = umath::min(begin + chunkSize, count);
+		Run(group, [&fTask, begin, end]() { fTask(begin, end); });
+	}
+	fTask(0, umath::min(chunkSize, count));
+	Wait(group);
+}
@@ -0,0 +1,72 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UMATH_TASK_POOL_HPP__
+#define __UMATH_TASK_POOL_HPP__
+
+// Internal header, only to be included by the library's translation units.
+
+#include <atomic>
+#include <condition_variable>
+#include <cinttypes>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace umath {
+	// Fork-join thread pool with work stealing. Every worker owns a task queue; tasks spawned by a worker
+	// are pushed to its own queue and executed in LIFO order, idle workers steal the oldest tasks from other queues.
+	// Threads waiting for a group execute pending tasks in the meantime, so tasks may spawn and wait for subtasks.
+	class TaskPool {
+	  public:
+		class Group {
+		  public:
+			Group() = default;
+			Group(const Group &) = delete;
+			Group &operator=(const Group &) = delete;
+		  private:
+			friend TaskPool;
+			std::atomic<uint32_t> m_pending = 0;
+		};
+
+		// If workerCount is 0, one worker per hardware thread is created
+		TaskPool(uint32_t workerCount = 0);
+		~TaskPool();
+		TaskPool(const TaskPool &) = delete;
+		TaskPool &operator=(const TaskPool &) = delete;
+		uint32_t GetWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+		void Run(Group &group, std::function<void()> task);
+		// Blocks until all tasks of the group have completed
+		void Wait(Group &group);
+
+		// Splits [0, count) into consecutive ranges of at least grainSize elements, calls fTask(begin, end) for each of them
+		// and waits for completion. The calling thread processes the first range.
+		void ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t, uint32_t)> &fTask);
+	  private:
+		struct Task {
+			std::function<void()> function;
+			Group *group;
+		};
+		struct Queue {
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+		void WorkerMain(uint32_t queueIdx);
+		uint32_t GetLocalQueueIndex() const;
+		bool TryExecuteTask(uint32_t queueIdx);
+
+		std::vector<std::unique_ptr<Queue>> m_queues; // One per worker, the last one is shared by external threads
+		std::vector<std::thread> m_workers;
+		std::atomic<uint32_t> m_queuedTaskCount = 0;
+		std::mutex m_wakeMutex;
+		std::condition_variable m_wakeCondition;
+		bool m_stop = false;
+	};
+};
+
+#endif
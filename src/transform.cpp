@@ -146,6 +146,7 @@ umath::Transform &umath::Transform::operator*=(float weight)
 umath::ScaledTransform::ScaledTransform(const Transform &t, const Vector3 &scale) : Transform {t}, scale {scale} {}
 umath::ScaledTransform::ScaledTransform(const Transform &t) : Transform {t} {}
 umath::ScaledTransform::ScaledTransform(const Vector3 &pos, const Quat &rot, const Vector3 &scale) : Transform {pos, rot}, scale {scale} {}
+umath::ScaledTransform::ScaledTransform(const UniformScaledTransform &t) : Transform {t}, scale {t.scale, t.scale, t.scale} {}
 void umath::ScaledTransform::SetIdentity()
 {
 	Transform::SetIdentity();
@@ -217,6 +218,52 @@ umath::ScaledTransform &umath::ScaledTransform::operator*=(float weight)
 
 /////////////
 
+umath::UniformScaledTransform::UniformScaledTransform(const Transform &t, float scale) : Transform {t}, scale {scale} {}
+umath::UniformScaledTransform::UniformScaledTransform(const Transform &t) : Transform {t} {}
+umath::UniformScaledTransform::UniformScaledTransform(const Vector3 &pos, const Quat &rot, float scale) : Transform {pos, rot}, scale {scale} {}
+umath::UniformScaledTransform::UniformScaledTransform(const ScaledTransform &t) : Transform {t}, scale {t.scale.x} {}
+void umath::UniformScaledTransform::SetIdentity()
+{
+	Transform::SetIdentity();
+	scale = 1.f;
+}
+void umath::UniformScaledTransform::Interpolate(const UniformScaledTransform &dst, float factor)
+{
+	Transform::Interpolate(dst, factor);
+	scale += (dst.scale - scale) * factor;
+}
+umath::UniformScaledTransform umath::UniformScaledTransform::GetInverse() const
+{
+	// Same as ScaledTransform::GetInverse, but the conjugate of a normalized rotation is its inverse
+	Quat invRot {rotation.w, -rotation.x, -rotation.y, -rotation.z};
+	return UniformScaledTransform {invRot * -translation, invRot, 1.f / scale};
+}
+umath::UniformScaledTransform umath::UniformScaledTransform::operator*(const UniformScaledTransform &tOther) const
+{
+	return UniformScaledTransform {translation + rotation * tOther.translation, rotation * tOther.rotation, scale * tOther.scale};
+}
+umath::UniformScaledTransform &umath::UniformScaledTransform::operator*=(const UniformScaledTransform &tOther)
+{
+	translation += rotation * tOther.translation;
+	rotation = rotation * tOther.rotation;
+	scale *= tOther.scale;
+	return *this;
+}
+Vector3 umath::UniformScaledTransform::operator*(const Vector3 &translation) const { return rotation * (translation * scale) + this->translation; }
+Quat umath::UniformScaledTransform::operator*(const Quat &rot) const { return rotation * rot; }
+
+Mat4 umath::UniformScaledTransform::ToMatrix() const
+{
+	auto m = umat::create(rotation);
+	m[0] *= scale;
+	m[1] *= scale;
+	m[2] *= scale;
+	m[3] = Vector4 {translation, 1.f};
+	return m;
+}
+
+/////////////
+
 Vector3 operator*(const Vector3 &v, const umath::Transform &t) { return (umath::Transform {v, uquat::identity()} * t).GetOrigin(); }
 Vector3 &operator*=(Vector3 &v, const umath::Transform &t)
 {
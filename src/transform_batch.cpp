@@ -0,0 +1,115 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/transform.hpp"
+#include "transform_kernels.hpp"
+#include "profile_scope.hpp"
+#include <cassert>
+
+using namespace umath::kernels;
+
+static TransformLanes<float> to_lanes(const umath::ScaledTransform &t)
+{
+	auto &p = t.GetOrigin();
+	auto &r = t.GetRotation();
+	auto &s = t.GetScale();
+	return {p.x, p.y, p.z, r.w, r.x, r.y, r.z, s.x, s.y, s.z};
+}
+
+static void from_lanes(const TransformLanes<float> &t, umath::ScaledTransform &out)
+{
+	out.SetOrigin({t.px, t.py, t.pz});
+	out.SetRotation(Quat {t.rw, t.rx, t.ry, t.rz});
+	out.SetScale({t.sx, t.sy, t.sz});
+}
+
+static void compute_world_transforms_scalar(std::span<const int32_t> parentIndices, std::span<const umath::ScaledTransform> localTransforms, std::span<umath::ScaledTransform> outWorldTransforms, std::span<Mat4> outMatrices,
+  std::span<const umath::ScaledTransform> inverseBindPoses)
+{
+	auto boneCount = parentIndices.size();
+	for(size_t i = 0; i < localTransforms.size(); ++i) {
+		auto bone = i % boneCount;
+		auto parent = parentIndices[bone];
+		auto world = to_lanes(localTransforms[i]);
+		if(parent >= 0)
+			world = compose(to_lanes(outWorldTransforms[i - bone + parent]), world);
+		from_lanes(world, outWorldTransforms[i]);
+		if(outMatrices.empty())
+			continue;
+		if(!inverseBindPoses.empty())
+			world = compose(world, to_lanes(inverseBindPoses[bone]));
+		float m[16];
+		to_matrix(world, m);
+		auto &out = outMatrices[i];
+		for(uint8_t c = 0; c < 4; ++c) {
+			for(uint8_t r = 0; r < 4; ++r)
+				out[c][r] = m[c * 4 + r];
+		}
+	}
+}
+
+void umath::compute_world_transforms(std::span<const int32_t> parentIndices, std::span<const ScaledTransform> localTransforms, std::span<ScaledTransform> outWorldTransforms, std::span<Mat4> outMatrices,
+  std::span<const ScaledTransform> inverseBindPoses)
+{
+	MATHUTIL_PROFILE_SCOPE(ComputeWorldTransforms);
+	using TFloat = umath::simd::FloatN;
+	constexpr auto width = TFloat::width;
+	auto boneCount = parentIndices.size();
+	if(boneCount == 0)
+		return;
+	assert(localTransforms.size() % boneCount == 0);
+	assert(outWorldTransforms.size() == localTransforms.size());
+	assert(outMatrices.empty() || outMatrices.size() == localTransforms.size());
+	assert(inverseBindPoses.empty() || inverseBindPoses.size() == boneCount);
+	auto instanceCount = localTransforms.size() / boneCount;
+	if(instanceCount < width) {
+		compute_world_transforms_scalar(parentIndices, localTransforms, outWorldTransforms, outMatrices, inverseBindPoses);
+		return;
+	}
+	// Every lane processes the same bone of a different instance, so the lanes never depend on each other.
+	// Unused lanes of the last block repeat the last instance and are discarded.
+	TransformLanes<float> locals[width];
+	TransformLanes<float> parents[width];
+	TransformLanes<float> worlds[width];
+	for(size_t firstInstance = 0; firstInstance < instanceCount; firstInstance += width) {
+		auto numLanes = umath::min<size_t>(width, instanceCount - firstInstance);
+		for(size_t bone = 0; bone < boneCount; ++bone) {
+			auto parent = parentIndices[bone];
+			assert(parent < static_cast<int32_t>(bone));
+			for(uint32_t lane = 0; lane < width; ++lane) {
+				auto offset = (firstInstance + umath::min<size_t>(lane, numLanes - 1)) * boneCount;
+				locals[lane] = to_lanes(localTransforms[offset + bone]);
+				if(parent >= 0)
+					parents[lane] = to_lanes(outWorldTransforms[offset + parent]);
+			}
+			auto world = load_lanes<TFloat>(locals);
+			if(parent >= 0)
+				world = compose(load_lanes<TFloat>(parents), world);
+			store_lanes(world, worlds);
+			for(uint32_t lane = 0; lane < numLanes; ++lane)
+				from_lanes(worlds[lane], outWorldTransforms[(firstInstance + lane) * boneCount + bone]);
+			if(outMatrices.empty())
+				continue;
+			if(!inverseBindPoses.empty()) {
+				auto &ib = inverseBindPoses[bone];
+				auto &p = ib.GetOrigin();
+				auto &r = ib.GetRotation();
+				auto &s = ib.GetScale();
+				world = compose(world, TransformLanes<TFloat> {TFloat::Set(p.x), TFloat::Set(p.y), TFloat::Set(p.z), TFloat::Set(r.w), TFloat::Set(r.x), TFloat::Set(r.y), TFloat::Set(r.z), TFloat::Set(s.x), TFloat::Set(s.y), TFloat::Set(s.z)});
+			}
+			TFloat m[16];
+			to_matrix(world, m);
+			float tmp[16][width];
+			for(uint8_t i = 0; i < 16; ++i)
+				m[i].Store(tmp[i]);
+			for(uint32_t lane = 0; lane < numLanes; ++lane) {
+				auto &out = outMatrices[(firstInstance + lane) * boneCount + bone];
+				for(uint8_t c = 0; c < 4; ++c) {
+					for(uint8_t r = 0; r < 4; ++r)
+						out[c][r] = tmp[c * 4 + r][lane];
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,192 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/transform_compression.hpp"
+#include "mathutil/umath_float16_compressor.h"
+#include "simd.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+using namespace umath;
+
+static constexpr uint32_t ROTATION_BITS = 15;
+static constexpr uint32_t ROTATION_MAX_CODE = (1 << ROTATION_BITS) - 1;
+static constexpr float ROTATION_RANGE = 0.70710678118654752440f; // 1 / sqrt(2)
+static constexpr uint32_t MAX_CODE = std::numeric_limits<uint16_t>::max();
+
+std::array<uint16_t, 3> umath::compress_rotation(const Quat &rot)
+{
+	auto q = uquat::get_normal(rot);
+	const float c[4] = {q.w, q.x, q.y, q.z};
+	uint32_t largest = 0;
+	for(uint32_t i = 1; i < 4; ++i) {
+		if(std::abs(c[i]) > std::abs(c[largest]))
+			largest = i;
+	}
+	// q and -q are the same rotation, the dropped component is always restored as positive
+	auto sign = (c[largest] < 0.f) ? -1.f : 1.f;
+	uint64_t bits = static_cast<uint64_t>(largest) << (ROTATION_BITS * 3);
+	uint32_t shift = 0;
+	for(uint32_t i = 0; i < 4; ++i) {
+		if(i == largest)
+			continue;
+		auto v = std::clamp(c[i] * sign / ROTATION_RANGE * 0.5f + 0.5f, 0.f, 1.f);
+		bits |= static_cast<uint64_t>(std::lround(v * ROTATION_MAX_CODE)) << shift;
+		shift += ROTATION_BITS;
+	}
+	return {static_cast<uint16_t>(bits), static_cast<uint16_t>(bits >> 16), static_cast<uint16_t>(bits >> 32)};
+}
+
+Quat umath::decompress_rotation(const std::array<uint16_t, 3> &rot)
+{
+	auto bits = static_cast<uint64_t>(rot[0]) | (static_cast<uint64_t>(rot[1]) << 16) | (static_cast<uint64_t>(rot[2]) << 32);
+	auto largest = static_cast<uint32_t>(bits >> (ROTATION_BITS * 3));
+	float c[4];
+	auto sumSqr = 0.f;
+	uint32_t shift = 0;
+	for(uint32_t i = 0; i < 4; ++i) {
+		if(i == largest)
+			continue;
+		c[i] = static_cast<float>((bits >> shift) & ROTATION_MAX_CODE) * (2.f * ROTATION_RANGE / static_cast<float>(ROTATION_MAX_CODE)) - ROTATION_RANGE;
+		sumSqr += c[i] * c[i];
+		shift += ROTATION_BITS;
+	}
+	c[largest] = std::sqrt(umath::max(1.f - sumSqr, 0.f));
+	return Quat {c[0], c[1], c[2], c[3]};
+}
+
+/////////////
+
+umath::CompressedTransformStream::CompressedTransformStream() { InitializeTranslationCompressor(1.f, 1.f / 1024.f, DEFAULT_TRANSLATION_PRECISION); }
+umath::CompressedTransformStream::CompressedTransformStream(std::span<const ScaledTransform> transforms, int translationPrecision) { Encode(transforms, translationPrecision); }
+umath::CompressedTransformStream::CompressedTransformStream(std::vector<CompressedTransform> keys, float translationRange, float translationEpsilon, int translationPrecision) : m_keys {std::move(keys)}
+{
+	InitializeTranslationCompressor(translationRange, translationEpsilon, translationPrecision);
+}
+
+void umath::CompressedTransformStream::InitializeTranslationCompressor(float range, float epsilon, int precision)
+{
+	m_translationRange = range;
+	m_translationEpsilon = epsilon;
+	m_translationPrecision = precision;
+	m_translationCompressor = FloatCompressor {-range, epsilon, range, precision};
+}
+
+void umath::CompressedTransformStream::Encode(std::span<const ScaledTransform> transforms, int translationPrecision)
+{
+	auto range = 0.f;
+	for(auto &t : transforms) {
+		for(uint8_t i = 0; i < 3; ++i)
+			range = umath::max(range, std::abs(t.GetOrigin()[i]));
+	}
+	if(range == 0.f)
+		range = 1.f;
+
+	// The number of codes grows with the precision and the number of exponents between the epsilon and the range,
+	// so the precision is only reduced if not even the largest epsilon would fit into 16 bits
+	auto fits = [range](float epsilon, int precision) {
+		FloatCompressor compressor {-range, epsilon, range, precision};
+		return compressor.compress(range) <= MAX_CODE && compressor.compress(-range) <= MAX_CODE;
+	};
+	auto precision = std::clamp(translationPrecision, 1, 23);
+	auto epsilon = range * 0.5f;
+	for(;;) {
+		auto found = false;
+		for(auto exp = 48; exp > 0; --exp) {
+			auto eps = std::ldexp(range, -exp);
+			if(eps < std::numeric_limits<float>::min() || !fits(eps, precision))
+				continue;
+			epsilon = eps;
+			found = true;
+			break;
+		}
+		if(found || precision == 1)
+			break;
+		--precision;
+	}
+	InitializeTranslationCompressor(range, epsilon, precision);
+
+	// FloatCompressor truncates the mantissa, scaling by half a step first rounds to the nearest code instead
+	auto roundingScale = 1.f + std::ldexp(1.f, -(precision + 1));
+	m_keys.resize(transforms.size());
+	for(size_t i = 0; i < transforms.size(); ++i) {
+		auto &t = transforms[i];
+		auto &key = m_keys[i];
+		key.rotation = compress_rotation(t.GetRotation());
+		for(uint8_t j = 0; j < 3; ++j) {
+			key.translation[j] = static_cast<uint16_t>(m_translationCompressor.compress(t.GetOrigin()[j] * roundingScale));
+			key.scale[j] = Float16Compressor::compress(t.GetScale()[j]);
+		}
+	}
+}
+
+std::vector<ScaledTransform> umath::CompressedTransformStream::Decode() const
+{
+	std::vector<ScaledTransform> transforms(m_keys.size());
+	Decode(transforms);
+	return transforms;
+}
+
+ScaledTransform umath::CompressedTransformStream::Get(size_t index) const
+{
+	ScaledTransform t;
+	Decode(index, {&t, 1});
+	return t;
+}
+
+void umath::CompressedTransformStream::Decode(size_t offset, std::span<ScaledTransform> outTransforms) const
+{
+	using TFloat = simd::FloatN;
+	constexpr auto width = TFloat::width;
+	assert(offset + outTransforms.size() <= m_keys.size());
+	auto *keys = m_keys.data() + offset;
+	auto numKeys = outTransforms.size();
+	auto scale = TFloat::Set(2.f * ROTATION_RANGE / static_cast<float>(ROTATION_MAX_CODE));
+	auto bias = TFloat::Set(-ROTATION_RANGE);
+	auto zero = TFloat::Set(0.f);
+	auto one = TFloat::Set(1.f);
+	for(size_t i = 0; i < numKeys; i += width) {
+		auto count = static_cast<uint32_t>(umath::min<size_t>(width, numKeys - i));
+		// The bit fields are unpacked per key, the rotations are then reconstructed for all lanes at once
+		float codes[3][width];
+		float largest[width];
+		for(uint32_t lane = 0; lane < width; ++lane) {
+			auto &key = keys[i + umath::min(lane, count - 1)];
+			auto bits = static_cast<uint64_t>(key.rotation[0]) | (static_cast<uint64_t>(key.rotation[1]) << 16) | (static_cast<uint64_t>(key.rotation[2]) << 32);
+			for(uint32_t j = 0; j < 3; ++j)
+				codes[j][lane] = static_cast<float>((bits >> (j * ROTATION_BITS)) & ROTATION_MAX_CODE);
+			largest[lane] = static_cast<float>(bits >> (ROTATION_BITS * 3));
+			if(lane >= count)
+				continue;
+			auto &t = outTransforms[i + lane];
+			for(uint8_t j = 0; j < 3; ++j) {
+				t.translation[j] = m_translationCompressor.decompress(key.translation[j]);
+				t.scale[j] = Float16Compressor::decompress(key.scale[j]);
+			}
+		}
+		auto a = TFloat::Load(codes[0]) * scale + bias;
+		auto b = TFloat::Load(codes[1]) * scale + bias;
+		auto c = TFloat::Load(codes[2]) * scale + bias;
+		auto d = sqrt(max(one - (a * a + b * b + c * c), zero));
+		// The stored components fill the slots other than the largest one, in w, x, y, z order
+		auto idx = TFloat::Load(largest);
+		auto is0 = idx < TFloat::Set(0.5f);
+		auto is1 = (idx > TFloat::Set(0.5f)) & (idx < TFloat::Set(1.5f));
+		auto is2 = (idx > TFloat::Set(1.5f)) & (idx < TFloat::Set(2.5f));
+		auto is3 = idx > TFloat::Set(2.5f);
+		auto w = select(is0, d, a);
+		auto x = select(is0, a, select(is1, d, b));
+		auto y = select(is0 | is1, b, select(is2, d, c));
+		auto z = select(is3, d, c);
+		float rot[4][width];
+		w.Store(rot[0]);
+		x.Store(rot[1]);
+		y.Store(rot[2]);
+		z.Store(rot[3]);
+		for(uint32_t lane = 0; lane < count; ++lane)
+			outTransforms[i + lane].rotation = Quat {rot[0][lane], rot[1][lane], rot[2][lane], rot[3][lane]};
+	}
+}
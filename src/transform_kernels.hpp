@@ -0,0 +1,247 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef __UMATH_TRANSFORM_KERNELS_HPP__
+#define __UMATH_TRANSFORM_KERNELS_HPP__
+
+// Internal header, only to be included by the library's translation units.
+// Quaternion and transform math written once for single values (float) and for the lane types of simd.hpp,
+// with the components of every quaternion or transform spread over separate variables.
+
+#include "simd.hpp"
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+namespace umath::kernels {
+	template<class T>
+	T splat(float f)
+	{
+		if constexpr(std::is_same_v<T, float>)
+			return f;
+		else
+			return T::Set(f);
+	}
+
+	template<class T>
+	struct QuatLanes {
+		T w, x, y, z;
+	};
+
+	// Components of a ScaledTransform, either of a single transform (float) or of one transform per lane
+	template<class T>
+	struct TransformLanes {
+		T px, py, pz;
+		T rw, rx, ry, rz;
+		T sx, sy, sz;
+	};
+
+	// Same as the Quat multiplication
+	template<class T>
+	QuatLanes<T> mul(const QuatLanes<T> &a, const QuatLanes<T> &b)
+	{
+		return {a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z, a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y, a.w * b.y + a.y * b.w + a.z * b.x - a.x * b.z, a.w * b.z + a.z * b.w + a.x * b.y - a.y * b.x};
+	}
+
+	// Rotates the vector by a unit quaternion: v' = v + w * t + cross(q, t) with t = 2 * cross(q, v)
+	template<class T>
+	void rotate(const QuatLanes<T> &q, T &vx, T &vy, T &vz)
+	{
+		auto two = splat<T>(2.f);
+		auto tx = two * (q.y * vz - q.z * vy);
+		auto ty = two * (q.z * vx - q.x * vz);
+		auto tz = two * (q.x * vy - q.y * vx);
+		auto rx = vx + q.w * tx + (q.y * tz - q.z * ty);
+		auto ry = vy + q.w * ty + (q.z * tx - q.x * tz);
+		auto rz = vz + q.w * tz + (q.x * ty - q.y * tx);
+		vx = rx;
+		vy = ry;
+		vz = rz;
+	}
+
+	// Same composition as ScaledTransform::operator*=, the scale of a doesn't affect the translation of b
+	template<class T>
+	TransformLanes<T> compose(const TransformLanes<T> &a, const TransformLanes<T> &b)
+	{
+		TransformLanes<T> r;
+		QuatLanes<T> qa {a.rw, a.rx, a.ry, a.rz};
+		r.px = b.px;
+		r.py = b.py;
+		r.pz = b.pz;
+		rotate(qa, r.px, r.py, r.pz);
+		r.px = r.px + a.px;
+		r.py = r.py + a.py;
+		r.pz = r.pz + a.pz;
+
+		auto rot = mul(qa, QuatLanes<T> {b.rw, b.rx, b.ry, b.rz});
+		r.rw = rot.w;
+		r.rx = rot.x;
+		r.ry = rot.y;
+		r.rz = rot.z;
+
+		r.sx = a.sx * b.sx;
+		r.sy = a.sy * b.sy;
+		r.sz = a.sz * b.sz;
+		return r;
+	}
+
+	// Column-major like ScaledTransform::ToMatrix, m[column * 4 + row]
+	template<class T>
+	void to_matrix(const TransformLanes<T> &t, T (&m)[16])
+	{
+		auto one = splat<T>(1.f);
+		auto two = splat<T>(2.f);
+		auto xx = t.rx * t.rx;
+		auto yy = t.ry * t.ry;
+		auto zz = t.rz * t.rz;
+		auto xy = t.rx * t.ry;
+		auto xz = t.rx * t.rz;
+		auto yz = t.ry * t.rz;
+		auto wx = t.rw * t.rx;
+		auto wy = t.rw * t.ry;
+		auto wz = t.rw * t.rz;
+		m[0] = (one - two * (yy + zz)) * t.sx;
+		m[1] = two * (xy + wz) * t.sx;
+		m[2] = two * (xz - wy) * t.sx;
+		m[3] = splat<T>(0.f);
+		m[4] = two * (xy - wz) * t.sy;
+		m[5] = (one - two * (xx + zz)) * t.sy;
+		m[6] = two * (yz + wx) * t.sy;
+		m[7] = splat<T>(0.f);
+		m[8] = two * (xz + wy) * t.sz;
+		m[9] = two * (yz - wx) * t.sz;
+		m[10] = (one - two * (xx + yy)) * t.sz;
+		m[11] = splat<T>(0.f);
+		m[12] = t.px;
+		m[13] = t.py;
+		m[14] = t.pz;
+		m[15] = one;
+	}
+
+	// acos for x in [0, 1] (Abramowitz and Stegun 4.4.46), absolute error below 2e-8
+	template<class TFloat>
+	TFloat acos_unit(TFloat x)
+	{
+		auto p = TFloat::Set(-0.0012624911f);
+		p = p * x + TFloat::Set(0.0066700901f);
+		p = p * x + TFloat::Set(-0.0170881256f);
+		p = p * x + TFloat::Set(0.0308918810f);
+		p = p * x + TFloat::Set(-0.0501743046f);
+		p = p * x + TFloat::Set(0.0889789874f);
+		p = p * x + TFloat::Set(-0.2145988016f);
+		p = p * x + TFloat::Set(1.5707963050f);
+		return sqrt(TFloat::Set(1.f) - x) * p;
+	}
+
+	// Rounds to the nearest integer for |x| < 2^22
+	template<class TFloat>
+	TFloat round(TFloat x)
+	{
+		auto magic = TFloat::Set(12582912.f); // 1.5 * 2^23
+		return (x + magic) - magic;
+	}
+
+	// sin with a range reduction to [-pi/2, pi/2], absolute error below 1e-6 for |x| < 1000
+	template<class TFloat>
+	TFloat sin(TFloat x)
+	{
+		auto k = round(x * TFloat::Set(0.318309886f));
+		// Two-part pi for an accurate reduction
+		auto r = (x - k * TFloat::Set(3.140625f)) - k * TFloat::Set(0.000967653590f);
+		// sin(r + k * pi) = (-1)^k * sin(r)
+		auto parity = k - TFloat::Set(2.f) * round(k * TFloat::Set(0.5f));
+		auto sign = TFloat::Set(1.f) - TFloat::Set(2.f) * abs(parity);
+		auto r2 = r * r;
+		auto p = TFloat::Set(-2.50521084e-8f);
+		p = p * r2 + TFloat::Set(2.75573192e-6f);
+		p = p * r2 + TFloat::Set(-1.98412698e-4f);
+		p = p * r2 + TFloat::Set(8.33333333e-3f);
+		p = p * r2 + TFloat::Set(-1.66666667e-1f);
+		p = p * r2 + TFloat::Set(1.f);
+		return sign * r * p;
+	}
+
+	// Same as uquat::slerp (shortest path, linear interpolation for nearly identical rotations)
+	template<class TFloat>
+	QuatLanes<TFloat> slerp(const QuatLanes<TFloat> &a, const QuatLanes<TFloat> &b, TFloat factor)
+	{
+		auto cosTheta = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+		auto sign = select(cosTheta < TFloat::Set(0.f), TFloat::Set(-1.f), TFloat::Set(1.f));
+		cosTheta = abs(cosTheta);
+		auto one = TFloat::Set(1.f);
+		auto isLinear = cosTheta > TFloat::Set(1.f - std::numeric_limits<float>::epsilon());
+		auto angle = acos_unit(min(cosTheta, one));
+		// The division is discarded for the linear lanes, where sin(angle) may be zero
+		auto invSin = one / select(isLinear, one, sin(angle));
+		auto wa = select(isLinear, one - factor, sin((one - factor) * angle) * invSin);
+		auto wb = select(isLinear, factor, sin(factor * angle) * invSin) * sign;
+		return {a.w * wa + b.w * wb, a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb};
+	}
+
+	// Normalized linear interpolation along the shortest path
+	template<class TFloat>
+	QuatLanes<TFloat> nlerp(const QuatLanes<TFloat> &a, const QuatLanes<TFloat> &b, TFloat factor)
+	{
+		auto cosTheta = a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+		auto wb = select(cosTheta < TFloat::Set(0.f), -factor, factor);
+		auto wa = TFloat::Set(1.f) - factor;
+		QuatLanes<TFloat> r {a.w * wa + b.w * wb, a.x * wa + b.x * wb, a.y * wa + b.y * wb, a.z * wa + b.z * wb};
+		auto invLen = TFloat::Set(1.f) / sqrt(r.w * r.w + r.x * r.x + r.y * r.y + r.z * r.z);
+		return {r.w * invLen, r.x * invLen, r.y * invLen, r.z * invLen};
+	}
+
+	// Corrects the interpolation factor of nlerp, so that the result approximates slerp. d is the absolute cosine of the angle
+	// between the quaternions. Polynomial fit from Arseny Kapoulkine, "Approximating slerp".
+	template<class T>
+	T slerp_fast_factor(T d, T t)
+	{
+		auto ka = splat<T>(1.0904f) + d * (splat<T>(-3.2452f) + d * (splat<T>(3.55645f) - d * splat<T>(1.43519f)));
+		auto kb = splat<T>(0.848013f) + d * (splat<T>(-1.06021f) + d * splat<T>(0.215638f));
+		auto h = t - splat<T>(0.5f);
+		auto k = ka * h * h + kb;
+		return t + t * h * (t - splat<T>(1.f)) * k;
+	}
+
+	template<class TFloat>
+	QuatLanes<TFloat> slerp_fast(const QuatLanes<TFloat> &a, const QuatLanes<TFloat> &b, TFloat factor)
+	{
+		auto d = abs(a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z);
+		return nlerp(a, b, slerp_fast_factor(d, factor));
+	}
+
+	// Transposes count structures of floats (e.g. TransformLanes<float>) into a structure of lanes.
+	// Lanes beyond count repeat the last structure.
+	template<class TFloat, template<class> class TStruct>
+	TStruct<TFloat> load_lanes(const TStruct<float> *values, uint32_t count = TFloat::width)
+	{
+		constexpr auto numComponents = sizeof(TStruct<float>) / sizeof(float);
+		float tmp[numComponents][TFloat::width];
+		for(uint32_t lane = 0; lane < TFloat::width; ++lane) {
+			auto *components = reinterpret_cast<const float *>(&values[(lane < count) ? lane : (count - 1)]);
+			for(uint32_t c = 0; c < numComponents; ++c)
+				tmp[c][lane] = components[c];
+		}
+		TStruct<TFloat> r;
+		auto *out = reinterpret_cast<TFloat *>(&r);
+		for(uint32_t c = 0; c < numComponents; ++c)
+			out[c] = TFloat::Load(tmp[c]);
+		return r;
+	}
+	template<class TFloat, template<class> class TStruct>
+	void store_lanes(const TStruct<TFloat> &lanes, TStruct<float> *outValues, uint32_t count = TFloat::width)
+	{
+		constexpr auto numComponents = sizeof(TStruct<float>) / sizeof(float);
+		float tmp[numComponents][TFloat::width];
+		auto *in = reinterpret_cast<const TFloat *>(&lanes);
+		for(uint32_t c = 0; c < numComponents; ++c)
+			in[c].Store(tmp[c]);
+		for(uint32_t lane = 0; lane < count; ++lane) {
+			auto *components = reinterpret_cast<float *>(&outValues[lane]);
+			for(uint32_t c = 0; c < numComponents; ++c)
+				components[c] = tmp[c][lane];
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,252 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/transform_soa.hpp"
+#include "transform_kernels.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <new>
+#include <utility>
+
+using namespace umath;
+
+static constexpr auto NUM_COMPONENTS = static_cast<size_t>(TransformSoA::Component::Count);
+static_assert(TransformSoA::LANE_COUNT % simd::FloatN::width == 0);
+
+static size_t get_padded_count(size_t count) { return (count + TransformSoA::LANE_COUNT - 1) / TransformSoA::LANE_COUNT * TransformSoA::LANE_COUNT; }
+
+template<class TFloat>
+static void load_vector3_lanes(const Vector3 *v, uint32_t count, TFloat &outX, TFloat &outY, TFloat &outZ)
+{
+	float tmp[3][TFloat::width];
+	for(uint32_t lane = 0; lane < TFloat::width; ++lane) {
+		auto &p = v[umath::min(lane, count - 1)];
+		tmp[0][lane] = p.x;
+		tmp[1][lane] = p.y;
+		tmp[2][lane] = p.z;
+	}
+	outX = TFloat::Load(tmp[0]);
+	outY = TFloat::Load(tmp[1]);
+	outZ = TFloat::Load(tmp[2]);
+}
+
+template<class TFloat>
+static void store_vector3_lanes(TFloat x, TFloat y, TFloat z, Vector3 *outV, uint32_t count)
+{
+	float tmp[3][TFloat::width];
+	x.Store(tmp[0]);
+	y.Store(tmp[1]);
+	z.Store(tmp[2]);
+	for(uint32_t lane = 0; lane < count; ++lane)
+		outV[lane] = {tmp[0][lane], tmp[1][lane], tmp[2][lane]};
+}
+
+TransformSoA::TransformSoA(size_t count) { Resize(count); }
+TransformSoA::TransformSoA(std::span<const ScaledTransform> transforms) { Assign(transforms); }
+TransformSoA::TransformSoA(const TransformSoA &other) { operator=(other); }
+TransformSoA::TransformSoA(TransformSoA &&other) noexcept { operator=(std::move(other)); }
+TransformSoA::~TransformSoA() { Reallocate(0); }
+
+TransformSoA &TransformSoA::operator=(const TransformSoA &other)
+{
+	if(this == &other)
+		return *this;
+	if(m_capacity < other.m_capacity)
+		Reallocate(other.m_capacity);
+	m_count = other.m_count;
+	auto padded = get_padded_count(m_count);
+	for(size_t c = 0; c < NUM_COMPONENTS && padded > 0; ++c)
+		std::memcpy(m_data + c * m_capacity, other.m_data + c * other.m_capacity, padded * sizeof(float));
+	return *this;
+}
+
+TransformSoA &TransformSoA::operator=(TransformSoA &&other) noexcept
+{
+	std::swap(m_data, other.m_data);
+	std::swap(m_count, other.m_count);
+	std::swap(m_capacity, other.m_capacity);
+	return *this;
+}
+
+void TransformSoA::Reallocate(size_t capacity)
+{
+	float *data = nullptr;
+	if(capacity > 0) {
+		data = static_cast<float *>(::operator new(NUM_COMPONENTS * capacity * sizeof(float), std::align_val_t {ALIGNMENT}));
+		for(size_t c = 0; c < NUM_COMPONENTS && m_data; ++c)
+			std::memcpy(data + c * capacity, m_data + c * m_capacity, umath::min(get_padded_count(m_count), capacity) * sizeof(float));
+	}
+	if(m_data)
+		::operator delete(m_data, std::align_val_t {ALIGNMENT});
+	m_data = data;
+	m_capacity = capacity;
+	m_count = umath::min(m_count, capacity);
+}
+
+void TransformSoA::InitializeRange(size_t start, size_t end)
+{
+	for(size_t c = 0; c < NUM_COMPONENTS; ++c) {
+		auto component = static_cast<Component>(c);
+		auto value = (component == Component::RotationW || component >= Component::ScaleX) ? 1.f : 0.f;
+		auto *data = GetComponentData(component);
+		std::fill(data + start, data + end, value);
+	}
+}
+
+void TransformSoA::Resize(size_t count)
+{
+	auto padded = get_padded_count(count);
+	if(padded > m_capacity)
+		Reallocate(umath::max(padded, m_capacity * 2));
+	// Also resets the removed elements when shrinking, so the padding always consists of identity transforms
+	auto start = umath::min(count, m_count);
+	m_count = count;
+	InitializeRange(start, padded);
+}
+
+void TransformSoA::Assign(std::span<const ScaledTransform> transforms)
+{
+	Resize(transforms.size());
+	for(size_t i = 0; i < transforms.size(); ++i)
+		Set(i, transforms[i]);
+}
+
+void TransformSoA::CopyTo(std::span<ScaledTransform> outTransforms) const
+{
+	assert(outTransforms.size() >= m_count);
+	for(size_t i = 0; i < m_count; ++i)
+		outTransforms[i] = Get(i);
+}
+
+std::vector<ScaledTransform> TransformSoA::ToVector() const
+{
+	std::vector<ScaledTransform> transforms(m_count);
+	CopyTo(transforms);
+	return transforms;
+}
+
+void TransformSoA::Set(size_t index, const ScaledTransform &t)
+{
+	auto &pos = t.GetOrigin();
+	auto &rot = t.GetRotation();
+	auto &scale = t.GetScale();
+	const float values[NUM_COMPONENTS] = {pos.x, pos.y, pos.z, rot.w, rot.x, rot.y, rot.z, scale.x, scale.y, scale.z};
+	for(size_t c = 0; c < NUM_COMPONENTS; ++c)
+		m_data[c * m_capacity + index] = values[c];
+}
+
+ScaledTransform TransformSoA::Get(size_t index) const
+{
+	auto v = [this, index](Component c) { return GetComponentData(c)[index]; };
+	return ScaledTransform {Vector3 {v(Component::PositionX), v(Component::PositionY), v(Component::PositionZ)}, Quat {v(Component::RotationW), v(Component::RotationX), v(Component::RotationY), v(Component::RotationZ)},
+	  Vector3 {v(Component::ScaleX), v(Component::ScaleY), v(Component::ScaleZ)}};
+}
+
+template<class TFloat>
+static kernels::TransformLanes<TFloat> load_transform(const TransformSoA &soa, size_t i)
+{
+	kernels::TransformLanes<TFloat> t;
+	auto *components = reinterpret_cast<TFloat *>(&t);
+	for(size_t c = 0; c < NUM_COMPONENTS; ++c)
+		components[c] = TFloat::Load(soa.GetComponent(static_cast<TransformSoA::Component>(c)).data() + i);
+	return t;
+}
+
+void TransformSoA::TransformPoints(std::span<const Vector3> points, std::span<Vector3> outPoints) const
+{
+	using TFloat = simd::FloatN;
+	assert(points.size() == m_count && outPoints.size() == m_count);
+	for(size_t i = 0; i < m_count; i += TFloat::width) {
+		auto count = static_cast<uint32_t>(umath::min<size_t>(TFloat::width, m_count - i));
+		auto t = load_transform<TFloat>(*this, i);
+		TFloat x, y, z;
+		load_vector3_lanes(points.data() + i, count, x, y, z);
+		// Same as ScaledTransform::operator*(const Vector3&): scale, rotate, translate
+		x = x * t.sx;
+		y = y * t.sy;
+		z = z * t.sz;
+		kernels::rotate(kernels::QuatLanes<TFloat> {t.rw, t.rx, t.ry, t.rz}, x, y, z);
+		store_vector3_lanes(x + t.px, y + t.py, z + t.pz, outPoints.data() + i, count);
+	}
+}
+
+void TransformSoA::GetInverse(TransformSoA &outInverse) const
+{
+	using TFloat = simd::FloatN;
+	outInverse.Resize(m_count);
+	auto padded = get_padded_count(m_count);
+	auto one = TFloat::Set(1.f);
+	auto store = [&outInverse](Component c, size_t i, TFloat v) { v.Store(outInverse.GetComponentData(c) + i); };
+	for(size_t i = 0; i < padded; i += TFloat::width) {
+		auto t = load_transform<TFloat>(*this, i);
+		// Same as ScaledTransform::GetInverse: The translation is only rotated back, not scaled
+		auto invLenSqr = one / (t.rw * t.rw + t.rx * t.rx + t.ry * t.ry + t.rz * t.rz);
+		kernels::QuatLanes<TFloat> rot {t.rw * invLenSqr, -t.rx * invLenSqr, -t.ry * invLenSqr, -t.rz * invLenSqr};
+		auto x = -t.px;
+		auto y = -t.py;
+		auto z = -t.pz;
+		kernels::rotate(rot, x, y, z);
+		store(Component::PositionX, i, x);
+		store(Component::PositionY, i, y);
+		store(Component::PositionZ, i, z);
+		store(Component::RotationW, i, rot.w);
+		store(Component::RotationX, i, rot.x);
+		store(Component::RotationY, i, rot.y);
+		store(Component::RotationZ, i, rot.z);
+		store(Component::ScaleX, i, one / t.sx);
+		store(Component::ScaleY, i, one / t.sy);
+		store(Component::ScaleZ, i, one / t.sz);
+	}
+}
+
+void TransformSoA::Interpolate(const TransformSoA &dst, float factor)
+{
+	using TFloat = simd::FloatN;
+	assert(dst.m_count == m_count);
+	auto padded = get_padded_count(m_count);
+	auto f = TFloat::Set(factor);
+	auto lerp = [this, &dst, f](Component c, size_t i) {
+		auto *data = GetComponentData(c) + i;
+		auto a = TFloat::Load(data);
+		(a + (TFloat::Load(dst.GetComponentData(c) + i) - a) * f).Store(data);
+	};
+	for(size_t i = 0; i < padded; i += TFloat::width) {
+		lerp(Component::PositionX, i);
+		lerp(Component::PositionY, i);
+		lerp(Component::PositionZ, i);
+		lerp(Component::ScaleX, i);
+		lerp(Component::ScaleY, i);
+		lerp(Component::ScaleZ, i);
+		auto load = [i](const TransformSoA &soa, Component c) { return TFloat::Load(soa.GetComponentData(c) + i); };
+		kernels::QuatLanes<TFloat> a {load(*this, Component::RotationW), load(*this, Component::RotationX), load(*this, Component::RotationY), load(*this, Component::RotationZ)};
+		kernels::QuatLanes<TFloat> b {load(dst, Component::RotationW), load(dst, Component::RotationX), load(dst, Component::RotationY), load(dst, Component::RotationZ)};
+		auto r = kernels::slerp(a, b, f);
+		r.w.Store(GetComponentData(Component::RotationW) + i);
+		r.x.Store(GetComponentData(Component::RotationX) + i);
+		r.y.Store(GetComponentData(Component::RotationY) + i);
+		r.z.Store(GetComponentData(Component::RotationZ) + i);
+	}
+}
+
+void TransformSoA::ToMatrices(std::span<Mat4> outMatrices) const
+{
+	using TFloat = simd::FloatN;
+	assert(outMatrices.size() == m_count);
+	for(size_t i = 0; i < m_count; i += TFloat::width) {
+		auto count = umath::min<size_t>(TFloat::width, m_count - i);
+		TFloat m[16];
+		kernels::to_matrix(load_transform<TFloat>(*this, i), m);
+		float tmp[16][TFloat::width];
+		for(uint8_t j = 0; j < 16; ++j)
+			m[j].Store(tmp[j]);
+		for(size_t lane = 0; lane < count; ++lane) {
+			auto &out = outMatrices[i + lane];
+			for(uint8_t c = 0; c < 4; ++c) {
+				for(uint8_t r = 0; r < 4; ++r)
+					out[c][r] = tmp[c * 4 + r][lane];
+			}
+		}
+	}
+}
@@ -0,0 +1,317 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/triangle_mesh_bvh.hpp"
+#include "bvh_builder.hpp"
+#include "simd.hpp"
+#include <array>
+#include <cassert>
+
+using namespace bounding_volume;
+
+namespace {
+	struct Ray {
+		Ray(const Vector3 &origin, const Vector3 &dir) : origin {origin}, dir {dir}, dirInv {1 / dir.x, 1 / dir.y, 1 / dir.z} {}
+		Vector3 origin;
+		Vector3 dir;
+		Vector3 dirInv;
+	};
+	using PacketFloat = umath::simd::Float8;
+	using PacketMask = PacketFloat::Mask;
+	static_assert(PacketFloat::width == TriangleMeshBVH::PACKET_SIZE);
+	struct RayPacket {
+		PacketFloat origin[3];
+		PacketFloat dir[3];
+		PacketFloat dirInv[3];
+	};
+	using TraversalStack = std::array<uint32_t, BVHNode::MAX_DEPTH>;
+};
+
+// Same epsilon as line_triangle
+static constexpr float TRIANGLE_EPSILON = 0.000001f;
+
+// Slab test restricted to [0, tMax]. If the ray is parallel to a slab and starts on its boundary, the
+// distances are NaN; since all comparisons with NaN are false, the slab is ignored in that case.
+static bool ray_aabb(const Ray &ray, const Vector3 &min, const Vector3 &max, float tMax, float &outTMin)
+{
+	auto tNear = 0.f;
+	auto tFar = tMax;
+	for(uint8_t i = 0; i < 3; ++i) {
+		auto t0 = (min[i] - ray.origin[i]) * ray.dirInv[i];
+		auto t1 = (max[i] - ray.origin[i]) * ray.dirInv[i];
+		if(ray.dirInv[i] < 0.f)
+			std::swap(t0, t1);
+		if(t0 > tNear)
+			tNear = t0;
+		if(t1 < tFar)
+			tFar = t1;
+	}
+	if(tNear > tFar)
+		return false;
+	outTMin = tNear;
+	return true;
+}
+
+template<class TTriangle>
+static bool ray_triangle(const Ray &ray, const TTriangle &tri, bool cull, float tMax, float &outT, float &outU, float &outV)
+{
+	auto pvec = uvec::cross(ray.dir, tri.edge2);
+	auto det = uvec::dot(tri.edge1, pvec);
+	if(cull ? (det < TRIANGLE_EPSILON) : (det > -TRIANGLE_EPSILON && det < TRIANGLE_EPSILON))
+		return false;
+	auto invDet = 1.f / det;
+	auto tvec = ray.origin - tri.v0;
+	auto u = uvec::dot(tvec, pvec) * invDet;
+	if(u < 0.f || u > 1.f)
+		return false;
+	auto qvec = uvec::cross(tvec, tri.edge1);
+	auto v = uvec::dot(ray.dir, qvec) * invDet;
+	if(v < 0.f || (u + v) > 1.f)
+		return false;
+	auto t = uvec::dot(tri.edge2, qvec) * invDet;
+	if(t < 0.f || t > tMax)
+		return false;
+	outT = t;
+	outU = u;
+	outV = v;
+	return true;
+}
+
+// Packet version of ray_aabb, tMax is per ray
+static PacketMask ray_aabb(const RayPacket &packet, const BVHNode &node, const PacketFloat &tMax)
+{
+	auto tNear = PacketFloat::Set(0.f);
+	auto tFar = tMax;
+	auto zero = PacketFloat::Set(0.f);
+	for(uint8_t i = 0; i < 3; ++i) {
+		auto t0 = (PacketFloat::Set(node.min[i]) - packet.origin[i]) * packet.dirInv[i];
+		auto t1 = (PacketFloat::Set(node.max[i]) - packet.origin[i]) * packet.dirInv[i];
+		auto neg = packet.dirInv[i] < zero;
+		auto tMin = select(neg, t1, t0);
+		auto tMaxAxis = select(neg, t0, t1);
+		tNear = select(tMin > tNear, tMin, tNear);
+		tFar = select(tMaxAxis < tFar, tMaxAxis, tFar);
+	}
+	return tNear <= tFar;
+}
+
+// Packet version of ray_triangle, returns the lanes with a closer hit than tMax
+static PacketMask ray_triangle(const RayPacket &packet, const Vector3 &v0, const Vector3 &edge1, const Vector3 &edge2, bool cull, const PacketFloat &tMax, PacketFloat &outT, PacketFloat &outU, PacketFloat &outV)
+{
+	const PacketFloat e1[3] = {PacketFloat::Set(edge1.x), PacketFloat::Set(edge1.y), PacketFloat::Set(edge1.z)};
+	const PacketFloat e2[3] = {PacketFloat::Set(edge2.x), PacketFloat::Set(edge2.y), PacketFloat::Set(edge2.z)};
+	auto &d = packet.dir;
+	const PacketFloat pvec[3] = {d[1] * e2[2] - d[2] * e2[1], d[2] * e2[0] - d[0] * e2[2], d[0] * e2[1] - d[1] * e2[0]};
+	auto det = e1[0] * pvec[0] + e1[1] * pvec[1] + e1[2] * pvec[2];
+	auto eps = PacketFloat::Set(TRIANGLE_EPSILON);
+	auto valid = cull ? (det >= eps) : ((det >= eps) | (det <= -eps));
+	auto invDet = PacketFloat::Set(1.f) / det;
+	const PacketFloat tvec[3] = {packet.origin[0] - PacketFloat::Set(v0.x), packet.origin[1] - PacketFloat::Set(v0.y), packet.origin[2] - PacketFloat::Set(v0.z)};
+	auto u = (tvec[0] * pvec[0] + tvec[1] * pvec[1] + tvec[2] * pvec[2]) * invDet;
+	auto zero = PacketFloat::Set(0.f);
+	auto one = PacketFloat::Set(1.f);
+	valid = valid & (u >= zero) & (u <= one);
+	const PacketFloat qvec[3] = {tvec[1] * e1[2] - tvec[2] * e1[1], tvec[2] * e1[0] - tvec[0] * e1[2], tvec[0] * e1[1] - tvec[1] * e1[0]};
+	auto v = (d[0] * qvec[0] + d[1] * qvec[1] + d[2] * qvec[2]) * invDet;
+	valid = valid & (v >= zero) & ((u + v) <= one);
+	auto t = (e2[0] * qvec[0] + e2[1] * qvec[1] + e2[2] * qvec[2]) * invDet;
+	valid = valid & (t >= zero) & (t <= tMax);
+	outT = t;
+	outU = u;
+	outV = v;
+	return valid;
+}
+
+TriangleMeshBVH::TriangleMeshBVH(std::span<const Vector3> verts, std::span<const uint16_t> indices, uint32_t maxLeafSize, uint32_t threadCount) { Build(verts, indices, maxLeafSize, threadCount); }
+TriangleMeshBVH::TriangleMeshBVH(std::span<const Vector3> verts, std::span<const uint32_t> indices, uint32_t maxLeafSize, uint32_t threadCount) { Build(verts, indices, maxLeafSize, threadCount); }
+void TriangleMeshBVH::Build(std::span<const Vector3> verts, std::span<const uint16_t> indices, uint32_t maxLeafSize, uint32_t threadCount) { BuildFromIndices(verts, indices, maxLeafSize, threadCount); }
+void TriangleMeshBVH::Build(std::span<const Vector3> verts, std::span<const uint32_t> indices, uint32_t maxLeafSize, uint32_t threadCount) { BuildFromIndices(verts, indices, maxLeafSize, threadCount); }
+
+template<typename TIndex>
+void TriangleMeshBVH::BuildFromIndices(std::span<const Vector3> verts, std::span<const TIndex> indices, uint32_t maxLeafSize, uint32_t threadCount)
+{
+	assert((indices.size() % 3) == 0);
+	auto numTris = indices.size() / 3;
+	std::vector<AABB> triBounds;
+	triBounds.reserve(numTris);
+	for(size_t i = 0; i < numTris; ++i) {
+		auto &v0 = verts[indices[i * 3]];
+		auto &v1 = verts[indices[i * 3 + 1]];
+		auto &v2 = verts[indices[i * 3 + 2]];
+		triBounds.push_back({glm::min(v0, glm::min(v1, v2)), glm::max(v0, glm::max(v1, v2))});
+	}
+	std::vector<uint32_t> order;
+	bvh_builder::build(triBounds, maxLeafSize, m_nodes, order, threadCount);
+	m_triangles.resize(order.size());
+	for(size_t i = 0; i < order.size(); ++i) {
+		auto triIdx = order[i];
+		auto &v0 = verts[indices[triIdx * 3]];
+		m_triangles[i] = {v0, verts[indices[triIdx * 3 + 1]] - v0, verts[indices[triIdx * 3 + 2]] - v0, triIdx};
+	}
+}
+
+void TriangleMeshBVH::Clear()
+{
+	m_nodes.clear();
+	m_triangles.clear();
+}
+
+std::optional<TriangleMeshBVH::RayHit> TriangleMeshBVH::Raycast(const Vector3 &origin, const Vector3 &dir, float maxDist, bool cull) const
+{
+	if(m_nodes.empty())
+		return {};
+	Ray ray {origin, dir};
+	float t, u, v;
+	if(!ray_aabb(ray, m_nodes.front().min, m_nodes.front().max, maxDist, t))
+		return {};
+	std::optional<RayHit> closest {};
+	TraversalStack stack;
+	uint32_t stackSize = 0;
+	uint32_t cur = 0;
+	for(;;) {
+		auto &node = m_nodes[cur];
+		if(node.IsLeaf()) {
+			for(auto i = node.index; i < node.index + node.count; ++i) {
+				auto &tri = m_triangles[i];
+				if(ray_triangle(ray, tri, cull, maxDist, t, u, v)) {
+					maxDist = t;
+					closest = RayHit {t, u, v, tri.index};
+				}
+			}
+		}
+		else {
+			uint32_t children[2] = {cur + 1, node.index};
+			float tChildren[2];
+			bool hits[2];
+			for(uint8_t i = 0; i < 2; ++i)
+				hits[i] = ray_aabb(ray, m_nodes[children[i]].min, m_nodes[children[i]].max, maxDist, tChildren[i]);
+			if(hits[0] && hits[1]) {
+				if(tChildren[1] < tChildren[0])
+					std::swap(children[0], children[1]);
+				assert(stackSize < stack.size());
+				stack[stackSize++] = children[1];
+				cur = children[0];
+				continue;
+			}
+			if(hits[0] || hits[1]) {
+				cur = hits[0] ? children[0] : children[1];
+				continue;
+			}
+		}
+		auto found = false;
+		while(stackSize > 0) {
+			cur = stack[--stackSize];
+			if(ray_aabb(ray, m_nodes[cur].min, m_nodes[cur].max, maxDist, t)) {
+				found = true;
+				break;
+			}
+		}
+		if(!found)
+			break;
+	}
+	return closest;
+}
+
+void TriangleMeshBVH::RaycastPacket(const Vector3 *origins, const Vector3 *dirs, std::optional<RayHit> *outHits, uint32_t count, float maxDist, bool cull) const
+{
+	// Unused lanes are filled with the first ray and get a negative maximum distance, so they never hit anything
+	constexpr auto packetSize = PACKET_SIZE;
+	alignas(32) float data[9][packetSize];
+	alignas(32) float tMaxData[packetSize];
+	for(uint32_t i = 0; i < packetSize; ++i) {
+		auto rayIdx = (i < count) ? i : 0;
+		auto &o = origins[rayIdx];
+		auto &d = dirs[rayIdx];
+		for(uint8_t j = 0; j < 3; ++j) {
+			data[j][i] = o[j];
+			data[j + 3][i] = d[j];
+			data[j + 6][i] = 1 / d[j];
+		}
+		tMaxData[i] = (i < count) ? maxDist : -1.f;
+	}
+	RayPacket packet;
+	for(uint8_t j = 0; j < 3; ++j) {
+		packet.origin[j] = PacketFloat::Load(data[j]);
+		packet.dir[j] = PacketFloat::Load(data[j + 3]);
+		packet.dirInv[j] = PacketFloat::Load(data[j + 6]);
+	}
+	auto tMax = PacketFloat::Load(tMaxData);
+	auto tBest = PacketFloat::Set(0.f);
+	auto uBest = tBest;
+	auto vBest = tBest;
+	std::array<uint32_t, packetSize> triBest;
+	uint32_t hitBits = 0;
+
+	TraversalStack stack;
+	uint32_t stackSize = 0;
+	uint32_t cur = 0;
+	for(;;) {
+		auto &node = m_nodes[cur];
+		if(ray_aabb(packet, node, tMax).GetBits() != 0) {
+			if(!node.IsLeaf()) {
+				// Visit the child which is closer along the direction of the first ray first
+				auto &left = m_nodes[cur + 1];
+				auto &right = m_nodes[node.index];
+				auto centerDiff = (right.min + right.max) - (left.min + left.max);
+				uint8_t axis = 0;
+				for(uint8_t i = 1; i < 3; ++i) {
+					if(std::abs(centerDiff[i]) > std::abs(centerDiff[axis]))
+						axis = i;
+				}
+				auto leftFirst = (dirs[0][axis] * centerDiff[axis]) >= 0.f;
+				assert(stackSize < stack.size());
+				stack[stackSize++] = leftFirst ? node.index : (cur + 1);
+				cur = leftFirst ? (cur + 1) : node.index;
+				continue;
+			}
+			for(auto i = node.index; i < node.index + node.count; ++i) {
+				auto &tri = m_triangles[i];
+				PacketFloat t, u, v;
+				auto hit = ray_triangle(packet, tri.v0, tri.edge1, tri.edge2, cull, tMax, t, u, v);
+				auto bits = hit.GetBits();
+				if(bits == 0)
+					continue;
+				tMax = select(hit, t, tMax);
+				tBest = select(hit, t, tBest);
+				uBest = select(hit, u, uBest);
+				vBest = select(hit, v, vBest);
+				hitBits |= bits;
+				for(uint32_t lane = 0; lane < packetSize; ++lane) {
+					if(bits & (1u << lane))
+						triBest[lane] = tri.index;
+				}
+			}
+		}
+		if(stackSize == 0)
+			break;
+		cur = stack[--stackSize];
+	}
+
+	alignas(32) float tOut[packetSize];
+	alignas(32) float uOut[packetSize];
+	alignas(32) float vOut[packetSize];
+	tBest.Store(tOut);
+	uBest.Store(uOut);
+	vBest.Store(vOut);
+	for(uint32_t i = 0; i < count; ++i) {
+		if(hitBits & (1u << i))
+			outHits[i] = RayHit {tOut[i], uOut[i], vOut[i], triBest[i]};
+		else
+			outHits[i] = {};
+	}
+}
+
+void TriangleMeshBVH::Raycast(std::span<const Vector3> origins, std::span<const Vector3> dirs, std::span<std::optional<RayHit>> outHits, float maxDist, bool cull) const
+{
+	assert(origins.size() == dirs.size() && outHits.size() >= origins.size());
+	auto count = umath::min(origins.size(), dirs.size(), outHits.size());
+	if(m_nodes.empty()) {
+		std::fill(outHits.begin(), outHits.begin() + count, std::optional<RayHit> {});
+		return;
+	}
+	for(size_t i = 0; i < count; i += PACKET_SIZE) {
+		auto n = static_cast<uint32_t>(umath::min<size_t>(PACKET_SIZE, count - i));
+		RaycastPacket(origins.data() + i, dirs.data() + i, outHits.data() + i, n, maxDist, cull);
+	}
+}
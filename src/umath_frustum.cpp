@@ -53,3 +53,99 @@ Vector3 umath::frustum::get_plane_point(const Vector3 &pos, const Vector3 &forwa
 	center += right * -(w / 2.f * (uv.x - 0.5f)) + up * (h / 2.f * (uv.y - 0.5f));
 	return center;
 }
+
+////////////////////////////////////
+
+umath::Frustum::Frustum()
+{
+	normalX.fill(0.f);
+	normalY.fill(0.f);
+	normalZ.fill(0.f);
+	distance.fill(std::numeric_limits<float>::max());
+}
+
+umath::Frustum::Frustum(const Mat4 &vp) : Frustum {}
+{
+	// See "Fast Extraction of Viewing Frustum Planes from the World-View-Projection Matrix" by Gil Gribb and Klaus Hartmann
+	auto getRow = [&vp](uint8_t i) -> Vector4 { return Vector4 {vp[0][i], vp[1][i], vp[2][i], vp[3][i]}; };
+	auto r0 = getRow(0);
+	auto r1 = getRow(1);
+	auto r2 = getRow(2);
+	auto r3 = getRow(3);
+	// Each plane is (a,b,c,e) with dot(abc, p) + e >= 0 for points inside the frustum
+	const std::array<Vector4, PLANE_COUNT> clipPlanes = {
+	  r3 + r0, // Left
+	  r3 - r0, // Right
+	  r3 + r1, // Bottom
+	  r3 - r1, // Top
+	  r2,      // Near (Depth range [0,1])
+	  r3 - r2  // Far
+	};
+	for(uint32_t i = 0; i < PLANE_COUNT; ++i) {
+		auto &p = clipPlanes[i];
+		auto l = uvec::length(uvec::xyz(p));
+		if(l == 0.f)
+			continue;
+		SetPlane(static_cast<PlaneIndex>(i), -uvec::xyz(p) / l, p.w / l);
+	}
+}
+
+umath::Frustum::Frustum(const Vector3 &pos, const Vector3 &forward, const Vector3 &up, float fovRad, float nearZ, float farZ, float aspectRatio) : Frustum {}
+{
+	auto n = frustum::get_plane_boundaries(pos, forward, up, fovRad, nearZ, aspectRatio, nullptr, nullptr);
+	auto f = frustum::get_plane_boundaries(pos, forward, up, fovRad, farZ, aspectRatio, nullptr, nullptr);
+	auto center = frustum::get_plane_center(pos, forward, (nearZ + farZ) / 2.f);
+	auto setPlane = [this, &center](PlaneIndex idx, const Vector3 &a, const Vector3 &b, const Vector3 &c) {
+		Vector3 n;
+		float d;
+		uvec::calc_plane(a, b, c, n, d);
+		// The winding depends on the sign conventions of get_plane_size, so we just make sure the normal points away from the center
+		if(uvec::dot(n, center) - d > 0.f) {
+			n = -n;
+			d = -d;
+		}
+		SetPlane(idx, n, d);
+	};
+	// Boundaries are ordered bottom left, top left, top right, bottom right
+	setPlane(PlaneIndex::Left, n[0], n[1], f[1]);
+	setPlane(PlaneIndex::Right, n[2], n[3], f[3]);
+	setPlane(PlaneIndex::Bottom, n[3], n[0], f[0]);
+	setPlane(PlaneIndex::Top, n[1], n[2], f[2]);
+	setPlane(PlaneIndex::Near, n[0], n[1], n[2]);
+	setPlane(PlaneIndex::Far, f[0], f[1], f[2]);
+}
+
+umath::Frustum::Frustum(const std::vector<Plane> &planes) : Frustum {}
+{
+	auto n = umath::min(planes.size(), static_cast<size_t>(PLANE_COUNT));
+	for(auto i = decltype(n) {0u}; i < n; ++i)
+		SetPlane(static_cast<PlaneIndex>(i), planes[i]);
+}
+
+void umath::Frustum::SetPlane(PlaneIndex idx, const Vector3 &n, float d)
+{
+	auto i = umath::to_integral(idx);
+	normalX[i] = n.x;
+	normalY[i] = n.y;
+	normalZ[i] = n.z;
+	distance[i] = d;
+}
+void umath::Frustum::SetPlane(PlaneIndex idx, const Plane &plane) { SetPlane(idx, plane.GetNormal(), static_cast<float>(plane.GetDistance())); }
+Vector4 umath::Frustum::GetPlaneVector(PlaneIndex idx) const
+{
+	auto i = umath::to_integral(idx);
+	return Vector4 {normalX[i], normalY[i], normalZ[i], distance[i]};
+}
+umath::Plane umath::Frustum::GetPlane(PlaneIndex idx) const
+{
+	auto v = GetPlaneVector(idx);
+	return Plane {uvec::xyz(v), static_cast<double>(v.w)};
+}
+std::vector<umath::Plane> umath::Frustum::ToPlanes() const
+{
+	std::vector<Plane> planes;
+	planes.reserve(PLANE_COUNT);
+	for(uint32_t i = 0; i < PLANE_COUNT; ++i)
+		planes.push_back(GetPlane(static_cast<PlaneIndex>(i)));
+	return planes;
+}
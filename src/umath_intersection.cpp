@@ -3,6 +3,7 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
 
 #include "mathutil/umath_geometry.hpp"
+#include "profile_scope.hpp"
 
 const float EPSILON = 1.19209e-005f;
 
@@ -123,6 +124,7 @@ bool umath::intersection::sphere_plane(const Vector3 &sphereOrigin, float sphere
 
 umath::intersection::Result umath::intersection::line_aabb(const Vector3 &o, const Vector3 &d, const Vector3 &min, const Vector3 &max, float *tMinRes, float *tMaxRes)
 {
+	MATHUTIL_PROFILE_SCOPE(LineAabb);
 	Vector3 dirInv(1 / d.x, 1 / d.y, 1 / d.z);
 	const int sign[] = {dirInv.x < 0, dirInv.y < 0, dirInv.z < 0};
 	Vector3 bounds[] = {min, max};
@@ -285,6 +287,7 @@ bool umath::intersection::point_in_plane_mesh(const Vector3 &vec, const std::vec
 
 umath::intersection::Intersect umath::intersection::sphere_in_plane_mesh(const Vector3 &vec, float radius, const std::vector<Plane> &planes, bool skipInsideTest)
 {
+	MATHUTIL_PROFILE_SCOPE(SphereInPlaneMesh);
 	if(point_in_plane_mesh(vec, planes) == false) {
 		for(auto it = planes.begin(); it != planes.end(); ++it) {
 			auto &plane = const_cast<Plane &>(*it);
@@ -314,6 +317,7 @@ umath::intersection::Intersect umath::intersection::triangle_in_plane_mesh(const
 
 umath::intersection::Intersect umath::intersection::aabb_in_plane_mesh(const Vector3 &min, const Vector3 &max, const std::vector<Plane> &planes)
 {
+	MATHUTIL_PROFILE_SCOPE(AabbInPlaneMesh);
 	// Note: If the current method causes problems, try switching to the other one.
 	// The second method is faster for most cases.
 #define AABB_PLANE_MESH_INTERSECTION_METHOD 1
@@ -650,8 +654,8 @@ Vector3 umath::geometry::closest_point_on_sphere_to_line(const Vector3 &origin,
 
 bool umath::sweep::aabb_with_aabb(const Vector3 &aa, const Vector3 &ab, const Vector3 &extA, const Vector3 &ba, const Vector3 &bb, const Vector3 &extB, float *entryTime, float *exitTime, Vector3 *normal)
 {
-	bounding_volume::AABB a(aa, extA);
-	bounding_volume::AABB b(ba, extB);
+	bounding_volume::AABB a(aa - extA, aa + extA);
+	bounding_volume::AABB b(ba - extB, ba + extB);
 	*entryTime = 0;
 	*exitTime = 0;
 	if(normal != NULL) {
@@ -661,26 +665,29 @@ bool umath::sweep::aabb_with_aabb(const Vector3 &aa, const Vector3 &ab, const Ve
 	}
 	if(a.Intersects(b))
 		return true;
-	Vector3 va = ab - aa;
-	Vector3 vb = bb - ba;
+	// Movement of A relative to B
+	Vector3 va = (ab - aa) - (bb - ba);
 	Vector3 invEntry(0, 0, 0);
 	Vector3 invExit(0, 0, 0);
 	Vector3 entry(0, 0, 0);
 	Vector3 exit(0, 0, 0);
 	Vector3 aMax = aa + extA;
 	Vector3 bMax = ba + extB;
-	aa -= extA;
-	ba -= extB;
+	Vector3 aMin = aa - extA;
+	Vector3 bMin = ba - extB;
 	for(int i = 0; i < 3; i++) {
 		if(va[i] > 0.0f) {
-			invEntry[i] = ba[i] - aMax[i];
-			invExit[i] = bMax[i] - aa[i];
+			invEntry[i] = bMin[i] - aMax[i];
+			invExit[i] = bMax[i] - aMin[i];
 		}
 		else {
-			invEntry[i] = bMax[i] - aa[i];
-			invExit[i] = ba[i] - aMax[i];
+			invEntry[i] = bMax[i] - aMin[i];
+			invExit[i] = bMin[i] - aMax[i];
 		}
 		if(va[i] == 0.0f) {
+			// No movement on this axis, so the boxes can only collide if they already overlap on it
+			if(aMax[i] < bMin[i] || bMax[i] < aMin[i])
+				return false;
 			entry[i] = -std::numeric_limits<float>::infinity();
 			exit[i] = std::numeric_limits<float>::infinity();
 		}
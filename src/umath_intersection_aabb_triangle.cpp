@@ -1,9 +1,14 @@
 #include "mathutil/umath_geometry.hpp"
+#include "simd.hpp"
+#include "profile_scope.hpp"
+#include <algorithm>
+#include <cassert>
 
 static bool triBoxOverlap(glm::vec3 boxcenter, glm::vec3 boxhalfsize, glm::vec3 tv0, glm::vec3 tv1, glm::vec3 tv2);
 
 bool umath::intersection::aabb_triangle(const Vector3 &pmin, const Vector3 &pmax, const Vector3 &pa, const Vector3 &pb, const Vector3 &pc)
 {
+	MATHUTIL_PROFILE_SCOPE(AabbTriangle);
 	auto center = (pmin + pmax) * 0.5f;
 	auto extents = (pmax - pmin) * 0.5f;
 	return triBoxOverlap(center, extents, pa, pb, pc);
@@ -246,3 +251,261 @@ bool triBoxOverlap(glm::vec3 boxcenter, glm::vec3 boxhalfsize, glm::vec3 tv0, gl
 
 	return true; /* box and triangle overlaps */
 }
+
+// Vectorized equivalent of triBoxOverlap. Every lane tests one box against one triangle, the operation order
+// matches the scalar version, so the results are identical.
+template<class TFloat>
+static typename TFloat::Mask tri_box_overlap(const TFloat (&boxcenter)[3], const TFloat (&boxhalfsize)[3], const TFloat (&tv0)[3], const TFloat (&tv1)[3], const TFloat (&tv2)[3])
+{
+	const TFloat v0[3] = {tv0[0] - boxcenter[0], tv0[1] - boxcenter[1], tv0[2] - boxcenter[2]};
+	const TFloat v1[3] = {tv1[0] - boxcenter[0], tv1[1] - boxcenter[1], tv1[2] - boxcenter[2]};
+	const TFloat v2[3] = {tv2[0] - boxcenter[0], tv2[1] - boxcenter[1], tv2[2] - boxcenter[2]};
+	const TFloat e0[3] = {v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]};
+	const TFloat e1[3] = {v2[0] - v1[0], v2[1] - v1[1], v2[2] - v1[2]};
+	const TFloat e2[3] = {v0[0] - v2[0], v0[1] - v2[1], v0[2] - v2[2]};
+	auto &h = boxhalfsize;
+
+	// Lanes with a separating axis
+	auto zero = TFloat::Set(0.f);
+	auto separated = zero > zero;
+	auto axisTest = [&separated](const TFloat &pa, const TFloat &pb, const TFloat &rad) { separated = separated | (min(pa, pb) > rad) | (max(pa, pb) < -rad); };
+	// Bullet 3: Cross products of the edges with the {x,y,z}-directions
+	auto axisTestX = [&](const TFloat &a, const TFloat &b, const TFloat &fa, const TFloat &fb, const TFloat (&va)[3], const TFloat (&vb)[3]) { axisTest(a * va[1] - b * va[2], a * vb[1] - b * vb[2], fa * h[1] + fb * h[2]); };
+	auto axisTestY = [&](const TFloat &a, const TFloat &b, const TFloat &fa, const TFloat &fb, const TFloat (&va)[3], const TFloat (&vb)[3]) { axisTest(-a * va[0] + b * va[2], -a * vb[0] + b * vb[2], fa * h[0] + fb * h[2]); };
+	auto axisTestZ = [&](const TFloat &a, const TFloat &b, const TFloat &fa, const TFloat &fb, const TFloat (&va)[3], const TFloat (&vb)[3]) { axisTest(a * va[0] - b * va[1], a * vb[0] - b * vb[1], fa * h[0] + fb * h[1]); };
+
+	auto fex = abs(e0[0]);
+	auto fey = abs(e0[1]);
+	auto fez = abs(e0[2]);
+	axisTestX(e0[2], e0[1], fez, fey, v0, v2);
+	axisTestY(e0[2], e0[0], fez, fex, v0, v2);
+	axisTestZ(e0[1], e0[0], fey, fex, v1, v2);
+
+	fex = abs(e1[0]);
+	fey = abs(e1[1]);
+	fez = abs(e1[2]);
+	axisTestX(e1[2], e1[1], fez, fey, v0, v2);
+	axisTestY(e1[2], e1[0], fez, fex, v0, v2);
+	axisTestZ(e1[1], e1[0], fey, fex, v0, v1);
+
+	fex = abs(e2[0]);
+	fey = abs(e2[1]);
+	fez = abs(e2[2]);
+	axisTestX(e2[2], e2[1], fez, fey, v0, v1);
+	axisTestY(e2[2], e2[0], fez, fex, v0, v1);
+	axisTestZ(e2[1], e2[0], fey, fex, v1, v2);
+
+	// Bullet 1: Overlap in the {x,y,z}-directions
+	for(uint8_t i = 0; i < 3; ++i)
+		separated = separated | (min(min(v0[i], v1[i]), v2[i]) > h[i]) | (max(max(v0[i], v1[i]), v2[i]) < -h[i]);
+
+	// Bullet 2: Box against the plane of the triangle
+	const TFloat normal[3] = {e0[1] * e1[2] - e1[1] * e0[2], e0[2] * e1[0] - e1[2] * e0[0], e0[0] * e1[1] - e1[0] * e0[1]};
+	TFloat vmin[3];
+	TFloat vmax[3];
+	for(uint8_t q = 0; q < 3; ++q) {
+		auto positive = normal[q] > zero;
+		vmin[q] = select(positive, -h[q] - v0[q], h[q] - v0[q]);
+		vmax[q] = select(positive, h[q] - v0[q], -h[q] - v0[q]);
+	}
+	auto dotMin = normal[0] * vmin[0] + normal[1] * vmin[1] + normal[2] * vmin[2];
+	auto dotMax = normal[0] * vmax[0] + normal[1] * vmax[1] + normal[2] * vmax[2];
+	return (dotMax >= zero).AndNot(separated | (dotMin > zero));
+}
+
+template<class TMask>
+static void store_results(const TMask &mask, bool *outResults, uint32_t count)
+{
+	auto bits = mask.GetBits();
+	for(auto i = decltype(count) {0u}; i < count; ++i)
+		outResults[i] = (bits & (1u << i)) != 0;
+}
+
+void umath::intersection::aabb_triangle(const AABBSoAView &aabbs, const Vector3 &a, const Vector3 &b, const Vector3 &c, std::span<bool> outResults)
+{
+	MATHUTIL_PROFILE_SCOPE(AabbTriangleBatch);
+	using TFloat = umath::simd::FloatN;
+	constexpr auto width = TFloat::width;
+	assert(outResults.size() >= aabbs.size());
+	auto count = umath::min(aabbs.size(), outResults.size());
+	const TFloat tv0[3] = {TFloat::Set(a.x), TFloat::Set(a.y), TFloat::Set(a.z)};
+	const TFloat tv1[3] = {TFloat::Set(b.x), TFloat::Set(b.y), TFloat::Set(b.z)};
+	const TFloat tv2[3] = {TFloat::Set(c.x), TFloat::Set(c.y), TFloat::Set(c.z)};
+	auto half = TFloat::Set(0.5f);
+	const std::span<const float> *src[2][3] = {{&aabbs.minX, &aabbs.minY, &aabbs.minZ}, {&aabbs.maxX, &aabbs.maxY, &aabbs.maxZ}};
+	for(size_t i = 0; i < count; i += width) {
+		auto n = static_cast<uint32_t>(umath::min<size_t>(width, count - i));
+		TFloat bounds[2][3];
+		if(n == width) {
+			for(uint8_t j = 0; j < 2; ++j) {
+				for(uint8_t k = 0; k < 3; ++k)
+					bounds[j][k] = TFloat::Load(src[j][k]->data() + i);
+			}
+		}
+		else {
+			// Remaining boxes are copied into a zero-padded block
+			float tmp[width] {};
+			for(uint8_t j = 0; j < 2; ++j) {
+				for(uint8_t k = 0; k < 3; ++k) {
+					std::copy(src[j][k]->data() + i, src[j][k]->data() + i + n, tmp);
+					bounds[j][k] = TFloat::Load(tmp);
+				}
+			}
+		}
+		TFloat center[3];
+		TFloat extents[3];
+		for(uint8_t k = 0; k < 3; ++k) {
+			center[k] = (bounds[0][k] + bounds[1][k]) * half;
+			extents[k] = (bounds[1][k] - bounds[0][k]) * half;
+		}
+		store_results(tri_box_overlap(center, extents, tv0, tv1, tv2), outResults.data() + i, n);
+	}
+}
+
+template<typename TIndex>
+static void aabb_triangle(const Vector3 &min, const Vector3 &max, std::span<const Vector3> verts, std::span<const TIndex> indices, std::span<bool> outResults)
+{
+	using TFloat = umath::simd::FloatN;
+	constexpr auto width = TFloat::width;
+	auto numTris = indices.size() / 3;
+	assert(outResults.size() >= numTris);
+	auto center = (min + max) * 0.5f;
+	auto extents = (max - min) * 0.5f;
+	const TFloat boxCenter[3] = {TFloat::Set(center.x), TFloat::Set(center.y), TFloat::Set(center.z)};
+	const TFloat boxHalfSize[3] = {TFloat::Set(extents.x), TFloat::Set(extents.y), TFloat::Set(extents.z)};
+	for(size_t i = 0; i < numTris; i += width) {
+		auto n = static_cast<uint32_t>(umath::min<size_t>(width, numTris - i));
+		// Gather the triangle vertices into lanes, unused lanes repeat the first triangle
+		float tmp[3][3][width];
+		for(uint32_t lane = 0; lane < width; ++lane) {
+			auto triIdx = i + ((lane < n) ? lane : 0);
+			for(uint8_t v = 0; v < 3; ++v) {
+				auto &p = verts[indices[triIdx * 3 + v]];
+				for(uint8_t k = 0; k < 3; ++k)
+					tmp[v][k][lane] = p[k];
+			}
+		}
+		TFloat tv[3][3];
+		for(uint8_t v = 0; v < 3; ++v) {
+			for(uint8_t k = 0; k < 3; ++k)
+				tv[v][k] = TFloat::Load(tmp[v][k]);
+		}
+		store_results(tri_box_overlap(boxCenter, boxHalfSize, tv[0], tv[1], tv[2]), outResults.data() + i, n);
+	}
+}
+void umath::intersection::aabb_triangle(const Vector3 &min, const Vector3 &max, std::span<const Vector3> verts, std::span<const uint16_t> indices, std::span<bool> outResults) { ::aabb_triangle(min, max, verts, indices, outResults); }
+void umath::intersection::aabb_triangle(const Vector3 &min, const Vector3 &max, std::span<const Vector3> verts, std::span<const uint32_t> indices, std::span<bool> outResults) { ::aabb_triangle(min, max, verts, indices, outResults); }
+
+// Calls fOnVoxels(x, y, z, bits) for every row segment of up to FloatN::width voxels starting at (x, y, z), where
+// the set bits mark the voxels of the segment which overlap a triangle.
+template<typename TIndex, class TCallback>
+static void voxelize(std::span<const Vector3> verts, std::span<const TIndex> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, const TCallback &fOnVoxels)
+{
+	using TFloat = umath::simd::FloatN;
+	constexpr auto width = TFloat::width;
+	float laneOffsets[width];
+	for(uint32_t i = 0; i < width; ++i)
+		laneOffsets[i] = static_cast<float>(i);
+	auto laneOffset = TFloat::Load(laneOffsets);
+	auto half = TFloat::Set(0.5f);
+	auto size = TFloat::Set(voxelSize);
+	auto one = TFloat::Set(1.f);
+	const TFloat gridOrigin[3] = {TFloat::Set(origin.x), TFloat::Set(origin.y), TFloat::Set(origin.z)};
+	for(size_t i = 0; i + 2 < indices.size(); i += 3) {
+		auto &a = verts[indices[i]];
+		auto &b = verts[indices[i + 1]];
+		auto &c = verts[indices[i + 2]];
+		// Voxel range of the triangle bounds, extended by one voxel, since voxels that only touch the triangle count as well
+		Vector3i range[2];
+		auto culled = false;
+		for(uint8_t k = 0; k < 3; ++k) {
+			auto triMin = (umath::min(a[k], b[k], c[k]) - origin[k]) / voxelSize;
+			auto triMax = (umath::max(a[k], b[k], c[k]) - origin[k]) / voxelSize;
+			if(triMax < -1.f || triMin > static_cast<float>(resolution[k]) + 1.f) {
+				culled = true;
+				break;
+			}
+			// Clamped before the conversion, the bounds of large triangles may not be representable as integers
+			triMin = umath::clamp(triMin, -1.f, static_cast<float>(resolution[k]));
+			triMax = umath::clamp(triMax, -1.f, static_cast<float>(resolution[k]));
+			range[0][k] = umath::max(static_cast<int32_t>(std::floor(triMin)) - 1, 0);
+			range[1][k] = umath::min(static_cast<int32_t>(std::floor(triMax)) + 1, resolution[k] - 1);
+		}
+		if(culled)
+			continue;
+		const TFloat tv0[3] = {TFloat::Set(a.x), TFloat::Set(a.y), TFloat::Set(a.z)};
+		const TFloat tv1[3] = {TFloat::Set(b.x), TFloat::Set(b.y), TFloat::Set(b.z)};
+		const TFloat tv2[3] = {TFloat::Set(c.x), TFloat::Set(c.y), TFloat::Set(c.z)};
+		for(auto z = range[0].z; z <= range[1].z; ++z) {
+			auto zMin = origin.z + static_cast<float>(z) * voxelSize;
+			auto zMax = origin.z + static_cast<float>(z + 1) * voxelSize;
+			for(auto y = range[0].y; y <= range[1].y; ++y) {
+				auto yMin = origin.y + static_cast<float>(y) * voxelSize;
+				auto yMax = origin.y + static_cast<float>(y + 1) * voxelSize;
+				// Same box center and extents as aabb_triangle computes for the voxel's bounds
+				TFloat center[3];
+				TFloat extents[3];
+				center[1] = TFloat::Set((yMin + yMax) * 0.5f);
+				extents[1] = TFloat::Set((yMax - yMin) * 0.5f);
+				center[2] = TFloat::Set((zMin + zMax) * 0.5f);
+				extents[2] = TFloat::Set((zMax - zMin) * 0.5f);
+				for(auto x = range[0].x; x <= range[1].x; x += width) {
+					auto xs = TFloat::Set(static_cast<float>(x)) + laneOffset;
+					auto xMin = gridOrigin[0] + xs * size;
+					auto xMax = gridOrigin[0] + (xs + one) * size;
+					center[0] = (xMin + xMax) * half;
+					extents[0] = (xMax - xMin) * half;
+					auto bits = tri_box_overlap(center, extents, tv0, tv1, tv2).GetBits();
+					auto n = static_cast<uint32_t>(umath::min<int32_t>(width, range[1].x - x + 1));
+					bits &= (1u << n) - 1u;
+					if(bits != 0)
+						fOnVoxels(x, y, z, bits);
+				}
+			}
+		}
+	}
+}
+
+template<typename TIndex>
+static void voxelize(std::span<const Vector3> verts, std::span<const TIndex> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, umath::geometry::VoxelGrid &outGrid)
+{
+	outGrid.origin = origin;
+	outGrid.voxelSize = voxelSize;
+	outGrid.resolution = resolution;
+	auto numVoxels = static_cast<size_t>(resolution.x) * resolution.y * resolution.z;
+	outGrid.occupancy.clear();
+	outGrid.occupancy.resize((numVoxels + 63) / 64, 0);
+	voxelize(verts, indices, origin, voxelSize, resolution, [&outGrid](int32_t x, int32_t y, int32_t z, uint32_t bits) {
+		auto baseIdx = outGrid.GetVoxelIndex({x, y, z});
+		for(uint32_t i = 0; bits != 0; ++i, bits >>= 1) {
+			if(bits & 1u)
+				outGrid.occupancy[(baseIdx + i) / 64] |= uint64_t {1} << ((baseIdx + i) % 64);
+		}
+	});
+}
+
+template<typename TIndex>
+static void voxelize(std::span<const Vector3> verts, std::span<const TIndex> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, std::vector<Vector3i> &outVoxels)
+{
+	umath::geometry::VoxelGrid grid {origin, voxelSize, resolution, {}};
+	std::vector<size_t> voxelIndices;
+	voxelize(verts, indices, origin, voxelSize, resolution, [&grid, &voxelIndices](int32_t x, int32_t y, int32_t z, uint32_t bits) {
+		auto baseIdx = grid.GetVoxelIndex({x, y, z});
+		for(uint32_t i = 0; bits != 0; ++i, bits >>= 1) {
+			if(bits & 1u)
+				voxelIndices.push_back(baseIdx + i);
+		}
+	});
+	std::sort(voxelIndices.begin(), voxelIndices.end());
+	voxelIndices.erase(std::unique(voxelIndices.begin(), voxelIndices.end()), voxelIndices.end());
+	outVoxels.clear();
+	outVoxels.reserve(voxelIndices.size());
+	auto sliceSize = static_cast<size_t>(resolution.x) * resolution.y;
+	for(auto idx : voxelIndices)
+		outVoxels.push_back({static_cast<int32_t>(idx % resolution.x), static_cast<int32_t>((idx / resolution.x) % resolution.y), static_cast<int32_t>(idx / sliceSize)});
+}
+
+void umath::geometry::voxelize(std::span<const Vector3> verts, std::span<const uint16_t> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, VoxelGrid &outGrid) { ::voxelize(verts, indices, origin, voxelSize, resolution, outGrid); }
+void umath::geometry::voxelize(std::span<const Vector3> verts, std::span<const uint32_t> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, VoxelGrid &outGrid) { ::voxelize(verts, indices, origin, voxelSize, resolution, outGrid); }
+void umath::geometry::voxelize(std::span<const Vector3> verts, std::span<const uint16_t> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, std::vector<Vector3i> &outVoxels) { ::voxelize(verts, indices, origin, voxelSize, resolution, outVoxels); }
+void umath::geometry::voxelize(std::span<const Vector3> verts, std::span<const uint32_t> indices, const Vector3 &origin, float voxelSize, const Vector3i &resolution, std::vector<Vector3i> &outVoxels) { ::voxelize(verts, indices, origin, voxelSize, resolution, outVoxels); }
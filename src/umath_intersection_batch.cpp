@@ -0,0 +1,217 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/umath_geometry.hpp"
+#include "simd.hpp"
+#include "profile_scope.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace {
+	enum class PlaneForm : uint8_t {
+		Center = 0, // dot(n, p - center), as evaluated by Plane::GetDistance(const Vector3&)
+		Distance    // dot(n, p) - d, as evaluated by the umath::Frustum functions
+	};
+	struct PreparedPlane {
+		float nx, ny, nz;
+		float cx, cy, cz;
+		float d;
+		// Per axis, 1 if the max coordinate of a box is the one closest to the plane (negative normal component), otherwise 0.
+		uint8_t nearIsMax[3];
+	};
+	PreparedPlane prepare_plane(const Vector3 &n, const Vector3 &c, float d) { return {n.x, n.y, n.z, c.x, c.y, c.z, d, static_cast<uint8_t>(n.x < 0), static_cast<uint8_t>(n.y < 0), static_cast<uint8_t>(n.z < 0)}; }
+};
+
+template<class TFloat, PlaneForm TForm>
+static TFloat get_plane_distance(const PreparedPlane &plane, const TFloat &x, const TFloat &y, const TFloat &z)
+{
+	if constexpr(TForm == PlaneForm::Center)
+		return ((x - TFloat::Set(plane.cx)) * TFloat::Set(plane.nx) + (y - TFloat::Set(plane.cy)) * TFloat::Set(plane.ny)) + (z - TFloat::Set(plane.cz)) * TFloat::Set(plane.nz);
+	else
+		return ((x * TFloat::Set(plane.nx) + y * TFloat::Set(plane.ny)) + z * TFloat::Set(plane.nz)) - TFloat::Set(plane.d);
+}
+
+// Vectorized equivalent of method 1 of aabb_in_plane_mesh. The operation order matches the respective
+// scalar version, so the results are identical.
+template<class TFloat, PlaneForm TForm>
+static void aabb_in_plane_mesh_block(const float *const (&bounds)[2][3], std::span<const PreparedPlane> planes, umath::intersection::Intersect *outResults, uint32_t count)
+{
+	const TFloat b[2][3] = {{TFloat::Load(bounds[0][0]), TFloat::Load(bounds[0][1]), TFloat::Load(bounds[0][2])}, {TFloat::Load(bounds[1][0]), TFloat::Load(bounds[1][1]), TFloat::Load(bounds[1][2])}};
+	auto zero = TFloat::Set(0.f);
+	auto outside = zero > zero;
+	auto overlap = outside;
+	constexpr uint32_t allLanes = (1u << TFloat::width) - 1u;
+	for(auto &plane : planes) {
+		auto dNear = get_plane_distance<TFloat, TForm>(plane, b[plane.nearIsMax[0]][0], b[plane.nearIsMax[1]][1], b[plane.nearIsMax[2]][2]);
+		auto dFar = get_plane_distance<TFloat, TForm>(plane, b[1 - plane.nearIsMax[0]][0], b[1 - plane.nearIsMax[1]][1], b[1 - plane.nearIsMax[2]][2]);
+		outside = outside | (dNear > zero);
+		overlap = overlap | (dFar > zero);
+		if(outside.GetBits() == allLanes)
+			break;
+	}
+	auto outsideBits = outside.GetBits();
+	auto overlapBits = overlap.GetBits();
+	for(auto i = decltype(count) {0u}; i < count; ++i) {
+		if(outsideBits & (1u << i))
+			outResults[i] = umath::intersection::Intersect::Outside;
+		else if(overlapBits & (1u << i))
+			outResults[i] = umath::intersection::Intersect::Overlap;
+		else
+			outResults[i] = umath::intersection::Intersect::Inside;
+	}
+}
+
+template<PlaneForm TForm>
+static void aabb_in_plane_mesh_batch(const umath::intersection::AABBSoAView &aabbs, std::span<const PreparedPlane> planes, std::span<umath::intersection::Intersect> outResults)
+{
+	using TFloat = umath::simd::FloatN;
+	assert(outResults.size() >= aabbs.size());
+	auto count = umath::min(aabbs.size(), outResults.size());
+
+	size_t i = 0;
+	for(; i + TFloat::width <= count; i += TFloat::width) {
+		const float *const bounds[2][3] = {{aabbs.minX.data() + i, aabbs.minY.data() + i, aabbs.minZ.data() + i}, {aabbs.maxX.data() + i, aabbs.maxY.data() + i, aabbs.maxZ.data() + i}};
+		aabb_in_plane_mesh_block<TFloat, TForm>(bounds, planes, outResults.data() + i, TFloat::width);
+	}
+	if(i == count)
+		return;
+	// Remaining boxes are copied into a zero-padded block
+	auto numRemaining = static_cast<uint32_t>(count - i);
+	float tmp[2][3][TFloat::width] = {};
+	const std::span<const float> *src[2][3] = {{&aabbs.minX, &aabbs.minY, &aabbs.minZ}, {&aabbs.maxX, &aabbs.maxY, &aabbs.maxZ}};
+	for(uint8_t j = 0; j < 2; ++j) {
+		for(uint8_t k = 0; k < 3; ++k)
+			std::copy(src[j][k]->data() + i, src[j][k]->data() + count, tmp[j][k]);
+	}
+	const float *const bounds[2][3] = {{tmp[0][0], tmp[0][1], tmp[0][2]}, {tmp[1][0], tmp[1][1], tmp[1][2]}};
+	aabb_in_plane_mesh_block<TFloat, TForm>(bounds, planes, outResults.data() + i, numRemaining);
+}
+
+void umath::intersection::aabb_in_plane_mesh(const AABBSoAView &aabbs, const std::vector<Plane> &planes, std::span<Intersect> outResults)
+{
+	MATHUTIL_PROFILE_SCOPE(AabbInPlaneMeshBatch);
+	std::vector<PreparedPlane> preparedPlanes;
+	preparedPlanes.reserve(planes.size());
+	for(auto &plane : planes)
+		preparedPlanes.push_back(prepare_plane(plane.GetNormal(), plane.GetCenterPos(), 0.f));
+	aabb_in_plane_mesh_batch<PlaneForm::Center>(aabbs, preparedPlanes, outResults);
+}
+
+void umath::intersection::aabb_in_plane_mesh(const AABBSoAView &aabbs, const Frustum &frustum, std::span<Intersect> outResults)
+{
+	MATHUTIL_PROFILE_SCOPE(AabbInPlaneMeshBatch);
+	// Padding planes can be skipped here
+	std::array<PreparedPlane, Frustum::PLANE_COUNT> preparedPlanes;
+	for(uint32_t i = 0; i < Frustum::PLANE_COUNT; ++i)
+		preparedPlanes[i] = prepare_plane(Vector3 {frustum.normalX[i], frustum.normalY[i], frustum.normalZ[i]}, Vector3 {}, frustum.distance[i]);
+	aabb_in_plane_mesh_batch<PlaneForm::Distance>(aabbs, preparedPlanes, outResults);
+}
+
+// Vectorized equivalent of line_aabb. The comparisons are evaluated in the same order as in the scalar version, so
+// the results (including the handling of NaNs for lines parallel to a slab) are identical.
+template<class TFloat>
+static void line_aabb_block(const TFloat (&o)[3], const TFloat (&dirInv)[3], const TFloat (&bounds)[2][3], const umath::intersection::LineAABBResults &outResults, size_t offset, uint32_t count)
+{
+	auto zero = TFloat::Set(0.f);
+	TFloat tMin;
+	TFloat tMax;
+	auto miss = zero > zero;
+	for(uint8_t i = 0; i < 3; ++i) {
+		auto negative = dirInv[i] < zero;
+		auto tAxisMin = (select(negative, bounds[1][i], bounds[0][i]) - o[i]) * dirInv[i];
+		auto tAxisMax = (select(negative, bounds[0][i], bounds[1][i]) - o[i]) * dirInv[i];
+		if(i == 0) {
+			tMin = tAxisMin;
+			tMax = tAxisMax;
+			continue;
+		}
+		miss = miss | (tMin > tAxisMax) | (tAxisMin > tMax);
+		tMin = select(tAxisMin > tMin, tAxisMin, tMin);
+		tMax = select(tAxisMax < tMax, tAxisMax, tMax);
+	}
+	auto missBits = miss.GetBits();
+	auto inRangeBits = ((tMax >= zero) & (tMin <= TFloat::Set(1.f))).GetBits();
+	auto hitBits = inRangeBits & ~missBits & ((1u << count) - 1u);
+	if(!outResults.hitMask.empty()) {
+		// Blocks never straddle a word, since the offset is always a multiple of the lane width
+		auto &word = outResults.hitMask[offset / 64];
+		auto shift = offset % 64;
+		word = (word & ~(static_cast<uint64_t>((1u << count) - 1u) << shift)) | (static_cast<uint64_t>(hitBits) << shift);
+	}
+	if(!outResults.results.empty()) {
+		for(auto i = decltype(count) {0u}; i < count; ++i) {
+			auto bit = 1u << i;
+			outResults.results[offset + i] = (missBits & bit) ? umath::intersection::Result::NoIntersection : ((hitBits & bit) ? umath::intersection::Result::Intersect : umath::intersection::Result::OutOfRange);
+		}
+	}
+	float tmp[TFloat::width];
+	if(!outResults.tMin.empty()) {
+		tMin.Store(tmp);
+		std::copy(tmp, tmp + count, outResults.tMin.data() + offset);
+	}
+	if(!outResults.tMax.empty()) {
+		tMax.Store(tmp);
+		std::copy(tmp, tmp + count, outResults.tMax.data() + offset);
+	}
+}
+
+// Loads count (<= lane width) values per source into lanes, remaining lanes are zero
+template<class TFloat, size_t N>
+static void load_lanes(const std::span<const float> *const (&src)[N], size_t offset, uint32_t count, TFloat (&outValues)[N])
+{
+	if(count == TFloat::width) {
+		for(size_t i = 0; i < N; ++i)
+			outValues[i] = TFloat::Load(src[i]->data() + offset);
+		return;
+	}
+	float tmp[TFloat::width] = {};
+	for(size_t i = 0; i < N; ++i) {
+		std::copy(src[i]->data() + offset, src[i]->data() + offset + count, tmp);
+		outValues[i] = TFloat::Load(tmp);
+	}
+}
+
+static void validate_line_aabb_results([[maybe_unused]] const umath::intersection::LineAABBResults &results, [[maybe_unused]] size_t count)
+{
+	assert(results.hitMask.empty() || results.hitMask.size() * 64 >= count);
+	assert(results.results.empty() || results.results.size() >= count);
+	assert(results.tMin.empty() || results.tMin.size() >= count);
+	assert(results.tMax.empty() || results.tMax.size() >= count);
+}
+
+void umath::intersection::line_aabb(const Vector3 &o, const Vector3 &dirInv, const AABBSoAView &aabbs, const LineAABBResults &outResults)
+{
+	MATHUTIL_PROFILE_SCOPE(LineAabbBatch);
+	using TFloat = umath::simd::FloatN;
+	auto count = aabbs.size();
+	validate_line_aabb_results(outResults, count);
+	const TFloat origin[3] = {TFloat::Set(o.x), TFloat::Set(o.y), TFloat::Set(o.z)};
+	const TFloat inv[3] = {TFloat::Set(dirInv.x), TFloat::Set(dirInv.y), TFloat::Set(dirInv.z)};
+	const std::span<const float> *src[6] = {&aabbs.minX, &aabbs.minY, &aabbs.minZ, &aabbs.maxX, &aabbs.maxY, &aabbs.maxZ};
+	for(size_t i = 0; i < count; i += TFloat::width) {
+		auto n = static_cast<uint32_t>(umath::min<size_t>(TFloat::width, count - i));
+		TFloat values[6];
+		load_lanes(src, i, n, values);
+		const TFloat bounds[2][3] = {{values[0], values[1], values[2]}, {values[3], values[4], values[5]}};
+		line_aabb_block(origin, inv, bounds, outResults, i, n);
+	}
+}
+
+void umath::intersection::line_aabb(const LineSoAView &lines, const Vector3 &min, const Vector3 &max, const LineAABBResults &outResults)
+{
+	MATHUTIL_PROFILE_SCOPE(LineAabbBatch);
+	using TFloat = umath::simd::FloatN;
+	auto count = lines.size();
+	validate_line_aabb_results(outResults, count);
+	const TFloat bounds[2][3] = {{TFloat::Set(min.x), TFloat::Set(min.y), TFloat::Set(min.z)}, {TFloat::Set(max.x), TFloat::Set(max.y), TFloat::Set(max.z)}};
+	const std::span<const float> *src[6] = {&lines.originX, &lines.originY, &lines.originZ, &lines.dirInvX, &lines.dirInvY, &lines.dirInvZ};
+	for(size_t i = 0; i < count; i += TFloat::width) {
+		auto n = static_cast<uint32_t>(umath::min<size_t>(TFloat::width, count - i));
+		TFloat values[6];
+		load_lanes(src, i, n, values);
+		const TFloat origin[3] = {values[0], values[1], values[2]};
+		const TFloat inv[3] = {values[3], values[4], values[5]};
+		line_aabb_block(origin, inv, bounds, outResults, i, n);
+	}
+}
@@ -0,0 +1,74 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/umath_geometry.hpp"
+#include "simd.hpp"
+#include "profile_scope.hpp"
+
+// All frustum planes (including the padding planes) are tested at once
+using FrustumFloat = umath::simd::Float8;
+static_assert(FrustumFloat::width == umath::Frustum::PADDED_PLANE_COUNT);
+
+namespace {
+	struct FrustumPlanes {
+		FrustumPlanes(const umath::Frustum &frustum)
+		    : nx {FrustumFloat::Load(frustum.normalX.data())}, ny {FrustumFloat::Load(frustum.normalY.data())}, nz {FrustumFloat::Load(frustum.normalZ.data())}, d {FrustumFloat::Load(frustum.distance.data())}
+		{
+		}
+		FrustumFloat GetDistance(const FrustumFloat &x, const FrustumFloat &y, const FrustumFloat &z) const { return ((x * nx + y * ny) + z * nz) - d; }
+		FrustumFloat GetDistance(const Vector3 &p) const { return GetDistance(FrustumFloat::Set(p.x), FrustumFloat::Set(p.y), FrustumFloat::Set(p.z)); }
+		FrustumFloat nx, ny, nz, d;
+	};
+};
+
+bool umath::intersection::point_in_plane_mesh(const Vector3 &vec, const Frustum &frustum)
+{
+	FrustumPlanes planes {frustum};
+	auto zero = FrustumFloat::Set(0.f);
+	return (planes.GetDistance(vec) > zero).GetBits() == 0;
+}
+
+umath::intersection::Intersect umath::intersection::sphere_in_plane_mesh(const Vector3 &vec, float radius, const Frustum &frustum, bool skipInsideTest)
+{
+	MATHUTIL_PROFILE_SCOPE(SphereInPlaneMesh);
+	FrustumPlanes planes {frustum};
+	auto dist = planes.GetDistance(vec);
+	if((dist > FrustumFloat::Set(0.f)).GetBits() != 0) {
+		if((dist > FrustumFloat::Set(radius)).GetBits() != 0)
+			return Intersect::Outside;
+		return Intersect::Overlap;
+	}
+	if(skipInsideTest == true)
+		return Intersect::Overlap;
+	// The distance to the closest point on a plane is the signed plane distance, so there's no need to actually calculate the point.
+	// Padding planes store a distance of FLT_MAX, so the signed distance of any point to them is -FLT_MAX, which overflows to infinity
+	// when squared here and never counts as an overlap.
+	if((dist * dist < FrustumFloat::Set(radius * radius)).GetBits() != 0)
+		return Intersect::Overlap;
+	return Intersect::Inside;
+}
+
+umath::intersection::Intersect umath::intersection::aabb_in_plane_mesh(const Vector3 &min, const Vector3 &max, const Frustum &frustum)
+{
+	MATHUTIL_PROFILE_SCOPE(AabbInPlaneMesh);
+	// Same approach as method 1 of the std::vector<Plane> version, but for all planes at once
+	FrustumPlanes planes {frustum};
+	auto zero = FrustumFloat::Set(0.f);
+	auto minX = FrustumFloat::Set(min.x);
+	auto minY = FrustumFloat::Set(min.y);
+	auto minZ = FrustumFloat::Set(min.z);
+	auto maxX = FrustumFloat::Set(max.x);
+	auto maxY = FrustumFloat::Set(max.y);
+	auto maxZ = FrustumFloat::Set(max.z);
+	auto negX = planes.nx < zero;
+	auto negY = planes.ny < zero;
+	auto negZ = planes.nz < zero;
+	auto dNear = planes.GetDistance(select(negX, maxX, minX), select(negY, maxY, minY), select(negZ, maxZ, minZ));
+	if((dNear > zero).GetBits() != 0)
+		return Intersect::Outside;
+	auto dFar = planes.GetDistance(select(negX, minX, maxX), select(negY, minY, maxY), select(negZ, minZ, maxZ));
+	if((dFar > zero).GetBits() != 0)
+		return Intersect::Overlap;
+	return Intersect::Inside;
+}
@@ -6,8 +6,10 @@
 #include "mathutil/umath.h"
 #include "mathutil/uvec.h"
 #include "mathutil/eulerangles.h"
+#include "transform_kernels.hpp"
 #include <sharedutils/util_string.h>
 #include <glm/gtx/euler_angles.hpp>
+#include <cassert>
 
 using namespace umath;
 
@@ -35,6 +37,97 @@ Quat uquat::calc_average(const std::vector<Quat> &rotations, const std::vector<f
 	return qAvg;
 }
 
+Quat uquat::calc_average_markley(std::span<const Quat> rotations, std::span<const float> weights)
+{
+	AverageAccumulator accumulator;
+	accumulator.Add(rotations, weights);
+	return accumulator.GetAverage();
+}
+
+void uquat::AverageAccumulator::Add(const Quat &rot, float weight)
+{
+	const double q[4] = {rot.w, rot.x, rot.y, rot.z};
+	auto *m = m_matrix.data();
+	for(uint32_t r = 0; r < 4; ++r) {
+		auto wq = weight * q[r];
+		for(uint32_t c = r; c < 4; ++c)
+			*(m++) += wq * q[c];
+	}
+	m_totalWeight += weight;
+	++m_count;
+}
+
+void uquat::AverageAccumulator::Add(std::span<const Quat> rotations, std::span<const float> weights)
+{
+	assert(weights.empty() || weights.size() == rotations.size());
+	for(size_t i = 0; i < rotations.size(); ++i)
+		Add(rotations[i], weights.empty() ? 1.f : weights[i]);
+}
+
+void uquat::AverageAccumulator::Reset() { *this = {}; }
+
+Quat uquat::AverageAccumulator::GetAverage() const
+{
+	if(m_totalWeight <= 0.0)
+		return identity();
+	double a[4][4];
+	auto *m = m_matrix.data();
+	for(uint32_t r = 0; r < 4; ++r) {
+		for(uint32_t c = r; c < 4; ++c)
+			a[r][c] = a[c][r] = *(m++) / m_totalWeight;
+	}
+	// Cyclic Jacobi eigenvalue algorithm, v accumulates the rotations and ends up with the eigenvectors as columns
+	double v[4][4] = {{1.0, 0.0, 0.0, 0.0}, {0.0, 1.0, 0.0, 0.0}, {0.0, 0.0, 1.0, 0.0}, {0.0, 0.0, 0.0, 1.0}};
+	for(uint32_t sweep = 0; sweep < 32; ++sweep) {
+		auto offDiagonal = 0.0;
+		for(uint32_t p = 0; p < 4; ++p) {
+			for(uint32_t q = p + 1; q < 4; ++q)
+				offDiagonal += a[p][q] * a[p][q];
+		}
+		// The matrix is normalized by the total weight, so its trace is 1
+		if(offDiagonal < 1e-30)
+			break;
+		for(uint32_t p = 0; p < 4; ++p) {
+			for(uint32_t q = p + 1; q < 4; ++q) {
+				if(a[p][q] == 0.0)
+					continue;
+				// Rotation in the p-q plane that eliminates a[p][q]
+				auto theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+				auto t = ((theta < 0.0) ? -1.0 : 1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+				auto c = 1.0 / std::sqrt(t * t + 1.0);
+				auto s = t * c;
+				for(uint32_t k = 0; k < 4; ++k) {
+					auto akp = a[k][p];
+					auto akq = a[k][q];
+					a[k][p] = c * akp - s * akq;
+					a[k][q] = s * akp + c * akq;
+				}
+				for(uint32_t k = 0; k < 4; ++k) {
+					auto apk = a[p][k];
+					auto aqk = a[q][k];
+					a[p][k] = c * apk - s * aqk;
+					a[q][k] = s * apk + c * aqk;
+				}
+				for(uint32_t k = 0; k < 4; ++k) {
+					auto vkp = v[k][p];
+					auto vkq = v[k][q];
+					v[k][p] = c * vkp - s * vkq;
+					v[k][q] = s * vkp + c * vkq;
+				}
+			}
+		}
+	}
+	uint32_t largest = 0;
+	for(uint32_t i = 1; i < 4; ++i) {
+		if(a[i][i] > a[largest][largest])
+			largest = i;
+	}
+	Quat result {static_cast<float>(v[0][largest]), static_cast<float>(v[1][largest]), static_cast<float>(v[2][largest]), static_cast<float>(v[3][largest])};
+	if(result.w < 0.f)
+		result = -result;
+	return get_normal(result);
+}
+
 Quat uquat::clamp_rotation(const Quat &pq, const EulerAngles &minBounds, const EulerAngles &maxBounds)
 {
 	// Source: https://forum.unity.com/threads/how-do-i-clamp-a-quaternion.370041/#post-5494723
@@ -159,12 +252,18 @@ Quat uquat::create(const std::string &s)
 
 bool uquat::cmp(const Quat &a, const Quat &b, float epsilon) { return (glm::abs(a.x - b.x) <= epsilon && glm::abs(a.y - b.y) <= epsilon && glm::abs(a.z - b.z) <= epsilon && glm::abs(a.w - b.w) <= epsilon) ? true : false; }
 
-Vector3 uquat::forward(const Quat &q) { return Vector3(2 * (q.x * q.z + q.w * q.y), 2 * (q.y * q.z - q.w * q.x), 1 - 2 * (q.x * q.x + q.y * q.y)); }
-Vector3 uquat::right(const Quat &q) { return -Vector3(1 - 2 * (q.y * q.y + q.z * q.z), 2 * (q.x * q.y + q.w * q.z), 2 * (q.x * q.z - q.w * q.y)); }
-Vector3 uquat::up(const Quat &q) { return Vector3(2 * (q.x * q.y - q.w * q.z), 1 - 2 * (q.x * q.x + q.z * q.z), 2 * (q.y * q.z + q.w * q.x)); }
+Vector3 uquat::forward(const Quat &q) { return inl::forward(q); }
+Vector3 uquat::right(const Quat &q) { return inl::right(q); }
+Vector3 uquat::up(const Quat &q) { return inl::up(q); }
 
 Quat uquat::slerp(const Quat &q1, const Quat &q2, Float factor) { return glm::slerp(q1, q2, factor); }
 Quat uquat::lerp(const Quat &q1, const Quat &q2, Float factor) { return glm::lerp(q1, q2, factor); }
+Quat uquat::nlerp(const Quat &q1, const Quat &q2, Float factor)
+{
+	auto wb = (dot_product(q1, q2) < 0.f) ? -factor : factor;
+	return glm::normalize(q1 * (1.f - factor) + q2 * wb);
+}
+Quat uquat::slerp_fast(const Quat &q1, const Quat &q2, Float factor) { return nlerp(q1, q2, kernels::slerp_fast_factor(std::abs(dot_product(q1, q2)), factor)); }
 void uquat::get_orientation(const Quat &q, Vector3 *forward, Vector3 *right, Vector3 *up)
 {
 	if(forward != nullptr)
@@ -174,7 +273,7 @@ void uquat::get_orientation(const Quat &q, Vector3 *forward, Vector3 *right, Vec
 	if(up != nullptr)
 		*up = uquat::up(q);
 }
-Float uquat::dot_product(const Quat &q1, const Quat &q2) { return glm::dot(q1, q2); }
+Float uquat::dot_product(const Quat &q1, const Quat &q2) { return inl::dot_product(q1, q2); }
 void uquat::rotate(Quat &q, const EulerAngles &ang)
 {
 	q = glm::rotate(q, ang.r, uvec::RIGHT);
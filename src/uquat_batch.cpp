@@ -0,0 +1,94 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include "mathutil/uquat.h"
+#include "transform_kernels.hpp"
+#include <cassert>
+
+using namespace umath;
+
+namespace {
+	enum class Interpolation : uint8_t { Slerp = 0, SlerpFast, Nlerp, Lerp };
+};
+
+template<Interpolation interp, class TFloat>
+static kernels::QuatLanes<TFloat> interpolate(const kernels::QuatLanes<TFloat> &a, const kernels::QuatLanes<TFloat> &b, TFloat factor)
+{
+	if constexpr(interp == Interpolation::Slerp)
+		return kernels::slerp(a, b, factor);
+	else if constexpr(interp == Interpolation::SlerpFast)
+		return kernels::slerp_fast(a, b, factor);
+	else if constexpr(interp == Interpolation::Nlerp)
+		return kernels::nlerp(a, b, factor);
+	else {
+		// Same as glm::lerp, neither normalized nor along the shortest path
+		auto wa = TFloat::Set(1.f) - factor;
+		return {a.w * wa + b.w * factor, a.x * wa + b.x * factor, a.y * wa + b.y * factor, a.z * wa + b.z * factor};
+	}
+}
+
+// Quat doesn't have a fixed component order (GLM_FORCE_QUAT_DATA_WXYZ), so the components are gathered individually
+template<class TFloat>
+static kernels::QuatLanes<TFloat> load_quats(const Quat *q, uint32_t count)
+{
+	float tmp[4][TFloat::width];
+	for(uint32_t lane = 0; lane < TFloat::width; ++lane) {
+		auto &v = q[umath::min(lane, count - 1)];
+		tmp[0][lane] = v.w;
+		tmp[1][lane] = v.x;
+		tmp[2][lane] = v.y;
+		tmp[3][lane] = v.z;
+	}
+	return {TFloat::Load(tmp[0]), TFloat::Load(tmp[1]), TFloat::Load(tmp[2]), TFloat::Load(tmp[3])};
+}
+
+template<class TFloat>
+static void store_quats(const kernels::QuatLanes<TFloat> &q, Quat *out, uint32_t count)
+{
+	float tmp[4][TFloat::width];
+	q.w.Store(tmp[0]);
+	q.x.Store(tmp[1]);
+	q.y.Store(tmp[2]);
+	q.z.Store(tmp[3]);
+	for(uint32_t lane = 0; lane < count; ++lane)
+		out[lane] = Quat {tmp[0][lane], tmp[1][lane], tmp[2][lane], tmp[3][lane]};
+}
+
+template<Interpolation interp>
+static void interpolate(std::span<const Quat> q1, std::span<const Quat> q2, Float factor, std::span<Quat> out)
+{
+	using TFloat = simd::FloatN;
+	assert(q1.size() == out.size() && q2.size() == out.size());
+	auto f = TFloat::Set(factor);
+	for(size_t i = 0; i < out.size(); i += TFloat::width) {
+		auto count = static_cast<uint32_t>(umath::min<size_t>(TFloat::width, out.size() - i));
+		auto r = interpolate<interp>(load_quats<TFloat>(q1.data() + i, count), load_quats<TFloat>(q2.data() + i, count), f);
+		store_quats(r, out.data() + i, count);
+	}
+}
+
+template<Interpolation interp>
+static void interpolate(const Quat &q1, const Quat &q2, std::span<const Float> factors, std::span<Quat> out)
+{
+	using TFloat = simd::FloatN;
+	assert(factors.size() == out.size());
+	kernels::QuatLanes<TFloat> a {TFloat::Set(q1.w), TFloat::Set(q1.x), TFloat::Set(q1.y), TFloat::Set(q1.z)};
+	kernels::QuatLanes<TFloat> b {TFloat::Set(q2.w), TFloat::Set(q2.x), TFloat::Set(q2.y), TFloat::Set(q2.z)};
+	for(size_t i = 0; i < out.size(); i += TFloat::width) {
+		auto count = static_cast<uint32_t>(umath::min<size_t>(TFloat::width, out.size() - i));
+		float f[TFloat::width];
+		for(uint32_t lane = 0; lane < TFloat::width; ++lane)
+			f[lane] = factors[i + umath::min(lane, count - 1)];
+		store_quats(interpolate<interp>(a, b, TFloat::Load(f)), out.data() + i, count);
+	}
+}
+
+void uquat::slerp(std::span<const Quat> q1, std::span<const Quat> q2, Float factor, std::span<Quat> out) { interpolate<Interpolation::Slerp>(q1, q2, factor, out); }
+void uquat::slerp(const Quat &q1, const Quat &q2, std::span<const Float> factors, std::span<Quat> out) { interpolate<Interpolation::Slerp>(q1, q2, factors, out); }
+void uquat::slerp_fast(std::span<const Quat> q1, std::span<const Quat> q2, Float factor, std::span<Quat> out) { interpolate<Interpolation::SlerpFast>(q1, q2, factor, out); }
+void uquat::slerp_fast(const Quat &q1, const Quat &q2, std::span<const Float> factors, std::span<Quat> out) { interpolate<Interpolation::SlerpFast>(q1, q2, factors, out); }
+void uquat::nlerp(std::span<const Quat> q1, std::span<const Quat> q2, Float factor, std::span<Quat> out) { interpolate<Interpolation::Nlerp>(q1, q2, factor, out); }
+void uquat::nlerp(const Quat &q1, const Quat &q2, std::span<const Float> factors, std::span<Quat> out) { interpolate<Interpolation::Nlerp>(q1, q2, factors, out); }
+void uquat::lerp(std::span<const Quat> q1, std::span<const Quat> q2, Float factor, std::span<Quat> out) { interpolate<Interpolation::Lerp>(q1, q2, factor, out); }
+void uquat::lerp(const Quat &q1, const Quat &q2, std::span<const Float> factors, std::span<Quat> out) { interpolate<Interpolation::Lerp>(q1, q2, factors, out); }
@@ -198,7 +198,7 @@ Quat uvec::to_quaternion(const Vector3 &axis, Float angle)
 
 Float uvec::get_yaw(const Vector3 &v) { return static_cast<Float>(umath::rad_to_deg(atan2f(v.x, v.z))); }
 Float uvec::get_pitch(const Vector3 &v) { return 360.f - static_cast<Float>(umath::rad_to_deg(atan2f(v.y, sqrtf((v.x * v.x) + (v.z * v.z))))); }
-Float uvec::dot(const Vector3 &a, const Vector3 &b) { return glm::dot(a, b); }
+Float uvec::dot(const Vector3 &a, const Vector3 &b) { return inl::dot(a, b); }
 
 void uvec::normalize(Vector3 *x)
 {
@@ -230,7 +230,7 @@ void uvec::rotate(Vector3 *vec, const EulerAngles &ang)
 
 void uvec::rotate(Vector3 *vec, const Quat &rot) { *vec = glm::rotate(rot, *vec); }
 
-Vector3 uvec::cross(const Vector3 &vecA, const Vector3 &vecB) { return glm::cross(vecA, vecB); }
+Vector3 uvec::cross(const Vector3 &vecA, const Vector3 &vecB) { return inl::cross(vecA, vecB); }
 
 Vector3 uvec::lerp(const Vector3 &vecA, const Vector3 &vecB, Float factor) { return vecA + (vecB - vecA) * factor; }
 
@@ -246,7 +246,7 @@ void uvec::rotate_around(Vector3 *vec, const EulerAngles &ang, const Vector3 &ce
 
 Float uvec::length(const Vector3 &vec) { return umath::sqrt(length_sqr(vec)); }
 
-Float uvec::length_sqr(const Vector3 &vec) { return umath::pow2(vec.x) + umath::pow2(vec.y) + umath::pow2(vec.z); }
+Float uvec::length_sqr(const Vector3 &vec) { return inl::length_sqr(vec); }
 
 std::string uvec::to_string(Vector3 *vec)
 {
@@ -439,7 +439,7 @@ Vector3 uvec::calc_average(const std::vector<Vector3> &points)
 	return avg / static_cast<float>(points.size());
 }
 
-Float uvec::distance_sqr(const Vector3 &p0, const Vector3 &p1) { return length_sqr(p1 - p0); }
+Float uvec::distance_sqr(const Vector3 &p0, const Vector3 &p1) { return inl::distance_sqr(p0, p1); }
 
 Float uvec::planar_distance_sqr(const Vector3 &p0, const Vector3 &p1, const Vector3 &n)
 {
@@ -0,0 +1,451 @@
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include "mathutil/boundingvolume.h"
+#include "mathutil/triangle_mesh_bvh.hpp"
+#include "mathutil/spatial_hash_grid.hpp"
+#include "mathutil/umath_geometry.hpp"
+#include "gtest/gtest.h"
+#include "gtest_common.h"
+
+static std::vector<bounding_volume::AABB> generate_test_aabbs(std::mt19937 &rng, size_t count)
+{
+	std::uniform_real_distribution<float> disPos {-100.f, 100.f};
+	std::uniform_real_distribution<float> disExt {0.f, 10.f};
+	std::vector<bounding_volume::AABB> aabbs;
+	aabbs.reserve(count);
+	for(size_t i = 0; i < count; ++i) {
+		Vector3 min {disPos(rng), disPos(rng), disPos(rng)};
+		aabbs.push_back({min, min + Vector3 {disExt(rng), disExt(rng), disExt(rng)}});
+	}
+	return aabbs;
+}
+
+TEST(BVHTests, Structure)
+{
+	std::mt19937 rng {1};
+	auto aabbs = generate_test_aabbs(rng, 2'000);
+	bounding_volume::BVH bvh {aabbs};
+	auto &nodes = bvh.GetNodes();
+	ASSERT_FALSE(nodes.empty());
+	// Every primitive must be referenced by exactly one leaf and be contained in it
+	std::vector<uint32_t> refCounts(aabbs.size(), 0);
+	for(auto &node : nodes) {
+		if(!node.IsLeaf())
+			continue;
+		for(auto i = node.index; i < node.index + node.count; ++i) {
+			auto &prim = bvh.GetPrimitives()[i];
+			ASSERT_TRUE(umath::intersection::aabb_in_aabb(prim.min, prim.max, node.min, node.max));
+			++refCounts[bvh.GetPayloads()[i]];
+		}
+	}
+	for(auto c : refCounts)
+		ASSERT_EQ(c, 1);
+}
+
+TEST(BVHTests, QueriesMatchLinear)
+{
+	std::mt19937 rng {2};
+	auto aabbs = generate_test_aabbs(rng, 3'000);
+	std::vector<uint32_t> payloads(aabbs.size());
+	for(uint32_t i = 0; i < payloads.size(); ++i)
+		payloads[i] = i * 3 + 7;
+	bounding_volume::BVH bvh {aabbs, payloads};
+
+	std::uniform_real_distribution<float> dis {-1.f, 1.f};
+	std::vector<uint32_t> expected;
+	std::vector<uint32_t> actual;
+	for(auto iteration = 0; iteration < 100; ++iteration) {
+		Vector3 origin {dis(rng) * 120.f, dis(rng) * 120.f, dis(rng) * 120.f};
+		Vector3 dir {dis(rng), dis(rng), dis(rng)};
+		auto maxDist = 150.f;
+
+		// Rays
+		std::optional<float> closestT {};
+		expected.clear();
+		for(uint32_t i = 0; i < aabbs.size(); ++i) {
+			float tMin, tMax;
+			if(umath::intersection::line_aabb(origin, dir, aabbs[i].min, aabbs[i].max, &tMin, &tMax) != umath::intersection::Result::Intersect || tMax < 0.f || tMin > maxDist)
+				continue;
+			tMin = umath::max(tMin, 0.f);
+			if(!closestT || tMin < *closestT)
+				closestT = tMin;
+			expected.push_back(payloads[i]);
+		}
+		auto hit = bvh.FindClosestRayHit(origin, dir, maxDist);
+		ASSERT_EQ(hit.has_value(), closestT.has_value());
+		if(hit) {
+			ASSERT_EQ(hit->t, *closestT);
+		}
+
+		std::vector<bounding_volume::BVH::RayHit> hits;
+		bvh.FindRayHits(origin, dir, hits, maxDist);
+		actual.clear();
+		for(auto &h : hits)
+			actual.push_back(h.payload);
+		std::sort(expected.begin(), expected.end());
+		std::sort(actual.begin(), actual.end());
+		ASSERT_EQ(actual, expected);
+
+		// Spheres
+		auto radius = (dis(rng) + 1.f) * 30.f;
+		expected.clear();
+		for(uint32_t i = 0; i < aabbs.size(); ++i) {
+			if(umath::intersection::aabb_sphere(aabbs[i].min, aabbs[i].max, origin, radius))
+				expected.push_back(payloads[i]);
+		}
+		actual.clear();
+		bvh.FindSphereOverlaps(origin, radius, actual);
+		std::sort(actual.begin(), actual.end());
+		ASSERT_EQ(actual, expected);
+
+		// Frustums
+		uvec::normalize(&dir);
+		umath::Frustum frustum {origin, dir, std::abs(dir.y) < 0.9f ? uvec::UP : uvec::RIGHT, static_cast<float>(umath::deg_to_rad(60.0)), 1.f, 200.f, 1.5f};
+		auto planes = frustum.ToPlanes();
+		expected.clear();
+		for(uint32_t i = 0; i < aabbs.size(); ++i) {
+			if(umath::intersection::aabb_in_plane_mesh(aabbs[i].min, aabbs[i].max, planes) != umath::intersection::Intersect::Outside)
+				expected.push_back(payloads[i]);
+		}
+		actual.clear();
+		bvh.FindFrustumOverlaps(planes, actual);
+		std::sort(actual.begin(), actual.end());
+		ASSERT_EQ(actual, expected);
+
+		expected.clear();
+		for(uint32_t i = 0; i < aabbs.size(); ++i) {
+			if(umath::intersection::aabb_in_plane_mesh(aabbs[i].min, aabbs[i].max, frustum) != umath::intersection::Intersect::Outside)
+				expected.push_back(payloads[i]);
+		}
+		actual.clear();
+		bvh.FindFrustumOverlaps(frustum, actual);
+		std::sort(actual.begin(), actual.end());
+		ASSERT_EQ(actual, expected);
+	}
+}
+
+TEST(BVHTests, DegenerateInput)
+{
+	// Identical boxes can't be split spatially
+	std::vector<bounding_volume::AABB> aabbs(100, bounding_volume::AABB {Vector3 {-1.f}, Vector3 {1.f}});
+	bounding_volume::BVH bvh {aabbs};
+	std::vector<uint32_t> payloads;
+	bvh.FindSphereOverlaps(Vector3 {}, 0.5f, payloads);
+	ASSERT_EQ(payloads.size(), aabbs.size());
+	auto hit = bvh.FindClosestRayHit(Vector3 {0.f, 0.f, -10.f}, Vector3 {0.f, 0.f, 1.f});
+	ASSERT_TRUE(hit.has_value());
+	ASSERT_FLOAT_EQ(hit->t, 9.f);
+
+	bounding_volume::BVH empty {};
+	ASSERT_FALSE(empty.FindClosestRayHit(Vector3 {}, Vector3 {1.f, 0.f, 0.f}).has_value());
+}
+
+TEST(DynamicAABBTreeTests, PairsMatchLinear)
+{
+	std::mt19937 rng {3};
+	auto aabbs = generate_test_aabbs(rng, 1'000);
+	bounding_volume::DynamicAABBTree tree {};
+	std::vector<bounding_volume::DynamicAABBTree::ProxyId> proxies;
+	for(uint32_t i = 0; i < aabbs.size(); ++i)
+		proxies.push_back(tree.Insert(aabbs[i], i));
+
+	std::uniform_real_distribution<float> disMove {-2.f, 2.f};
+	std::vector<std::pair<uint32_t, uint32_t>> expected;
+	std::vector<std::pair<uint32_t, uint32_t>> actual;
+	auto validate = [&]() {
+		std::vector<uint32_t> alive;
+		for(uint32_t i = 0; i < proxies.size(); ++i) {
+			if(proxies[i] != bounding_volume::DynamicAABBTree::INVALID_PROXY)
+				alive.push_back(i);
+		}
+		ASSERT_EQ(tree.GetProxyCount(), alive.size());
+		// The tree is balanced with rotations, so its height must stay logarithmic
+		ASSERT_LE(tree.GetHeight(), 2 * static_cast<int32_t>(std::log2(alive.size())) + 2);
+		expected.clear();
+		for(size_t i = 0; i < alive.size(); ++i) {
+			for(size_t j = i + 1; j < alive.size(); ++j) {
+				if(umath::intersection::aabb_aabb(tree.GetFatAABB(proxies[alive[i]]), tree.GetFatAABB(proxies[alive[j]])))
+					expected.push_back({alive[i], alive[j]});
+			}
+		}
+		actual.clear();
+		tree.FindOverlappingPairs(actual);
+		for(auto &pair : actual) {
+			if(pair.first > pair.second)
+				std::swap(pair.first, pair.second);
+		}
+		std::sort(actual.begin(), actual.end());
+		ASSERT_EQ(actual, expected);
+	};
+	validate();
+
+	for(auto frame = 0; frame < 5; ++frame) {
+		for(uint32_t i = 0; i < aabbs.size(); ++i) {
+			if(proxies[i] == bounding_volume::DynamicAABBTree::INVALID_PROXY)
+				continue;
+			Vector3 d {disMove(rng), disMove(rng), disMove(rng)};
+			aabbs[i].min += d;
+			aabbs[i].max += d;
+			tree.Move(proxies[i], aabbs[i], d);
+			ASSERT_TRUE(umath::intersection::aabb_in_aabb(aabbs[i].min, aabbs[i].max, tree.GetFatAABB(proxies[i]).min, tree.GetFatAABB(proxies[i]).max));
+		}
+		// Remove some of the proxies
+		for(uint32_t i = frame; i < aabbs.size(); i += 7) {
+			if(proxies[i] == bounding_volume::DynamicAABBTree::INVALID_PROXY)
+				continue;
+			tree.Remove(proxies[i]);
+			proxies[i] = bounding_volume::DynamicAABBTree::INVALID_PROXY;
+		}
+		validate();
+	}
+
+	std::vector<uint32_t> payloads;
+	tree.Query(bounding_volume::AABB {Vector3 {-1'000.f}, Vector3 {1'000.f}}, payloads);
+	ASSERT_EQ(payloads.size(), tree.GetProxyCount());
+}
+
+TEST(SweepAndPruneTests, PairsMatchLinear)
+{
+	std::mt19937 rng {5};
+	auto aabbs = generate_test_aabbs(rng, 1'000);
+	std::uniform_real_distribution<float> disMove {-2.f, 2.f};
+	std::vector<Vector3> displacements(aabbs.size());
+	bounding_volume::SweepAndPrune sap {};
+	std::vector<bounding_volume::SweepAndPrune::ProxyId> proxies;
+	for(uint32_t i = 0; i < aabbs.size(); ++i)
+		proxies.push_back(sap.Insert(aabbs[i], i));
+
+	auto overlaps = [](const bounding_volume::AABB &a, const bounding_volume::AABB &b) {
+		for(uint8_t i = 0; i < 3; ++i) {
+			if(a.min[i] > b.max[i] || b.min[i] > a.max[i])
+				return false;
+		}
+		return true;
+	};
+	std::vector<std::pair<uint32_t, uint32_t>> expected;
+	std::vector<std::pair<uint32_t, uint32_t>> actual;
+	std::vector<bounding_volume::SweepAndPrune::SweptCollision> collisions;
+	auto validate = [&]() {
+		std::vector<uint32_t> alive;
+		for(uint32_t i = 0; i < proxies.size(); ++i) {
+			if(proxies[i] != bounding_volume::SweepAndPrune::INVALID_PROXY)
+				alive.push_back(i);
+		}
+		ASSERT_EQ(sap.GetProxyCount(), alive.size());
+		expected.clear();
+		size_t numCollisions = 0;
+		for(size_t i = 0; i < alive.size(); ++i) {
+			for(size_t j = i + 1; j < alive.size(); ++j) {
+				if(!overlaps(sap.GetSweptAABB(proxies[alive[i]]), sap.GetSweptAABB(proxies[alive[j]])))
+					continue;
+				expected.push_back({alive[i], alive[j]});
+				auto &a = aabbs[alive[i]];
+				auto &b = aabbs[alive[j]];
+				float entryTime, exitTime;
+				Vector3 normal;
+				if(umath::sweep::aabb_with_aabb(a.GetCenter(), a.GetCenter() + displacements[alive[i]], a.GetExtents(), b.GetCenter(), b.GetCenter() + displacements[alive[j]], b.GetExtents(), &entryTime, &exitTime, &normal))
+					++numCollisions;
+			}
+		}
+		sap.FindOverlappingPairs(actual);
+		for(auto &pair : actual) {
+			if(pair.first > pair.second)
+				std::swap(pair.first, pair.second);
+		}
+		std::sort(actual.begin(), actual.end());
+		ASSERT_EQ(actual, expected);
+
+		sap.FindSweptCollisions(collisions);
+		ASSERT_EQ(collisions.size(), numCollisions);
+		for(auto &col : collisions) {
+			ASSERT_GE(col.entryTime, 0.f);
+			ASSERT_LE(col.entryTime, 1.f);
+		}
+	};
+	validate();
+
+	for(auto frame = 0; frame < 5; ++frame) {
+		for(uint32_t i = 0; i < aabbs.size(); ++i) {
+			if(proxies[i] == bounding_volume::SweepAndPrune::INVALID_PROXY)
+				continue;
+			aabbs[i].min += displacements[i];
+			aabbs[i].max += displacements[i];
+			displacements[i] = {disMove(rng), disMove(rng), disMove(rng)};
+			sap.Update(proxies[i], aabbs[i], displacements[i]);
+		}
+		// Remove some of the proxies and re-insert others
+		for(uint32_t i = frame; i < aabbs.size(); i += 7) {
+			if(proxies[i] == bounding_volume::SweepAndPrune::INVALID_PROXY) {
+				proxies[i] = sap.Insert(aabbs[i], i, displacements[i]);
+				continue;
+			}
+			sap.Remove(proxies[i]);
+			proxies[i] = bounding_volume::SweepAndPrune::INVALID_PROXY;
+		}
+		validate();
+	}
+}
+
+TEST(SweepAndPruneTests, ContinuousCatchesTunneling)
+{
+	bounding_volume::SweepAndPrune sap {};
+	// A fast box passes through a thin wall during the step
+	sap.Insert({Vector3 {-10.f, -1.f, -1.f}, Vector3 {-8.f, 1.f, 1.f}}, 0, Vector3 {20.f, 0.f, 0.f});
+	sap.Insert({Vector3 {0.f, -5.f, -5.f}, Vector3 {0.1f, 5.f, 5.f}}, 1);
+	// Moves in parallel to the wall and never touches it
+	sap.Insert({Vector3 {5.f, -1.f, -1.f}, Vector3 {6.f, 1.f, 1.f}}, 2, Vector3 {0.f, 10.f, 0.f});
+	std::vector<bounding_volume::SweepAndPrune::SweptCollision> collisions;
+	sap.FindSweptCollisions(collisions);
+	ASSERT_EQ(collisions.size(), 1);
+	auto &col = collisions.front();
+	EXPECT_EQ(std::min(col.payloadA, col.payloadB), 0);
+	EXPECT_EQ(std::max(col.payloadA, col.payloadB), 1);
+	EXPECT_NEAR(col.entryTime, 0.4f, 1e-5f);
+	EXPECT_NEAR(std::abs(col.normal.x), 1.f, 1e-5f);
+}
+
+TEST(SpatialHashGridTests, QueriesMatchLinear)
+{
+	std::mt19937 rng {11};
+	std::uniform_real_distribution<float> disPos {-50.f, 50.f};
+	std::uniform_real_distribution<float> disRadius {0.f, 3.f};
+	std::uniform_real_distribution<float> disQueryRadius {0.f, 20.f};
+	constexpr size_t numItems = 2'000;
+	bounding_volume::SpatialHashGrid grid {4.f};
+	std::vector<Vector3> points(numItems);
+	std::vector<float> radii(numItems);
+	std::vector<uint32_t> expected;
+	std::vector<uint32_t> actual;
+	for(auto frame = 0; frame < 3; ++frame) {
+		for(size_t i = 0; i < numItems; ++i) {
+			points[i] = {disPos(rng), disPos(rng), disPos(rng)};
+			radii[i] = disRadius(rng);
+		}
+		grid.Clear();
+		// Points without radius in the first half, spheres in the second one
+		auto half = numItems / 2;
+		grid.Insert(std::span<const Vector3> {points}.subspan(0, half));
+		grid.Insert(std::span<const Vector3> {points}.subspan(half), std::span<const float> {radii}.subspan(half));
+		ASSERT_EQ(grid.GetItemCount(), numItems);
+		auto getRadius = [&](size_t i) { return (i < half) ? 0.f : radii[i]; };
+		auto compare = [&]() {
+			std::sort(actual.begin(), actual.end());
+			ASSERT_EQ(actual, expected);
+		};
+
+		for(auto i = 0; i < 20; ++i) {
+			Vector3 origin {disPos(rng), disPos(rng), disPos(rng)};
+			auto radius = disQueryRadius(rng);
+			expected.clear();
+			for(uint32_t j = 0; j < numItems; ++j) {
+				if(umath::intersection::sphere_sphere(origin, radius, points[j], getRadius(j)))
+					expected.push_back(j);
+			}
+			actual.clear();
+			grid.FindSphereOverlaps(origin, radius, actual);
+			compare();
+
+			Vector3 min {disPos(rng), disPos(rng), disPos(rng)};
+			auto max = min + Vector3 {disQueryRadius(rng), disQueryRadius(rng), disQueryRadius(rng)};
+			expected.clear();
+			for(uint32_t j = 0; j < numItems; ++j) {
+				if(umath::intersection::aabb_sphere(min, max, points[j], getRadius(j)))
+					expected.push_back(j);
+			}
+			actual.clear();
+			grid.FindAABBOverlaps(min, max, actual);
+			compare();
+		}
+	}
+	// Large query ranges iterate over the occupied cells instead
+	actual.clear();
+	grid.FindAABBOverlaps(Vector3 {-1'000.f}, Vector3 {1'000.f}, actual);
+	ASSERT_EQ(actual.size(), numItems);
+}
+
+TEST(TriangleMeshBVHTests, RaycastMatchesLineTriangle)
+{
+	// Noisy height field
+	std::mt19937 rng {4};
+	std::uniform_real_distribution<float> dis {-1.f, 1.f};
+	constexpr uint32_t gridSize = 48;
+	std::vector<Vector3> verts;
+	for(uint32_t y = 0; y < gridSize; ++y) {
+		for(uint32_t x = 0; x < gridSize; ++x)
+			verts.push_back({static_cast<float>(x) + dis(rng) * 0.3f, dis(rng) * 2.f, static_cast<float>(y) + dis(rng) * 0.3f});
+	}
+	std::vector<uint16_t> indices;
+	for(uint32_t y = 0; y < gridSize - 1; ++y) {
+		for(uint32_t x = 0; x < gridSize - 1; ++x) {
+			auto i = static_cast<uint16_t>(y * gridSize + x);
+			indices.insert(indices.end(), {i, static_cast<uint16_t>(i + gridSize), static_cast<uint16_t>(i + 1), static_cast<uint16_t>(i + 1), static_cast<uint16_t>(i + gridSize), static_cast<uint16_t>(i + gridSize + 1)});
+		}
+	}
+	std::vector<uint32_t> indices32 {indices.begin(), indices.end()};
+	bounding_volume::TriangleMeshBVH bvh {verts, indices};
+	bounding_volume::TriangleMeshBVH bvh32 {verts, indices32};
+	ASSERT_EQ(bvh.GetTriangleCount(), indices.size() / 3);
+
+	constexpr uint32_t numRays = 203;
+	std::vector<Vector3> origins;
+	std::vector<Vector3> dirs;
+	for(uint32_t i = 0; i < numRays; ++i) {
+		origins.push_back({(dis(rng) + 1.f) * gridSize * 0.5f, 10.f + dis(rng) * 5.f, (dis(rng) + 1.f) * gridSize * 0.5f});
+		dirs.push_back({dis(rng), -1.f - dis(rng) * 0.5f, dis(rng)});
+	}
+	// Some axis-aligned rays starting exactly on vertex coordinates
+	origins.push_back({10.f, 5.f, 10.f});
+	dirs.push_back({0.f, -1.f, 0.f});
+	std::vector<std::optional<bounding_volume::TriangleMeshBVH::RayHit>> packetHits(origins.size());
+	bvh.Raycast(origins, dirs, packetHits);
+
+	for(uint32_t r = 0; r < origins.size(); ++r) {
+		std::optional<double> closestT {};
+		for(size_t i = 0; i < indices.size(); i += 3) {
+			double t, u, v;
+			if(!umath::intersection::line_triangle(origins[r], dirs[r], verts[indices[i]], verts[indices[i + 1]], verts[indices[i + 2]], t, u, v) || t < 0.0)
+				continue;
+			if(!closestT || t < *closestT)
+				closestT = t;
+		}
+		auto hit = bvh.Raycast(origins[r], dirs[r]);
+		ASSERT_EQ(hit.has_value(), closestT.has_value()) << "Ray " << r;
+		ASSERT_EQ(packetHits[r].has_value(), closestT.has_value()) << "Ray " << r;
+		if(!hit)
+			continue;
+		ASSERT_NEAR(hit->t, *closestT, 1e-4);
+		ASSERT_NEAR(packetHits[r]->t, *closestT, 1e-4);
+
+		// The barycentric coordinates must reproduce the hit point on the reported triangle
+		auto &v0 = verts[indices[hit->triangleIndex * 3]];
+		auto &v1 = verts[indices[hit->triangleIndex * 3 + 1]];
+		auto &v2 = verts[indices[hit->triangleIndex * 3 + 2]];
+		auto p = v0 + (v1 - v0) * hit->u + (v2 - v0) * hit->v;
+		auto pExpected = origins[r] + dirs[r] * hit->t;
+		ASSERT_NEAR(uvec::distance(p, pExpected), 0.f, 1e-3f);
+
+		auto hit32 = bvh32.Raycast(origins[r], dirs[r]);
+		ASSERT_TRUE(hit32.has_value());
+		ASSERT_EQ(hit32->triangleIndex, hit->triangleIndex);
+	}
+}
+
+TEST(BVHTests, ParallelBuildMatchesSerial)
+{
+	// Large enough for parallel binning of the top-level nodes
+	std::mt19937 rng {5};
+	auto aabbs = generate_test_aabbs(rng, 40'000);
+	bounding_volume::BVH serial {aabbs};
+	bounding_volume::BVH parallel {aabbs, {}, bounding_volume::BVH::DEFAULT_MAX_LEAF_SIZE, 4};
+	auto &nodesA = serial.GetNodes();
+	auto &nodesB = parallel.GetNodes();
+	ASSERT_EQ(nodesA.size(), nodesB.size());
+	for(size_t i = 0; i < nodesA.size(); ++i) {
+		ASSERT_EQ(nodesA[i].min, nodesB[i].min);
+		ASSERT_EQ(nodesA[i].max, nodesB[i].max);
+		ASSERT_EQ(nodesA[i].index, nodesB[i].index);
+		ASSERT_EQ(nodesA[i].count, nodesB[i].count);
+	}
+	ASSERT_EQ(serial.GetPayloads(), parallel.GetPayloads());
+}
@@ -0,0 +1,278 @@
+#include <random>
+#include "mathutil/inverse_kinematics/ik.hpp"
+#include "mathutil/inverse_kinematics/ik_batch.hpp"
+#include "gtest/gtest.h"
+#include "gtest_common.h"
+
+// Straight chain along the z-axis with unit length segments
+static void init_chain(uvec::ik::IkSolver &solver, uint32_t numJoints)
+{
+	solver.Resize(numJoints);
+	for(uint32_t i = 0; i < numJoints; ++i)
+		solver.SetLocalTransform(i, umath::ScaledTransform {Vector3 {0.f, 0.f, (i > 0) ? 1.f : 0.f}, uquat::identity(), Vector3 {1.f}});
+}
+
+static umath::ScaledTransform calc_global_transform(uvec::ik::IkSolver &solver, uint32_t index)
+{
+	auto world = solver.GetLocalTransform(index);
+	for(int32_t i = static_cast<int32_t>(index) - 1; i >= 0; --i)
+		world = solver.GetLocalTransform(i) * world;
+	return world;
+}
+
+static void expect_near(const umath::ScaledTransform &a, const umath::ScaledTransform &b, float epsilon)
+{
+	for(uint8_t i = 0; i < 3; ++i)
+		ASSERT_NEAR(a.GetOrigin()[i], b.GetOrigin()[i], epsilon);
+	ASSERT_NEAR(std::abs(uquat::dot_product(a.GetRotation(), b.GetRotation())), 1.f, epsilon);
+}
+
+TEST(IkTests, CachedGlobalTransforms)
+{
+	std::mt19937 rng {21};
+	std::uniform_real_distribution<float> dis {-1.f, 1.f};
+	constexpr uint32_t numJoints = 16;
+	uvec::ik::CCDSolver solver {};
+	init_chain(solver, numJoints);
+	auto validate = [&]() {
+		auto globals = solver.GetGlobalTransforms();
+		ASSERT_EQ(globals.size(), numJoints);
+		for(uint32_t i = 0; i < numJoints; ++i)
+			expect_near(globals[i], calc_global_transform(solver, i), 1e-4f);
+	};
+	validate();
+	auto randomRotation = [&]() { return uquat::create(uvec::get_normal(Vector3 {dis(rng), dis(rng), dis(rng)}), dis(rng)); };
+	for(auto i = 0; i < 20; ++i) {
+		auto idx = static_cast<uint32_t>((dis(rng) * 0.5f + 0.5f) * (numJoints - 1));
+		// Modifications through all of the accessors have to invalidate the cache
+		switch(i % 3) {
+		case 0:
+			solver.GetJointPose(idx).SetRotation(randomRotation());
+			break;
+		case 1:
+			solver.GetJoint(idx).GetPose().SetRotation(randomRotation());
+			break;
+		default:
+			{
+				auto pose = solver.GetLocalTransform(idx);
+				pose.SetRotation(randomRotation());
+				solver.SetLocalTransform(idx, pose);
+				break;
+			}
+		}
+		// Query a transform in front of the modified joint first, which must not validate the rest of the chain
+		if(idx > 0)
+			solver.GetCachedGlobalTransform(idx - 1);
+		validate();
+	}
+}
+
+TEST(IkTests, SolversReachTarget)
+{
+	constexpr uint32_t numJoints = 32;
+	umath::ScaledTransform target {Vector3 {10.f, 5.f, 20.f}, uquat::identity(), Vector3 {1.f}};
+	uvec::ik::CCDSolver ccd {};
+	init_chain(ccd, numJoints);
+	ccd.SetNumSteps(50);
+	ccd.SetThreshold(0.01f);
+	EXPECT_TRUE(ccd.Solve(target));
+	EXPECT_LT(uvec::distance(calc_global_transform(ccd, numJoints - 1).GetOrigin(), target.GetOrigin()), 0.01f);
+
+	uvec::ik::FABRIKSolver fabrik {};
+	init_chain(fabrik, numJoints);
+	fabrik.SetNumSteps(50);
+	fabrik.SetThreshold(0.01f);
+	EXPECT_TRUE(fabrik.Solve(target));
+	EXPECT_LT(uvec::distance(calc_global_transform(fabrik, numJoints - 1).GetOrigin(), target.GetOrigin()), 0.01f);
+}
+
+TEST(IkTests, BatchMatchesSolvers)
+{
+	std::mt19937 rng {8};
+	std::uniform_real_distribution<float> disTarget {-6.f, 6.f};
+	std::uniform_real_distribution<float> disRot {-0.3f, 0.3f};
+	constexpr uint32_t numChains = 64;
+	constexpr uint32_t numJoints = 8;
+	uvec::ik::IkBatchSolver batch {1};
+	uvec::ik::IkBatchSolver batchParallel {4};
+	std::vector<std::unique_ptr<uvec::ik::IkSolver>> solvers;
+	for(uint32_t c = 0; c < numChains; ++c) {
+		uvec::ik::IkBatchSolver::ChainSettings settings {};
+		settings.algorithm = (c % 2 == 0) ? uvec::ik::IkBatchSolver::Algorithm::CCD : uvec::ik::IkBatchSolver::Algorithm::FABRIK;
+		settings.numSteps = 10;
+		settings.threshold = 0.001f;
+		std::unique_ptr<uvec::ik::IkSolver> solver;
+		if(settings.algorithm == uvec::ik::IkBatchSolver::Algorithm::CCD) {
+			auto ccd = std::make_unique<uvec::ik::CCDSolver>();
+			ccd->SetNumSteps(settings.numSteps);
+			ccd->SetThreshold(settings.threshold);
+			solver = std::move(ccd);
+		}
+		else {
+			auto fabrik = std::make_unique<uvec::ik::FABRIKSolver>();
+			fabrik->SetNumSteps(settings.numSteps);
+			fabrik->SetThreshold(settings.threshold);
+			solver = std::move(fabrik);
+		}
+		init_chain(*solver, numJoints);
+		for(uint32_t i = 0; i < numJoints; ++i)
+			solver->GetJointPose(i).SetRotation(uquat::create(EulerAngles {disRot(rng) * 90.f, disRot(rng) * 90.f, 0.f}));
+		// Half of the chains have ball socket limits, a quarter additionally has twist limits
+		std::vector<uvec::ik::IkBatchSolver::JointConstraint> constraints;
+		if(c % 4 < 2) {
+			for(uint32_t i = 1; i < numJoints; i += 2) {
+				solver->GetJoint(i).AddConstraint<uvec::ik::IkBallSocketConstraint>(30.f);
+				constraints.push_back({i, uvec::ik::IkBallSocketParams {30.f}});
+			}
+		}
+		if(c % 4 == 0) {
+			for(uint32_t i = 0; i < numJoints; i += 2) {
+				solver->GetJoint(i).AddConstraint<uvec::ik::IkTwistLimitConstraint>(Vector3 {0.f, 0.f, 1.f}, 10.f);
+				constraints.push_back({i, uvec::ik::IkTwistLimitParams {Vector3 {0.f, 0.f, 1.f}, 10.f}});
+			}
+		}
+		std::vector<umath::ScaledTransform> poses;
+		for(uint32_t i = 0; i < numJoints; ++i)
+			poses.push_back(solver->GetLocalTransform(i));
+		Vector3 target {disTarget(rng), disTarget(rng), disTarget(rng) + 4.f};
+		for(auto *b : {&batch, &batchParallel}) {
+			auto chainId = b->AddChain(poses, constraints, settings);
+			b->SetTarget(chainId, target);
+		}
+		solver->Solve(umath::ScaledTransform {target, uquat::identity(), Vector3 {1.f}});
+		solvers.push_back(std::move(solver));
+	}
+	auto numSolved = batch.Solve();
+	EXPECT_EQ(batchParallel.Solve(), numSolved);
+	EXPECT_GT(numSolved, 0);
+	for(uint32_t c = 0; c < numChains; ++c) {
+		for(uint32_t i = 0; i < numJoints; ++i) {
+			auto pose = batch.GetLocalPose(c, i);
+			auto posePar = batchParallel.GetLocalPose(c, i);
+			// The results must not depend on the thread count
+			ASSERT_EQ(pose.GetRotation(), posePar.GetRotation());
+			expect_near(pose, solvers[c]->GetLocalTransform(i), 1e-3f);
+		}
+	}
+}
+
+TEST(IkTests, TwistLimit)
+{
+	uvec::ik::CCDSolver solver {};
+	init_chain(solver, 3);
+	auto &constraint = solver.GetJoint(1).AddConstraint<uvec::ik::IkTwistLimitConstraint>(Vector3 {0.f, 0.f, 1.f}, 20.f);
+	auto swing = uquat::create(Vector3 {1.f, 0.f, 0.f}, static_cast<float>(umath::deg_to_rad(30.f)));
+	auto rot = swing * uquat::create(Vector3 {0.f, 0.f, 1.f}, static_cast<float>(umath::deg_to_rad(-70.f)));
+	solver.GetJointPose(1).SetRotation(rot);
+	ASSERT_EQ(solver.GetConstraintData().size(), 1);
+	solver.ApplyConstraints();
+	auto expected = swing * uquat::create(Vector3 {0.f, 0.f, 1.f}, static_cast<float>(umath::deg_to_rad(-20.f)));
+	EXPECT_NEAR(std::abs(uquat::dot_product(solver.GetLocalTransform(1).GetRotation(), expected)), 1.f, 1e-5f);
+
+	// Changes through the front-end have to be picked up
+	constraint.SetLimit(80.f);
+	solver.GetJointPose(1).SetRotation(rot);
+	solver.ApplyConstraints();
+	EXPECT_NEAR(std::abs(uquat::dot_product(solver.GetLocalTransform(1).GetRotation(), rot)), 1.f, 1e-5f);
+}
+
+TEST(IkTests, DLSSolverMultipleEffectors)
+{
+	constexpr uint32_t numJoints = 8;
+	uvec::ik::DLSSolver solver {};
+	init_chain(solver, numJoints);
+	// Bent start pose, a fully stretched chain is a singular configuration
+	for(uint32_t i = 1; i < numJoints; ++i)
+		solver.GetJointPose(i).SetRotation(uquat::create(Vector3 {1.f, 0.f, 0.f}, 0.2f));
+	solver.SetNumSteps(100);
+	solver.SetThreshold(0.001f);
+	solver.SetAngleThreshold(0.1f);
+
+	// Position target for the middle joint and position + rotation target for the end of the chain
+	std::array<uvec::ik::IkEffector, 2> effectors {};
+	effectors[0].jointIndex = 3;
+	effectors[0].target = umath::ScaledTransform {Vector3 {1.f, 0.5f, 2.5f}, uquat::identity(), Vector3 {1.f}};
+	effectors[1].jointIndex = numJoints - 1;
+	effectors[1].target = umath::ScaledTransform {Vector3 {3.f, 1.f, 5.f}, uquat::create(Vector3 {0.f, 1.f, 0.f}, 1.f), Vector3 {1.f}};
+	effectors[1].rotationWeight = 1.f;
+	EXPECT_TRUE(solver.Solve(effectors));
+	for(auto &effector : effectors)
+		EXPECT_LT(uvec::distance(calc_global_transform(solver, effector.jointIndex).GetOrigin(), effector.target.GetOrigin()), 0.001f);
+	EXPECT_NEAR(std::abs(uquat::dot_product(calc_global_transform(solver, numJoints - 1).GetRotation(), effectors[1].target.GetRotation())), 1.f, 1e-5f);
+}
+
+TEST(IkTests, SolveStatsAndWarmStart)
+{
+	constexpr uint32_t numJoints = 16;
+	umath::ScaledTransform target {Vector3 {4.f, 2.f, 8.f}, uquat::identity(), Vector3 {1.f}};
+	uvec::ik::CCDSolver ccd {};
+	uvec::ik::FABRIKSolver fabrik {};
+	for(auto *solver : std::initializer_list<uvec::ik::IkSolver *> {&ccd, &fabrik}) {
+		ccd.SetNumSteps(100);
+		ccd.SetThreshold(0.001f);
+		fabrik.SetNumSteps(100);
+		fabrik.SetThreshold(0.001f);
+		init_chain(*solver, numJoints);
+		solver->SetWarmStartEnabled(true, 0.5f);
+		auto stats = solver->SolveWithStats(target);
+		EXPECT_TRUE(stats.solved);
+		EXPECT_FALSE(stats.warmStarted);
+		EXPECT_GT(stats.iterations, 0);
+		EXPECT_LT(stats.residual, 0.001f);
+
+		// Starting from the original pose again, the cached solution has to be used for a nearby target
+		init_chain(*solver, numJoints);
+		solver->ClearWarmStartCache();
+		auto first = solver->SolveWithStats(target);
+		init_chain(*solver, numJoints);
+		auto nearTarget = target;
+		nearTarget.SetOrigin(target.GetOrigin() + Vector3 {0.f, 0.f, 0.0005f});
+		auto warm = solver->SolveWithStats(nearTarget);
+		EXPECT_TRUE(warm.warmStarted);
+		EXPECT_TRUE(warm.solved);
+		EXPECT_LT(warm.iterations, first.iterations);
+
+		// Unreachable target, the residual stops improving long before the iteration budget is used up
+		init_chain(*solver, numJoints);
+		solver->SetWarmStartEnabled(false);
+		solver->SetStallEpsilon(0.0001f);
+		ccd.SetNumSteps(1000);
+		fabrik.SetNumSteps(1000);
+		auto stalled = solver->SolveWithStats(umath::ScaledTransform {Vector3 {0.f, 100.f, 0.f}, uquat::identity(), Vector3 {1.f}});
+		EXPECT_FALSE(stalled.solved);
+		EXPECT_LT(stalled.iterations, 1000);
+		EXPECT_NEAR(stalled.residual, 100.f - (numJoints - 1), 0.01f);
+		EXPECT_EQ(solver->GetLastSolveStats().iterations, stalled.iterations);
+	}
+}
+
+TEST(IkTests, SolveStatsWithoutBeginEndSolve)
+{
+	// Only records statistics if requested
+	class CustomSolver : public uvec::ik::IkSolver {
+	  public:
+		virtual bool Solve(const umath::ScaledTransform &target) override
+		{
+			if(!recordStats)
+				return true;
+			BeginSolve(target.GetOrigin());
+			return EndSolve(5, 0.5f, false);
+		}
+		bool recordStats = true;
+	};
+	CustomSolver solver {};
+	init_chain(solver, 4);
+	umath::ScaledTransform target {Vector3 {0.f, 0.f, 3.f}, uquat::identity(), Vector3 {1.f}};
+	auto stats = solver.SolveWithStats(target);
+	EXPECT_FALSE(stats.solved);
+	EXPECT_EQ(stats.iterations, 5u);
+
+	// The statistics of the previous solve must not be reported
+	solver.recordStats = false;
+	stats = solver.SolveWithStats(target);
+	EXPECT_TRUE(stats.solved);
+	EXPECT_EQ(stats.iterations, 0u);
+	EXPECT_EQ(stats.residual, 0.f);
+	EXPECT_EQ(stats.duration.count(), 0);
+	EXPECT_EQ(solver.GetLastSolveStats().iterations, 0u);
+}
@@ -0,0 +1,339 @@
+#include <random>
+#include "mathutil/umath_geometry.hpp"
+#include "gtest/gtest.h"
+#include "gtest_common.h"
+
+static std::vector<umath::Plane> generate_test_planes(std::mt19937 &rng)
+{
+	std::uniform_real_distribution<float> dis {-1.f, 1.f};
+	std::vector<umath::Plane> planes;
+	for(auto i = 0; i < 6; ++i) {
+		Vector3 n {dis(rng), dis(rng), dis(rng)};
+		uvec::normalize(&n);
+		planes.push_back(umath::Plane {n, static_cast<double>(dis(rng) * 50.f + 20.f)});
+	}
+	return planes;
+}
+
+TEST(IntersectionTests, AabbInPlaneMeshBatch_MatchesScalar)
+{
+	std::mt19937 rng {1337};
+	std::uniform_real_distribution<float> disPos {-100.f, 100.f};
+	std::uniform_real_distribution<float> disExt {0.f, 20.f};
+	constexpr size_t numBoxes = 1'003; // Not a multiple of the lane width, to test the tail
+	std::vector<float> bounds[6];
+	for(auto &v : bounds)
+		v.resize(numBoxes);
+	for(size_t i = 0; i < numBoxes; ++i) {
+		for(uint8_t j = 0; j < 3; ++j) {
+			auto v = disPos(rng);
+			bounds[j][i] = v;
+			bounds[j + 3][i] = v + disExt(rng);
+		}
+	}
+	umath::intersection::AABBSoAView view {bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5]};
+	std::vector<umath::intersection::Intersect> results(numBoxes);
+	for(auto iteration = 0; iteration < 8; ++iteration) {
+		auto planes = generate_test_planes(rng);
+		umath::intersection::aabb_in_plane_mesh(view, planes, results);
+		for(size_t i = 0; i < numBoxes; ++i) {
+			Vector3 min {bounds[0][i], bounds[1][i], bounds[2][i]};
+			Vector3 max {bounds[3][i], bounds[4][i], bounds[5][i]};
+			ASSERT_EQ(results[i], umath::intersection::aabb_in_plane_mesh(min, max, planes)) << "Box " << i;
+		}
+	}
+}
+
+TEST(IntersectionTests, Frustum_MatchesPlaneMesh)
+{
+	std::mt19937 rng {42};
+	std::uniform_real_distribution<float> disPos {-100.f, 100.f};
+	std::uniform_real_distribution<float> disExt {0.f, 20.f};
+	for(auto iteration = 0; iteration < 8; ++iteration) {
+		auto planes = generate_test_planes(rng);
+		umath::Frustum frustum {planes};
+		for(auto i = 0; i < 1'000; ++i) {
+			Vector3 min {disPos(rng), disPos(rng), disPos(rng)};
+			Vector3 max = min + Vector3 {disExt(rng), disExt(rng), disExt(rng)};
+			auto r = disExt(rng);
+			ASSERT_EQ(umath::intersection::point_in_plane_mesh(min, frustum), umath::intersection::point_in_plane_mesh(min, planes));
+			ASSERT_EQ(umath::intersection::sphere_in_plane_mesh(min, r, frustum), umath::intersection::sphere_in_plane_mesh(min, r, planes));
+			ASSERT_EQ(umath::intersection::aabb_in_plane_mesh(min, max, frustum), umath::intersection::aabb_in_plane_mesh(min, max, planes));
+		}
+	}
+}
+
+TEST(IntersectionTests, Frustum_FromViewProjection)
+{
+	auto p = glm::perspective(static_cast<float>(umath::deg_to_rad(90.0)), 1.f, 1.f, 100.f);
+	auto v = glm::lookAt(Vector3 {0.f, 0.f, 0.f}, Vector3 {0.f, 0.f, -1.f}, Vector3 {0.f, 1.f, 0.f});
+	umath::Frustum frustum {p * v};
+	ASSERT_TRUE(umath::intersection::point_in_plane_mesh(Vector3 {0.f, 0.f, -50.f}, frustum));
+	ASSERT_TRUE(umath::intersection::point_in_plane_mesh(Vector3 {40.f, 0.f, -50.f}, frustum));
+	ASSERT_FALSE(umath::intersection::point_in_plane_mesh(Vector3 {60.f, 0.f, -50.f}, frustum));
+	ASSERT_FALSE(umath::intersection::point_in_plane_mesh(Vector3 {0.f, 0.f, 50.f}, frustum));
+	ASSERT_FALSE(umath::intersection::point_in_plane_mesh(Vector3 {0.f, 0.f, -0.5f}, frustum));
+	ASSERT_FALSE(umath::intersection::point_in_plane_mesh(Vector3 {0.f, 0.f, -150.f}, frustum));
+	ASSERT_EQ(umath::intersection::aabb_in_plane_mesh(Vector3 {-1.f, -1.f, -51.f}, Vector3 {1.f, 1.f, -49.f}, frustum), umath::intersection::Intersect::Inside);
+	ASSERT_EQ(umath::intersection::aabb_in_plane_mesh(Vector3 {-1.f, -1.f, -101.f}, Vector3 {1.f, 1.f, -99.f}, frustum), umath::intersection::Intersect::Overlap);
+	ASSERT_EQ(umath::intersection::sphere_in_plane_mesh(Vector3 {0.f, 0.f, -50.f}, 1.f, frustum), umath::intersection::Intersect::Inside);
+}
+
+TEST(IntersectionTests, AabbInPlaneMeshBatch_Frustum)
+{
+	std::mt19937 rng {7};
+	std::uniform_real_distribution<float> disPos {-100.f, 100.f};
+	std::uniform_real_distribution<float> disExt {0.f, 20.f};
+	constexpr size_t numBoxes = 517;
+	std::vector<float> bounds[6];
+	for(auto &v : bounds)
+		v.resize(numBoxes);
+	for(size_t i = 0; i < numBoxes; ++i) {
+		for(uint8_t j = 0; j < 3; ++j) {
+			auto v = disPos(rng);
+			bounds[j][i] = v;
+			bounds[j + 3][i] = v + disExt(rng);
+		}
+	}
+	umath::Frustum frustum {generate_test_planes(rng)};
+	std::vector<umath::intersection::Intersect> results(numBoxes);
+	umath::intersection::aabb_in_plane_mesh(umath::intersection::AABBSoAView {bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5]}, frustum, results);
+	for(size_t i = 0; i < numBoxes; ++i)
+		ASSERT_EQ(results[i], umath::intersection::aabb_in_plane_mesh(Vector3 {bounds[0][i], bounds[1][i], bounds[2][i]}, Vector3 {bounds[3][i], bounds[4][i], bounds[5][i]}, frustum)) << "Box " << i;
+}
+
+static std::vector<Vector3> generate_test_triangles(std::mt19937 &rng, size_t numTris, float extent, float triSize)
+{
+	std::uniform_real_distribution<float> disPos {-extent, extent};
+	std::uniform_real_distribution<float> disOffset {-triSize, triSize};
+	std::vector<Vector3> verts;
+	verts.reserve(numTris * 3);
+	for(size_t i = 0; i < numTris; ++i) {
+		Vector3 p {disPos(rng), disPos(rng), disPos(rng)};
+		for(uint8_t j = 0; j < 3; ++j)
+			verts.push_back(p + Vector3 {disOffset(rng), disOffset(rng), disOffset(rng)});
+	}
+	return verts;
+}
+
+TEST(IntersectionTests, AabbTriangleBatch_MatchesScalar)
+{
+	std::mt19937 rng {4242};
+	std::uniform_real_distribution<float> disPos {-20.f, 20.f};
+	std::uniform_real_distribution<float> disExt {0.f, 8.f};
+	constexpr size_t numBoxes = 1'003;
+	std::vector<float> bounds[6];
+	for(auto &v : bounds)
+		v.resize(numBoxes);
+	for(size_t i = 0; i < numBoxes; ++i) {
+		for(uint8_t j = 0; j < 3; ++j) {
+			auto v = disPos(rng);
+			bounds[j][i] = v;
+			bounds[j + 3][i] = v + disExt(rng);
+		}
+	}
+	umath::intersection::AABBSoAView view {bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5]};
+	auto verts = generate_test_triangles(rng, 501, 20.f, 6.f);
+	std::vector<uint32_t> indices(verts.size());
+	for(size_t i = 0; i < indices.size(); ++i)
+		indices[i] = static_cast<uint32_t>(i);
+	auto numTris = indices.size() / 3;
+	auto results = std::make_unique<bool[]>(umath::max(numBoxes, numTris));
+	size_t numHits = 0;
+	for(size_t t = 0; t < 16; ++t) {
+		auto &a = verts[t * 3];
+		auto &b = verts[t * 3 + 1];
+		auto &c = verts[t * 3 + 2];
+		umath::intersection::aabb_triangle(view, a, b, c, std::span<bool> {results.get(), numBoxes});
+		for(size_t i = 0; i < numBoxes; ++i) {
+			Vector3 min {bounds[0][i], bounds[1][i], bounds[2][i]};
+			Vector3 max {bounds[3][i], bounds[4][i], bounds[5][i]};
+			ASSERT_EQ(results[i], umath::intersection::aabb_triangle(min, max, a, b, c)) << "Triangle " << t << ", box " << i;
+			numHits += results[i] ? 1 : 0;
+		}
+	}
+	for(size_t i = 0; i < 16; ++i) {
+		Vector3 min {bounds[0][i], bounds[1][i], bounds[2][i]};
+		Vector3 max {bounds[3][i], bounds[4][i], bounds[5][i]};
+		umath::intersection::aabb_triangle(min, max, verts, indices, std::span<bool> {results.get(), numTris});
+		for(size_t t = 0; t < numTris; ++t) {
+			ASSERT_EQ(results[t], umath::intersection::aabb_triangle(min, max, verts[t * 3], verts[t * 3 + 1], verts[t * 3 + 2])) << "Box " << i << ", triangle " << t;
+			numHits += results[t] ? 1 : 0;
+		}
+	}
+	EXPECT_GT(numHits, 0);
+}
+
+TEST(IntersectionTests, Voxelize_MatchesScalar)
+{
+	std::mt19937 rng {777};
+	auto verts = generate_test_triangles(rng, 40, 4.f, 2.f);
+	// Axis-aligned quad on voxel boundaries, which touches the voxels on both sides
+	for(auto &v : {Vector3 {-2.f, -2.f, 1.f}, Vector3 {2.f, -2.f, 1.f}, Vector3 {2.f, 2.f, 1.f}, Vector3 {-2.f, 2.f, 1.f}})
+		verts.push_back(v);
+	std::vector<uint16_t> indices;
+	for(size_t i = 0; i < verts.size() - 4; ++i)
+		indices.push_back(static_cast<uint16_t>(i));
+	auto quadStart = static_cast<uint16_t>(verts.size() - 4);
+	for(uint16_t i : {0, 1, 2, 0, 2, 3})
+		indices.push_back(quadStart + i);
+
+	Vector3 origin {-5.f, -5.f, -5.f};
+	constexpr float voxelSize = 0.5f;
+	Vector3i resolution {19, 20, 21};
+	umath::geometry::VoxelGrid grid;
+	umath::geometry::voxelize(verts, indices, origin, voxelSize, resolution, grid);
+	std::vector<Vector3i> sparse;
+	umath::geometry::voxelize(verts, indices, origin, voxelSize, resolution, sparse);
+
+	std::vector<Vector3i> expected;
+	for(int32_t z = 0; z < resolution.z; ++z) {
+		for(int32_t y = 0; y < resolution.y; ++y) {
+			for(int32_t x = 0; x < resolution.x; ++x) {
+				Vector3i voxel {x, y, z};
+				auto min = origin + Vector3 {static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)} * voxelSize;
+				auto max = origin + Vector3 {static_cast<float>(x + 1), static_cast<float>(y + 1), static_cast<float>(z + 1)} * voxelSize;
+				auto occupied = false;
+				for(size_t i = 0; i < indices.size() && !occupied; i += 3)
+					occupied = umath::intersection::aabb_triangle(min, max, verts[indices[i]], verts[indices[i + 1]], verts[indices[i + 2]]);
+				ASSERT_EQ(grid.IsOccupied(voxel), occupied) << "Voxel " << x << "," << y << "," << z;
+				if(occupied)
+					expected.push_back(voxel);
+			}
+		}
+	}
+	EXPECT_FALSE(expected.empty());
+	EXPECT_EQ(sparse, expected);
+}
+
+TEST(IntersectionTests, LineAabbBatch_MatchesScalar)
+{
+	std::mt19937 rng {99};
+	std::uniform_real_distribution<float> disPos {-20.f, 20.f};
+	std::uniform_real_distribution<float> disExt {0.f, 10.f};
+	std::uniform_int_distribution<int> disAxis {0, 5};
+	constexpr size_t count = 1'003;
+	std::vector<float> bounds[6];
+	std::vector<float> lines[6];
+	std::vector<Vector3> dirs(count);
+	for(size_t i = 0; i < 6; ++i) {
+		bounds[i].resize(count);
+		lines[i].resize(count);
+	}
+	for(size_t i = 0; i < count; ++i) {
+		Vector3 d {disPos(rng), disPos(rng), disPos(rng)};
+		// Some of the lines are parallel to one of the slabs
+		auto axis = disAxis(rng);
+		if(axis < 3)
+			d[axis] = 0.f;
+		dirs[i] = d;
+		for(uint8_t j = 0; j < 3; ++j) {
+			auto v = disPos(rng);
+			bounds[j][i] = v;
+			bounds[j + 3][i] = v + disExt(rng);
+			lines[j][i] = disPos(rng);
+			lines[j + 3][i] = 1.f / d[j];
+		}
+	}
+	std::vector<uint64_t> hitMask((count + 63) / 64);
+	std::vector<umath::intersection::Result> results(count);
+	std::vector<float> tMin(count);
+	std::vector<float> tMax(count);
+	umath::intersection::LineAABBResults out {hitMask, results, tMin, tMax};
+	auto validate = [&](size_t i, const Vector3 &o, const Vector3 &d, const Vector3 &min, const Vector3 &max) {
+		float tMinExpected, tMaxExpected;
+		auto res = umath::intersection::line_aabb(o, d, min, max, &tMinExpected, &tMaxExpected);
+		auto hit = (hitMask[i / 64] & (uint64_t {1} << (i % 64))) != 0;
+		if(res == umath::intersection::Result::NoIntersection) {
+			ASSERT_EQ(results[i], umath::intersection::Result::NoIntersection) << i;
+			ASSERT_FALSE(hit) << i;
+			return;
+		}
+		ASSERT_EQ(tMin[i], tMinExpected) << i;
+		ASSERT_EQ(tMax[i], tMaxExpected) << i;
+		auto inRange = tMaxExpected >= 0.f && tMinExpected <= 1.f;
+		ASSERT_EQ(results[i], inRange ? umath::intersection::Result::Intersect : umath::intersection::Result::OutOfRange) << i;
+		ASSERT_EQ(hit, inRange) << i;
+	};
+
+	umath::intersection::AABBSoAView aabbs {bounds[0], bounds[1], bounds[2], bounds[3], bounds[4], bounds[5]};
+	for(size_t l = 0; l < 8; ++l) {
+		Vector3 o {lines[0][l], lines[1][l], lines[2][l]};
+		umath::intersection::line_aabb(o, Vector3 {lines[3][l], lines[4][l], lines[5][l]}, aabbs, out);
+		for(size_t i = 0; i < count; ++i)
+			validate(i, o, dirs[l], {bounds[0][i], bounds[1][i], bounds[2][i]}, {bounds[3][i], bounds[4][i], bounds[5][i]});
+	}
+
+	umath::intersection::LineSoAView lineView {lines[0], lines[1], lines[2], lines[3], lines[4], lines[5]};
+	size_t numHits = 0;
+	for(size_t b = 0; b < 8; ++b) {
+		Vector3 min {bounds[0][b], bounds[1][b], bounds[2][b]};
+		Vector3 max {bounds[3][b], bounds[4][b], bounds[5][b]};
+		umath::intersection::line_aabb(lineView, min, max, out);
+		for(size_t i = 0; i < count; ++i) {
+			validate(i, {lines[0][i], lines[1][i], lines[2][i]}, dirs[i], min, max);
+			numHits += (results[i] == umath::intersection::Result::Intersect) ? 1 : 0;
+		}
+	}
+	EXPECT_GT(numHits, 0);
+}
+
+TEST(IntersectionTests, SweepAabbWithAabb)
+{
+	Vector3 ext {1.f, 1.f, 1.f};
+	float entryTime, exitTime;
+	Vector3 normal;
+	auto sweep = [&](const Vector3 &aa, const Vector3 &ab, const Vector3 &ba, const Vector3 &bb) { return umath::sweep::aabb_with_aabb(aa, ab, ext, ba, bb, ext, &entryTime, &exitTime, &normal); };
+
+	// Overlapping at the start
+	ASSERT_TRUE(sweep({}, {}, {1.5f, 0.f, 0.f}, {1.5f, 0.f, 0.f}));
+	EXPECT_EQ(entryTime, 0.f);
+
+	// A at rest, B moving towards it: The gap of 8 units is closed after 80% of the movement
+	ASSERT_TRUE(sweep({}, {}, {10.f, 0.f, 0.f}, {}));
+	EXPECT_FLOAT_EQ(entryTime, 0.8f);
+	EXPECT_FLOAT_EQ(exitTime, 1.2f);
+	EXPECT_EQ(normal, (Vector3 {-1.f, 0.f, 0.f}));
+
+	// A moving diagonally: The y slab is entered at 0.1, the x slab at 0.4 and the y slab is left again at 0.5
+	ASSERT_TRUE(sweep({}, {10.f, 10.f, 0.f}, {6.f, 3.f, 0.f}, {6.f, 3.f, 0.f}));
+	EXPECT_FLOAT_EQ(entryTime, 0.4f);
+	EXPECT_FLOAT_EQ(exitTime, 0.5f);
+	EXPECT_EQ(normal, (Vector3 {-1.f, 0.f, 0.f}));
+
+	// Separated on an axis without relative motion
+	EXPECT_FALSE(sweep({}, {10.f, 0.f, 0.f}, {5.f, 5.f, 0.f}, {5.f, 5.f, 0.f}));
+	EXPECT_FALSE(sweep({}, {10.f, 0.f, 0.f}, {0.f, 5.f, 0.f}, {10.f, 5.f, 0.f}));
+
+	// B moving away faster than A follows
+	EXPECT_FALSE(sweep({}, {5.f, 0.f, 0.f}, {4.f, 0.f, 0.f}, {20.f, 0.f, 0.f}));
+	// Contact would only happen after the end of the movement
+	EXPECT_FALSE(sweep({}, {}, {20.f, 0.f, 0.f}, {15.f, 0.f, 0.f}));
+}
+
+TEST(IntersectionTests, Voxelize_LargeTriangle)
+{
+	// The bounds of the triangle in voxel units are far outside of the integer range
+	std::vector<Vector3> verts {{-1e7f, 0.0035f, -1e7f}, {1e7f, 0.0035f, -1e7f}, {0.f, 0.0035f, 1e7f}};
+	std::vector<uint16_t> indices {0, 1, 2};
+	Vector3 origin {};
+	constexpr float voxelSize = 0.001f;
+	Vector3i resolution {8, 8, 8};
+	umath::geometry::VoxelGrid grid;
+	umath::geometry::voxelize(verts, indices, origin, voxelSize, resolution, grid);
+
+	uint32_t numOccupied = 0;
+	for(int32_t z = 0; z < resolution.z; ++z) {
+		for(int32_t y = 0; y < resolution.y; ++y) {
+			for(int32_t x = 0; x < resolution.x; ++x) {
+				auto min = origin + Vector3 {static_cast<float>(x), static_cast<float>(y), static_cast<float>(z)} * voxelSize;
+				auto max = origin + Vector3 {static_cast<float>(x + 1), static_cast<float>(y + 1), static_cast<float>(z + 1)} * voxelSize;
+				auto occupied = umath::intersection::aabb_triangle(min, max, verts[0], verts[1], verts[2]);
+				ASSERT_EQ(grid.IsOccupied({x, y, z}), occupied) << "Voxel " << x << "," << y << "," << z;
+				if(occupied)
+					++numOccupied;
+			}
+		}
+	}
+	EXPECT_EQ(numOccupied, 64u);
+}
@@ -0,0 +1,76 @@
+#include <numeric>
+#include <thread>
+#include "mathutil/profiling.hpp"
+#include "mathutil/umath_geometry.hpp"
+#include "gtest/gtest.h"
+#include "gtest_common.h"
+
+using umath::profiling::Function;
+
+static uint64_t get_histogram_sum(const umath::profiling::FunctionStats &stats) { return std::accumulate(stats.histogram.begin(), stats.histogram.end(), uint64_t {0}); }
+
+TEST(ProfilingTests, Histogram)
+{
+	using umath::profiling::FunctionStats;
+	EXPECT_EQ(FunctionStats::GetBucketIndex(0), 0u);
+	EXPECT_EQ(FunctionStats::GetBucketIndex(1), 0u);
+	EXPECT_EQ(FunctionStats::GetBucketIndex(2), 1u);
+	EXPECT_EQ(FunctionStats::GetBucketIndex(1'023), 9u);
+	EXPECT_EQ(FunctionStats::GetBucketIndex(1'024), 10u);
+	EXPECT_EQ(FunctionStats::GetBucketIndex(UINT64_MAX), umath::profiling::HISTOGRAM_BUCKET_COUNT - 1);
+	for(uint32_t i = 1; i < umath::profiling::HISTOGRAM_BUCKET_COUNT; ++i)
+		EXPECT_EQ(FunctionStats::GetBucketIndex(FunctionStats::GetBucketLowerBound(i)), i);
+
+	FunctionStats stats {};
+	EXPECT_EQ(stats.GetPercentileNanoseconds(0.5), 0u);
+	// 90 calls in [8, 16), 10 in [1024, 2048)
+	stats.callCount = 100;
+	stats.totalNanoseconds = 90 * 10 + 10 * 1'500;
+	stats.histogram[3] = 90;
+	stats.histogram[10] = 10;
+	EXPECT_DOUBLE_EQ(stats.GetAverageNanoseconds(), 159.0);
+	EXPECT_EQ(stats.GetPercentileNanoseconds(0.0), 16u);
+	EXPECT_EQ(stats.GetPercentileNanoseconds(0.5), 16u);
+	EXPECT_EQ(stats.GetPercentileNanoseconds(0.95), 2'048u);
+	EXPECT_EQ(stats.GetPercentileNanoseconds(1.0), 2'048u);
+}
+
+TEST(ProfilingTests, Counters)
+{
+	auto callLineAabb = [](uint32_t count) {
+		for(uint32_t i = 0; i < count; ++i) {
+			float tMin;
+			umath::intersection::line_aabb(Vector3 {-10.f, 0.f, 0.f}, Vector3 {1.f, 0.f, 0.f}, Vector3 {-1.f, -1.f, -1.f}, Vector3 {1.f, 1.f, 1.f}, &tMin);
+		}
+	};
+	std::vector<umath::Plane> planes {umath::Plane {Vector3 {1.f, 0.f, 0.f}, 10.0}};
+
+	umath::profiling::reset();
+	callLineAabb(3);
+	umath::intersection::aabb_in_plane_mesh(Vector3 {-1.f, -1.f, -1.f}, Vector3 {1.f, 1.f, 1.f}, planes);
+	// The counters of a thread are kept after it has exited
+	std::thread {[&callLineAabb]() { callLineAabb(5); }}.join();
+
+	auto snapshot = umath::profiling::get_snapshot();
+	auto threadSnapshot = umath::profiling::get_thread_snapshot();
+	if(!umath::profiling::is_enabled()) {
+		for(auto &stats : snapshot.functions)
+			EXPECT_EQ(stats.callCount, 0u);
+		return;
+	}
+	EXPECT_EQ(snapshot[Function::LineAabb].callCount, 8u);
+	EXPECT_EQ(get_histogram_sum(snapshot[Function::LineAabb]), 8u);
+	EXPECT_EQ(threadSnapshot[Function::LineAabb].callCount, 3u);
+	EXPECT_EQ(snapshot[Function::AabbInPlaneMesh].callCount, 1u);
+	EXPECT_EQ(threadSnapshot[Function::AabbInPlaneMesh].callCount, 1u);
+	EXPECT_EQ(snapshot[Function::SkinDualQuat].callCount, 0u);
+
+	umath::profiling::reset();
+	EXPECT_EQ(umath::profiling::get_snapshot()[Function::LineAabb].callCount, 0u);
+	callLineAabb(2);
+	snapshot = umath::profiling::get_snapshot();
+	EXPECT_EQ(snapshot[Function::LineAabb].callCount, 2u);
+	EXPECT_EQ(get_histogram_sum(snapshot[Function::LineAabb]), 2u);
+	EXPECT_EQ(umath::profiling::get_thread_snapshot()[Function::LineAabb].callCount, 2u);
+	EXPECT_EQ(snapshot[Function::AabbInPlaneMesh].callCount, 0u);
+}
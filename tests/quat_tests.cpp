@@ -0,0 +1,146 @@
+#include <random>
+#include <vector>
+#include "mathutil/uquat.h"
+#include "gtest/gtest.h"
+#include "gtest_common.h"
+
+static Quat random_rotation(std::mt19937 &rng)
+{
+	std::uniform_real_distribution<float> dis {-1.f, 1.f};
+	return uquat::create(uvec::get_normal(Vector3 {dis(rng), dis(rng), dis(rng) + 2.f}), dis(rng) * 3.f);
+}
+
+static void expect_near(const Quat &a, const Quat &b, float epsilon)
+{
+	ASSERT_NEAR(a.w, b.w, epsilon);
+	ASSERT_NEAR(a.x, b.x, epsilon);
+	ASSERT_NEAR(a.y, b.y, epsilon);
+	ASSERT_NEAR(a.z, b.z, epsilon);
+}
+
+TEST(QuatTests, BatchInterpolation)
+{
+	std::mt19937 rng {22};
+	std::uniform_real_distribution<float> disFactor {0.f, 1.f};
+	constexpr size_t count = 27;
+	std::vector<Quat> q1(count);
+	std::vector<Quat> q2(count);
+	std::vector<float> factors(count);
+	for(size_t i = 0; i < count; ++i) {
+		q1[i] = random_rotation(rng);
+		q2[i] = random_rotation(rng);
+		factors[i] = disFactor(rng);
+	}
+	// Opposite hemisphere and nearly identical rotations
+	q2[1] = -q2[1];
+	q2[2] = q1[2];
+	auto factor = 0.35f;
+	std::vector<Quat> slerped(count), slerpedFast(count), nlerped(count), lerped(count);
+	uquat::slerp(q1, q2, factor, slerped);
+	uquat::slerp_fast(q1, q2, factor, slerpedFast);
+	uquat::nlerp(q1, q2, factor, nlerped);
+	uquat::lerp(q1, q2, factor, lerped);
+	for(size_t i = 0; i < count; ++i) {
+		expect_near(slerped[i], uquat::slerp(q1[i], q2[i], factor), 1e-5f);
+		expect_near(slerpedFast[i], uquat::slerp_fast(q1[i], q2[i], factor), 1e-5f);
+		expect_near(nlerped[i], uquat::nlerp(q1[i], q2[i], factor), 1e-5f);
+		expect_near(lerped[i], uquat::lerp(q1[i], q2[i], factor), 1e-6f);
+	}
+
+	uquat::slerp(q1[0], q2[0], factors, slerped);
+	uquat::slerp_fast(q1[0], q2[0], factors, slerpedFast);
+	uquat::nlerp(q1[0], q2[0], factors, nlerped);
+	uquat::lerp(q1[0], q2[0], factors, lerped);
+	for(size_t i = 0; i < count; ++i) {
+		expect_near(slerped[i], uquat::slerp(q1[0], q2[0], factors[i]), 1e-5f);
+		expect_near(slerpedFast[i], uquat::slerp_fast(q1[0], q2[0], factors[i]), 1e-5f);
+		expect_near(nlerped[i], uquat::nlerp(q1[0], q2[0], factors[i]), 1e-5f);
+		expect_near(lerped[i], uquat::lerp(q1[0], q2[0], factors[i]), 1e-6f);
+	}
+}
+
+TEST(QuatTests, SlerpFastError)
+{
+	// Angles between the rotations up to 180 degrees (the largest interpolation angle along the shortest path)
+	auto maxError = 0.f;
+	for(auto i = 0; i <= 180; ++i) {
+		auto angle = static_cast<float>(umath::deg_to_rad(i)) * 2.f;
+		auto q1 = uquat::create(uvec::get_normal(Vector3 {1.f, 2.f, 3.f}), 0.4f);
+		auto q2 = q1 * uquat::create(uvec::get_normal(Vector3 {-2.f, 1.f, 0.5f}), angle);
+		for(auto j = 0; j <= 100; ++j) {
+			auto t = j / 100.f;
+			auto a = uquat::slerp_fast(q1, q2, t);
+			auto b = uquat::slerp(q1, q2, t);
+			if(uquat::dot_product(a, b) < 0.f)
+				b = -b;
+			// Rotation angle between a and b, more accurate than acos of the dot product for small angles
+			auto dist = umath::min(uquat::length(a - b), 2.f);
+			maxError = umath::max(maxError, 4.f * std::asin(dist * 0.5f));
+		}
+	}
+	ASSERT_LT(maxError, 8e-4f);
+}
+
+TEST(QuatTests, MarkleyAverage)
+{
+	std::mt19937 rng {23};
+	std::uniform_real_distribution<float> dis {-1.f, 1.f};
+	// Two rotations around the same axis average to the rotation halfway between them, regardless of their signs
+	auto axis = uvec::get_normal(Vector3 {1.f, -2.f, 0.5f});
+	std::vector<Quat> pair {uquat::create(axis, 0.2f), -uquat::create(axis, 2.8f)};
+	expect_near(uquat::calc_average_markley(pair), uquat::create(axis, 1.5f), 1e-5f);
+	std::vector<float> pairWeights {3.f, 3.f};
+	expect_near(uquat::calc_average_markley(pair, pairWeights), uquat::create(axis, 1.5f), 1e-5f);
+
+	// Symmetric perturbations around a rotation average to the rotation itself
+	auto center = random_rotation(rng);
+	std::vector<Quat> samples;
+	std::vector<float> weights;
+	for(auto i = 0; i < 200; ++i) {
+		auto offset = uquat::create(uvec::get_normal(Vector3 {dis(rng), dis(rng), dis(rng) + 2.f}), dis(rng) * 0.8f);
+		auto w = dis(rng) * 0.5f + 1.f;
+		samples.push_back(center * offset);
+		samples.push_back(-(center * uquat::get_inverse(offset)));
+		weights.push_back(w);
+		weights.push_back(w);
+	}
+	auto avg = uquat::calc_average_markley(samples, weights);
+	ASSERT_NEAR(std::abs(uquat::dot_product(avg, center)), 1.f, 1e-5f);
+	ASSERT_GE(avg.w, 0.f);
+
+	// Streaming in chunks gives the same result
+	uquat::AverageAccumulator accumulator;
+	accumulator.Add(std::span<const Quat> {samples}.first(150), std::span<const float> {weights}.first(150));
+	for(size_t i = 150; i < samples.size(); ++i)
+		accumulator.Add(samples[i], weights[i]);
+	ASSERT_EQ(accumulator.GetCount(), samples.size());
+	expect_near(accumulator.GetAverage(), avg, 1e-6f);
+	accumulator.Reset();
+	expect_near(accumulator.GetAverage(), uquat::identity(), 0.f);
+}
+
+TEST(QuatTests, InlineFunctions)
+{
+	std::mt19937 rng {24};
+	std::uniform_real_distribution<float> dis {-10.f, 10.f};
+	for(auto i = 0; i < 20; ++i) {
+		auto q0 = random_rotation(rng);
+		auto q1 = random_rotation(rng);
+		Vector3 a {dis(rng), dis(rng), dis(rng)};
+		Vector3 b {dis(rng), dis(rng), dis(rng)};
+		// The exported functions are implemented with the inline ones, so the results have to be identical
+		ASSERT_EQ(uquat::inl::dot_product(q0, q1), uquat::dot_product(q0, q1));
+		ASSERT_EQ(uquat::inl::forward(q0), uquat::forward(q0));
+		ASSERT_EQ(uquat::inl::right(q0), uquat::right(q0));
+		ASSERT_EQ(uquat::inl::up(q0), uquat::up(q0));
+		ASSERT_EQ(uvec::inl::dot(a, b), uvec::dot(a, b));
+		ASSERT_EQ(uvec::inl::length_sqr(a), uvec::length_sqr(a));
+		ASSERT_EQ(uvec::inl::cross(a, b), uvec::cross(a, b));
+		ASSERT_EQ(uvec::inl::distance_sqr(a, b), uvec::distance_sqr(a, b));
+		// Orthonormal basis
+		auto f = uquat::inl::forward(q0);
+		auto r = uquat::inl::right(q0);
+		ASSERT_NEAR(uvec::inl::dot(f, r), 0.f, 1e-5f);
+		ASSERT_NEAR(uvec::inl::length_sqr(uquat::inl::up(q0)), 1.f, 1e-5f);
+	}
+}
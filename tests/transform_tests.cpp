@@ -0,0 +1,263 @@
+#include <random>
+#include <vector>
+#include "mathutil/transform.hpp"
+#include "mathutil/transform_soa.hpp"
+#include "mathutil/dual_quat.hpp"
+#include "mathutil/transform_compression.hpp"
+#include "gtest/gtest.h"
+#include "gtest_common.h"
+
+static umath::ScaledTransform random_transform(std::mt19937 &rng)
+{
+	std::uniform_real_distribution<float> dis {-1.f, 1.f};
+	std::uniform_real_distribution<float> disScale {0.5f, 2.f};
+	auto rot = uquat::create(uvec::get_normal(Vector3 {dis(rng), dis(rng), dis(rng) + 2.f}), dis(rng) * 3.f);
+	return umath::ScaledTransform {Vector3 {dis(rng), dis(rng), dis(rng)} * 5.f, rot, Vector3 {disScale(rng), disScale(rng), disScale(rng)}};
+}
+
+static void expect_near(const umath::ScaledTransform &a, const umath::ScaledTransform &b, float epsilon)
+{
+	for(uint8_t i = 0; i < 3; ++i) {
+		ASSERT_NEAR(a.GetOrigin()[i], b.GetOrigin()[i], epsilon);
+		ASSERT_NEAR(a.GetScale()[i], b.GetScale()[i], epsilon);
+	}
+	ASSERT_NEAR(std::abs(uquat::dot_product(a.GetRotation(), b.GetRotation())), 1.f, epsilon);
+}
+
+static void expect_near(const Mat4 &a, const Mat4 &b, float epsilon)
+{
+	for(uint8_t c = 0; c < 4; ++c) {
+		for(uint8_t r = 0; r < 4; ++r)
+			ASSERT_NEAR(a[c][r], b[c][r], epsilon);
+	}
+}
+
+TEST(TransformTests, HierarchyWorldTransforms)
+{
+	std::mt19937 rng {16};
+	constexpr uint32_t boneCount = 24;
+	std::vector<int32_t> parents(boneCount);
+	std::vector<umath::ScaledTransform> inverseBindPoses(boneCount);
+	for(uint32_t i = 0; i < boneCount; ++i) {
+		parents[i] = (i == 0) ? -1 : static_cast<int32_t>(rng() % i);
+		inverseBindPoses[i] = random_transform(rng);
+	}
+	// Counts below and above the SIMD width, including partially filled blocks
+	for(uint32_t instanceCount : {1u, 3u, 8u, 13u}) {
+		std::vector<umath::ScaledTransform> locals(instanceCount * boneCount);
+		for(auto &t : locals)
+			t = random_transform(rng);
+		std::vector<umath::ScaledTransform> worlds(locals.size());
+		std::vector<Mat4> matrices(locals.size());
+		umath::compute_world_transforms(parents, locals, worlds, matrices, inverseBindPoses);
+		// In-place without inverse bind poses
+		auto inPlace = locals;
+		std::vector<Mat4> worldMatrices(locals.size());
+		umath::compute_world_transforms(parents, inPlace, inPlace, worldMatrices);
+		for(uint32_t inst = 0; inst < instanceCount; ++inst) {
+			for(uint32_t i = 0; i < boneCount; ++i) {
+				auto idx = inst * boneCount + i;
+				auto expected = locals[idx];
+				for(auto parent = parents[i]; parent >= 0; parent = parents[parent])
+					expected = locals[inst * boneCount + parent] * expected;
+				expect_near(worlds[idx], expected, 1e-3f);
+				expect_near(inPlace[idx], expected, 1e-3f);
+				expect_near(matrices[idx], (expected * inverseBindPoses[i]).ToMatrix(), 1e-3f);
+				expect_near(worldMatrices[idx], expected.ToMatrix(), 1e-3f);
+			}
+		}
+	}
+}
+
+TEST(TransformTests, TransformSoAMatchesScalar)
+{
+	std::mt19937 rng {17};
+	std::uniform_real_distribution<float> dis {-10.f, 10.f};
+	for(size_t count : {0u, 5u, 8u, 29u}) {
+		std::vector<umath::ScaledTransform> transforms(count);
+		std::vector<umath::ScaledTransform> targets(count);
+		std::vector<Vector3> points(count);
+		for(size_t i = 0; i < count; ++i) {
+			transforms[i] = random_transform(rng);
+			targets[i] = random_transform(rng);
+			points[i] = {dis(rng), dis(rng), dis(rng)};
+		}
+		// Nearly identical rotations take the linear interpolation path
+		if(count > 0)
+			targets[0].SetRotation(transforms[0].GetRotation());
+		umath::TransformSoA soa {transforms};
+		ASSERT_EQ(soa.GetCount(), count);
+		auto roundTrip = soa.ToVector();
+		for(size_t i = 0; i < count; ++i)
+			ASSERT_EQ(roundTrip[i].GetRotation(), transforms[i].GetRotation());
+
+		std::vector<Vector3> transformed(count);
+		soa.TransformPoints(points, transformed);
+		std::vector<Mat4> matrices(count);
+		soa.ToMatrices(matrices);
+		umath::TransformSoA inverse;
+		soa.GetInverse(inverse);
+		auto interpolated = soa;
+		interpolated.Interpolate(umath::TransformSoA {targets}, 0.3f);
+		for(size_t i = 0; i < count; ++i) {
+			auto expectedPoint = transforms[i] * points[i];
+			for(uint8_t j = 0; j < 3; ++j)
+				ASSERT_NEAR(transformed[i][j], expectedPoint[j], 1e-4f);
+			expect_near(matrices[i], transforms[i].ToMatrix(), 1e-5f);
+			expect_near(inverse.Get(i), transforms[i].GetInverse(), 1e-5f);
+			auto expected = transforms[i];
+			expected.Interpolate(targets[i], 0.3f);
+			expect_near(interpolated.Get(i), expected, 1e-5f);
+		}
+	}
+}
+
+TEST(TransformTests, DualQuat)
+{
+	std::mt19937 rng {18};
+	std::uniform_real_distribution<float> dis {-10.f, 10.f};
+	for(auto i = 0; i < 20; ++i) {
+		umath::Transform a = random_transform(rng);
+		umath::Transform b = random_transform(rng);
+		umath::DualQuat dqA {a};
+		umath::DualQuat dqB {b};
+		expect_near(umath::ScaledTransform {dqA.ToTransform()}, umath::ScaledTransform {a}, 1e-4f);
+		expect_near(umath::ScaledTransform {(dqA * dqB).ToTransform()}, umath::ScaledTransform {a * b}, 1e-4f);
+		expect_near(umath::ScaledTransform {(dqA * dqA.GetInverse()).ToTransform()}, umath::ScaledTransform {}, 1e-4f);
+		Vector3 p {dis(rng), dis(rng), dis(rng)};
+		auto expected = a * p;
+		auto transformed = dqA * p;
+		for(uint8_t j = 0; j < 3; ++j)
+			ASSERT_NEAR(transformed[j], expected[j], 1e-4f);
+	}
+}
+
+TEST(TransformTests, DualQuatSkinning)
+{
+	std::mt19937 rng {19};
+	std::uniform_real_distribution<float> dis {-10.f, 10.f};
+	std::uniform_real_distribution<float> disWeight {0.f, 1.f};
+	constexpr uint32_t boneCount = 12;
+	constexpr uint32_t vertexCount = 37;
+	std::vector<umath::DualQuat> bones;
+	for(uint32_t i = 0; i < boneCount; ++i) {
+		umath::DualQuat dq {umath::Transform {random_transform(rng)}};
+		// Antipodal representations of a rotation have to be handled by the skinning
+		bones.push_back((i % 3 == 0) ? dq * -1.f : dq);
+	}
+	std::vector<umath::VertexWeight> weights(vertexCount);
+	std::vector<Vector3> positions(vertexCount);
+	std::vector<Vector3> normals(vertexCount);
+	for(uint32_t i = 0; i < vertexCount; ++i) {
+		auto &vw = weights[i];
+		Vector4 w {disWeight(rng), disWeight(rng), disWeight(rng), disWeight(rng)};
+		vw.weights = w / (w.x + w.y + w.z + w.w);
+		for(uint8_t j = 0; j < 4; ++j)
+			vw.boneIds[j] = static_cast<int32_t>(rng() % boneCount);
+		// Unused influences
+		if(i % 4 == 1)
+			vw.boneIds[3] = -1;
+		positions[i] = {dis(rng), dis(rng), dis(rng)};
+		normals[i] = uvec::get_normal(Vector3 {dis(rng), dis(rng), dis(rng)});
+	}
+	// A single influence has to reproduce the bone transform exactly
+	weights[0].boneIds = {5, -1, -1, -1};
+	weights[0].weights = {1.f, 0.f, 0.f, 0.f};
+
+	std::vector<Vector3> outPositions(vertexCount);
+	std::vector<Vector3> outNormals(vertexCount);
+	umath::skin_dual_quat(bones, weights, positions, outPositions, normals, outNormals);
+	for(uint32_t i = 0; i < vertexCount; ++i) {
+		auto &vw = weights[i];
+		umath::DualQuat blended {Quat {0.f, 0.f, 0.f, 0.f}, Quat {0.f, 0.f, 0.f, 0.f}};
+		auto &pivot = bones[vw.boneIds[0]];
+		for(uint8_t j = 0; j < 4; ++j) {
+			if(vw.boneIds[j] < 0)
+				continue;
+			auto &bone = bones[vw.boneIds[j]];
+			auto w = vw.weights[j];
+			if(uquat::dot_product(bone.real, pivot.real) < 0.f)
+				w = -w;
+			blended += bone * w;
+		}
+		blended.Normalize();
+		auto expectedPos = blended.TransformPoint(positions[i]);
+		auto expectedNormal = blended.TransformVector(normals[i]);
+		for(uint8_t j = 0; j < 3; ++j) {
+			ASSERT_NEAR(outPositions[i][j], expectedPos[j], 1e-4f);
+			ASSERT_NEAR(outNormals[i][j], expectedNormal[j], 1e-4f);
+		}
+	}
+	auto expected = bones[5].GetNormal().TransformPoint(positions[0]);
+	for(uint8_t j = 0; j < 3; ++j)
+		ASSERT_NEAR(outPositions[0][j], expected[j], 1e-4f);
+}
+
+TEST(TransformTests, UniformScaledTransform)
+{
+	std::mt19937 rng {20};
+	std::uniform_real_distribution<float> dis {-10.f, 10.f};
+	std::uniform_real_distribution<float> disScale {0.5f, 2.f};
+	for(auto i = 0; i < 20; ++i) {
+		auto ta = random_transform(rng);
+		auto tb = random_transform(rng);
+		umath::UniformScaledTransform a {ta, disScale(rng)};
+		umath::UniformScaledTransform b {tb, disScale(rng)};
+		umath::ScaledTransform sa {a};
+		umath::ScaledTransform sb {b};
+		expect_near(umath::ScaledTransform {a * b}, sa * sb, 1e-4f);
+		auto ab = a;
+		ab *= b;
+		expect_near(umath::ScaledTransform {ab}, sa * sb, 1e-4f);
+		expect_near(umath::ScaledTransform {a.GetInverse()}, sa.GetInverse(), 1e-4f);
+		expect_near(a.ToMatrix(), sa.ToMatrix(), 1e-4f);
+		Vector3 p {dis(rng), dis(rng), dis(rng)};
+		auto expected = sa * p;
+		auto transformed = a * p;
+		for(uint8_t j = 0; j < 3; ++j)
+			ASSERT_NEAR(transformed[j], expected[j], 1e-4f);
+		auto interpolated = a;
+		interpolated.Interpolate(b, 0.25f);
+		auto expectedInterpolated = sa;
+		expectedInterpolated.Interpolate(sb, 0.25f);
+		expect_near(umath::ScaledTransform {interpolated}, expectedInterpolated, 1e-4f);
+		ASSERT_EQ(umath::UniformScaledTransform {sa}.GetScale(), a.GetScale());
+	}
+}
+
+TEST(TransformTests, CompressedTransformStream)
+{
+	std::mt19937 rng {21};
+	constexpr size_t count = 45;
+	std::vector<umath::ScaledTransform> transforms(count);
+	for(auto &t : transforms)
+		t = random_transform(rng);
+	transforms[0] = {};
+	// Antipodal rotation and the boundary of the translation range
+	transforms[1].SetRotation(-transforms[1].GetRotation());
+	transforms[2].SetOrigin({-5.f, 0.f, 5.f});
+	umath::CompressedTransformStream stream {transforms};
+	ASSERT_EQ(stream.GetCount(), count);
+	ASSERT_EQ(sizeof(umath::CompressedTransform), 18);
+	auto decoded = stream.Decode();
+	auto maxTranslationError = stream.GetTranslationRange() * std::ldexp(1.f, -stream.GetTranslationPrecision());
+	for(size_t i = 0; i < count; ++i) {
+		auto &t = transforms[i];
+		auto &d = decoded[i];
+		ASSERT_NEAR(std::abs(uquat::dot_product(t.GetRotation(), d.GetRotation())), 1.f, 1e-6f);
+		auto rot = umath::decompress_rotation(umath::compress_rotation(t.GetRotation()));
+		ASSERT_NEAR(uquat::dot_product(rot, d.GetRotation()), 1.f, 1e-6f);
+		for(uint8_t j = 0; j < 3; ++j) {
+			ASSERT_NEAR(d.GetOrigin()[j], t.GetOrigin()[j], maxTranslationError);
+			ASSERT_NEAR(d.GetScale()[j], t.GetScale()[j], t.GetScale()[j] / 1024.f);
+		}
+	}
+	expect_near(stream.Get(0), {}, 1e-6f);
+	// Partial range, not aligned to the SIMD width
+	std::vector<umath::ScaledTransform> range(count - 7);
+	stream.Decode(5, range);
+	for(size_t i = 0; i < range.size(); ++i)
+		expect_near(range[i], decoded[i + 5], 1e-6f);
+	umath::CompressedTransformStream restored {stream.GetKeys(), stream.GetTranslationRange(), stream.GetTranslationEpsilon(), stream.GetTranslationPrecision()};
+	expect_near(restored.Get(count - 1), decoded[count - 1], 1e-6f);
+}